@@ -101,6 +101,8 @@ import com.igalia.wolvic.utils.SystemUtils;
 import org.json.JSONObject;
 
 import java.io.File;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
 import java.util.ArrayList;
 import java.util.Arrays;
 import java.util.HashSet;
@@ -127,6 +129,9 @@ public class VRBrowserActivity extends PlatformActivity implements WidgetManager
     public static final String EXTRA_CREATE_NEW_WINDOW = "create_new_window";
     public static final String EXTRA_HIDE_WEBXR_INTERSTITIAL = "hide_webxr_interstitial";
     public static final String EXTRA_HIDE_WHATS_NEW = "hide_whats_new";
+    // Records the controller input to the given file of the cache directory, an empty name stops it.
+    // Only honored by debug builds.
+    public static final String EXTRA_RECORD_INPUT = "record_input";
     public static final String EXTRA_KIOSK = "kiosk";
     private static final long BATTERY_UPDATE_INTERVAL = 60 * 1_000_000_000L; // 60 seconds
 
@@ -198,6 +203,19 @@ public class VRBrowserActivity extends PlatformActivity implements WidgetManager
     static final long RESET_CRASH_COUNT_DELAY = 5000;
     static final int UPDATE_NATIVE_WIDGETS_DELAY = 50; // milliseconds
 
+    // Layout of the events sent by handleEventBatch, must match VRBrowser.cpp.
+    static final int EVENT_MOTION = 1;
+    static final int EVENT_SCROLL = 2;
+    static final int EVENT_GESTURE = 3;
+    static final int EVENT_AUDIO_POSE = 4;
+    static final int EVENT_RESIZE = 5;
+    static final int EVENT_MOVE_END = 6;
+    static final int EVENT_BACK = 7;
+    static final int EVENT_FOCUSED = 1;
+    static final int EVENT_PRESSED = 1 << 1;
+    static final int EVENT_SIZE = 48;
+    static final int EVENT_VALUES_OFFSET = 16;
+
     // Passthrough was enabled on Pico version 5.7.1, via XR_FB_passthrough extension
     static final String kPicoVersionPassthroughUpdate = "5.7.1";
 
@@ -373,6 +391,12 @@ public class VRBrowserActivity extends PlatformActivity implements WidgetManager
         checkForCrash();
 
         setHeadLockEnabled(mSettings.isHeadLockEnabled());
+        final boolean multiviewEnabled = mSettings.isMultiviewEnabled();
+        queueRunnable(() -> setMultiviewEnabledNative(multiviewEnabled));
+        final boolean lateLatchEnabled = mSettings.isLateLatchEnabled();
+        queueRunnable(() -> setLateLatchEnabledNative(lateLatchEnabled));
+        final boolean profilerEnabled = mSettings.isProfilerEnabled();
+        queueRunnable(() -> setProfilerEnabledNative(profilerEnabled));
 
         // Show the launch dialogs, if needed.
         if (!showTermsServiceDialogIfNeeded()) {
@@ -749,6 +773,15 @@ public class VRBrowserActivity extends PlatformActivity implements WidgetManager
                 ((VRBrowserApplication) getApplication()).setSpeechRecognizer(speechRecognizer);
             } else if (key.equals(getString(R.string.settings_key_head_lock))) {
                 setHeadLockEnabled(SettingsStore.getInstance(this).isHeadLockEnabled());
+            } else if (key.equals(getString(R.string.settings_key_multiview))) {
+                final boolean multiviewEnabled = SettingsStore.getInstance(this).isMultiviewEnabled();
+                queueRunnable(() -> setMultiviewEnabledNative(multiviewEnabled));
+            } else if (key.equals(getString(R.string.settings_key_late_latch))) {
+                final boolean lateLatchEnabled = SettingsStore.getInstance(this).isLateLatchEnabled();
+                queueRunnable(() -> setLateLatchEnabledNative(lateLatchEnabled));
+            } else if (key.equals(getString(R.string.settings_key_profiler))) {
+                final boolean profilerEnabled = SettingsStore.getInstance(this).isProfilerEnabled();
+                queueRunnable(() -> setProfilerEnabledNative(profilerEnabled));
             }
         } catch (ReflectiveOperationException e) {
             e.printStackTrace();
@@ -760,6 +793,18 @@ public class VRBrowserActivity extends PlatformActivity implements WidgetManager
             Log.e(LOGTAG,"Loading from crash Intent");
         }
 
+        // Input recording is a development tool, so release builds ignore it. The name must stay a
+        // plain file name inside the cache directory.
+        final String inputRecording = BuildConfig.DEBUG ? intent.getStringExtra(EXTRA_RECORD_INPUT) : null;
+        if (inputRecording != null) {
+            if (inputRecording.contains("/") || inputRecording.contains("\\") || inputRecording.contains("..")) {
+                Log.e(LOGTAG, "Ignoring invalid input recording name: " + inputRecording);
+            } else {
+                final String path = inputRecording.isEmpty() ? "" : new File(getCacheDir(), inputRecording).getAbsolutePath();
+                queueRunnable(() -> setInputRecordingPathNative(path));
+            }
+        }
+
         DeepLinkUtils.Params deeplink = DeepLinkUtils.parseDeepLinkFromIntent(this, intent);
         if (!TextUtils.isEmpty(deeplink.getFrom())) {
             if (mWindows.getFocusedWindow().isCurrentUriBlank()) {
@@ -1063,6 +1108,49 @@ public class VRBrowserActivity extends PlatformActivity implements WidgetManager
 
     @Keep
     @SuppressWarnings("unused")
+    void handleEventBatch(final ByteBuffer aEvents, final int aCount) {
+        // The buffer is reused by the render thread, so every event must be read before returning.
+        aEvents.order(ByteOrder.nativeOrder());
+        for (int i = 0; i < aCount; i++) {
+            final int offset = i * EVENT_SIZE;
+            final int type = aEvents.getInt(offset);
+            final int handle = aEvents.getInt(offset + 4);
+            final int device = aEvents.getInt(offset + 8);
+            final int flags = aEvents.getInt(offset + 12);
+            final int values = offset + EVENT_VALUES_OFFSET;
+            switch (type) {
+                case EVENT_MOTION:
+                    handleMotionEvent(handle, device, (flags & EVENT_FOCUSED) != 0, (flags & EVENT_PRESSED) != 0,
+                            aEvents.getFloat(values), aEvents.getFloat(values + 4));
+                    break;
+                case EVENT_SCROLL:
+                    handleScrollEvent(handle, device, aEvents.getFloat(values), aEvents.getFloat(values + 4));
+                    break;
+                case EVENT_GESTURE:
+                    handleGesture(handle);
+                    break;
+                case EVENT_AUDIO_POSE:
+                    handleAudioPose(aEvents.getFloat(values), aEvents.getFloat(values + 4),
+                            aEvents.getFloat(values + 8), aEvents.getFloat(values + 12),
+                            aEvents.getFloat(values + 16), aEvents.getFloat(values + 20),
+                            aEvents.getFloat(values + 24));
+                    break;
+                case EVENT_RESIZE:
+                    handleResize(handle, aEvents.getFloat(values), aEvents.getFloat(values + 4));
+                    break;
+                case EVENT_MOVE_END:
+                    handleMoveEnd(handle, aEvents.getFloat(values), aEvents.getFloat(values + 4),
+                            aEvents.getFloat(values + 8), aEvents.getFloat(values + 12));
+                    break;
+                case EVENT_BACK:
+                    handleBack();
+                    break;
+                default:
+                    Log.e(LOGTAG, "Unknown native event type: " + type);
+            }
+        }
+    }
+
     void handleMotionEvent(final int aHandle, final int aDevice, final boolean aFocused, final boolean aPressed, final float aX, final float aY) {
         runOnUiThread(() -> {
             Widget widget = mWidgets.get(aHandle);
@@ -1094,8 +1182,6 @@ public class VRBrowserActivity extends PlatformActivity implements WidgetManager
         });
     }
 
-    @Keep
-    @SuppressWarnings("unused")
     void handleScrollEvent(final int aHandle, final int aDevice, final float aX, final float aY) {
         runOnUiThread(() -> {
             Widget widget = mWidgets.get(aHandle);
@@ -1115,8 +1201,6 @@ public class VRBrowserActivity extends PlatformActivity implements WidgetManager
         });
     }
 
-    @Keep
-    @SuppressWarnings("unused")
     void handleGesture(final int aType) {
         runOnUiThread(() -> {
             boolean consumed = false;
@@ -1145,8 +1229,6 @@ public class VRBrowserActivity extends PlatformActivity implements WidgetManager
         });
     }
 
-    @SuppressWarnings({"UnusedDeclaration"})
-    @Keep
     void handleBack() {
         runOnUiThread(() -> {
             // On WAVE VR, the back button no longer seems to work.
@@ -1167,8 +1249,6 @@ public class VRBrowserActivity extends PlatformActivity implements WidgetManager
         });
     }
 
-    @Keep
-    @SuppressWarnings({"UnusedDeclaration"})
     void handleAudioPose(float qx, float qy, float qz, float qw, float px, float py, float pz) {
         mAudioEngine.setPose(qx, qy, qz, qw, px, py, pz);
 
@@ -1177,14 +1257,10 @@ public class VRBrowserActivity extends PlatformActivity implements WidgetManager
         runOnUiThread(mAudioUpdateRunnable);
     }
 
-    @Keep
-    @SuppressWarnings("unused")
     void handleResize(final int aHandle, final float aWorldWidth, final float aWorldHeight) {
         runOnUiThread(() -> mWindows.getFocusedWindow().handleResizeEvent(aWorldWidth, aWorldHeight));
     }
 
-    @Keep
-    @SuppressWarnings("unused")
     void handleMoveEnd(final int aHandle, final float aDeltaX, final float aDeltaY, final float aDeltaZ, final float aRotation) {
         runOnUiThread(() -> {
             Widget widget = mWidgets.get(aHandle);
@@ -1336,6 +1412,12 @@ public class VRBrowserActivity extends PlatformActivity implements WidgetManager
         return path.getAbsolutePath();
     }
 
+    @Keep
+    @SuppressWarnings("unused")
+    String getCacheAbsolutePath() {
+        return getCacheDir().getAbsolutePath();
+    }
+
     @Keep
     @SuppressWarnings("unused")
     public boolean isOverrideEnvPathEnabled() {
@@ -2089,6 +2171,7 @@ public class VRBrowserActivity extends PlatformActivity implements WidgetManager
     private native void setWorldBrightnessNative(float aBrightness);
     private native void triggerHapticFeedbackNative(float aPulseDuration, float aPulseIntensity);
     private native void setTemporaryFilePath(String aPath);
+    private native void setInputRecordingPathNative(String aPath);
     private native void exitImmersiveNative();
     private native void workaroundGeckoSigAction();
     private native void updateEnvironmentNative();
@@ -2103,6 +2186,9 @@ public class VRBrowserActivity extends PlatformActivity implements WidgetManager
     private native void deleteCallbackNative(long aCallback);
     private native void setCylinderDensityNative(float aDensity);
     private native void setCPULevelNative(@CPULevelFlags int aCPULevel);
+    private native void setMultiviewEnabledNative(boolean aEnabled);
+    private native void setLateLatchEnabledNative(boolean aEnabled);
+    private native void setProfilerEnabledNative(boolean aEnabled);
     private native void setWebXRIntersitialStateNative(@WebXRInterstitialState int aState);
     private native void setIsServo(boolean aIsServo);
 }
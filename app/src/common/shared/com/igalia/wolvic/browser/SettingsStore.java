@@ -138,6 +138,9 @@ public class SettingsStore {
     public final static boolean AUTOCOMPLETE_ENABLED = true;
     public final static boolean WEBGL_OUT_OF_PROCESS = false;
     public final static boolean LOCAL_ADDON_ALLOWED = false;
+    public final static boolean MULTIVIEW_ENABLED = false;
+    public final static boolean LATE_LATCH_ENABLED = true;
+    public final static boolean PROFILER_ENABLED = false;
     public final static int PREFS_LAST_RESET_VERSION_CODE = 0;
     public final static boolean PASSWORDS_ENCRYPTION_KEY_GENERATED = false;
     public final static boolean AUTOFILL_ENABLED = true;
@@ -980,6 +983,36 @@ public class SettingsStore {
         return mPrefs.getBoolean(mContext.getString(R.string.settings_key_local_addon_allowed), LOCAL_ADDON_ALLOWED);
     }
 
+    public void setMultiviewEnabled(boolean isEnabled) {
+        SharedPreferences.Editor editor = mPrefs.edit();
+        editor.putBoolean(mContext.getString(R.string.settings_key_multiview), isEnabled);
+        editor.commit();
+    }
+
+    public boolean isMultiviewEnabled() {
+        return mPrefs.getBoolean(mContext.getString(R.string.settings_key_multiview), MULTIVIEW_ENABLED);
+    }
+
+    public void setLateLatchEnabled(boolean isEnabled) {
+        SharedPreferences.Editor editor = mPrefs.edit();
+        editor.putBoolean(mContext.getString(R.string.settings_key_late_latch), isEnabled);
+        editor.commit();
+    }
+
+    public boolean isLateLatchEnabled() {
+        return mPrefs.getBoolean(mContext.getString(R.string.settings_key_late_latch), LATE_LATCH_ENABLED);
+    }
+
+    public void setProfilerEnabled(boolean isEnabled) {
+        SharedPreferences.Editor editor = mPrefs.edit();
+        editor.putBoolean(mContext.getString(R.string.settings_key_profiler), isEnabled);
+        editor.commit();
+    }
+
+    public boolean isProfilerEnabled() {
+        return mPrefs.getBoolean(mContext.getString(R.string.settings_key_profiler), PROFILER_ENABLED);
+    }
+
     public int getPrefsLastResetVersionCode() {
         return mPrefs.getInt(mContext.getString(R.string.settings_key_prefs_last_reset_version_code), PREFS_LAST_RESET_VERSION_CODE);
     }
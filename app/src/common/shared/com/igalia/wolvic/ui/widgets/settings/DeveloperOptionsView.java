@@ -77,6 +77,15 @@ class DeveloperOptionsView extends SettingsView {
 
         mBinding.localAddonSwitch.setOnCheckedChangeListener(mLocalAddonListener);
         setLocalAddon(SettingsStore.getInstance(getContext()).isLocalAddonAllowed(), false);
+
+        mBinding.multiviewSwitch.setOnCheckedChangeListener(mMultiviewListener);
+        setMultiview(SettingsStore.getInstance(getContext()).isMultiviewEnabled(), false);
+
+        mBinding.lateLatchSwitch.setOnCheckedChangeListener(mLateLatchListener);
+        setLateLatch(SettingsStore.getInstance(getContext()).isLateLatchEnabled(), false);
+
+        mBinding.profilerSwitch.setOnCheckedChangeListener(mProfilerListener);
+        setProfiler(SettingsStore.getInstance(getContext()).isProfilerEnabled(), false);
     }
 
     private SwitchSetting.OnCheckedChangeListener mRemoteDebuggingListener = (compoundButton, value, doApply) -> {
@@ -107,6 +116,18 @@ class DeveloperOptionsView extends SettingsView {
         setLocalAddon(value, doApply);
     };
 
+    private SwitchSetting.OnCheckedChangeListener mMultiviewListener = (compoundButton, value, doApply) -> {
+        setMultiview(value, doApply);
+    };
+
+    private SwitchSetting.OnCheckedChangeListener mLateLatchListener = (compoundButton, value, doApply) -> {
+        setLateLatch(value, doApply);
+    };
+
+    private SwitchSetting.OnCheckedChangeListener mProfilerListener = (compoundButton, value, doApply) -> {
+        setProfiler(value, doApply);
+    };
+
     private OnClickListener mResetListener = (view) -> {
         boolean restart = false;
         if (mBinding.remoteDebuggingSwitch.isChecked() != SettingsStore.REMOTE_DEBUGGING_DEFAULT) {
@@ -140,6 +161,18 @@ class DeveloperOptionsView extends SettingsView {
             setLocalAddon(SettingsStore.LOCAL_ADDON_ALLOWED, true);
         }
 
+        if (mBinding.multiviewSwitch.isChecked() != SettingsStore.MULTIVIEW_ENABLED) {
+            setMultiview(SettingsStore.MULTIVIEW_ENABLED, true);
+        }
+
+        if (mBinding.lateLatchSwitch.isChecked() != SettingsStore.LATE_LATCH_ENABLED) {
+            setLateLatch(SettingsStore.LATE_LATCH_ENABLED, true);
+        }
+
+        if (mBinding.profilerSwitch.isChecked() != SettingsStore.PROFILER_ENABLED) {
+            setProfiler(SettingsStore.PROFILER_ENABLED, true);
+        }
+
         if (restart) {
             showRestartDialog();
         }
@@ -221,6 +254,36 @@ class DeveloperOptionsView extends SettingsView {
         }
     }
 
+    private void setMultiview(boolean value, boolean doApply) {
+        mBinding.multiviewSwitch.setOnCheckedChangeListener(null);
+        mBinding.multiviewSwitch.setValue(value, false);
+        mBinding.multiviewSwitch.setOnCheckedChangeListener(mMultiviewListener);
+
+        if (doApply) {
+            SettingsStore.getInstance(getContext()).setMultiviewEnabled(value);
+        }
+    }
+
+    private void setLateLatch(boolean value, boolean doApply) {
+        mBinding.lateLatchSwitch.setOnCheckedChangeListener(null);
+        mBinding.lateLatchSwitch.setValue(value, false);
+        mBinding.lateLatchSwitch.setOnCheckedChangeListener(mLateLatchListener);
+
+        if (doApply) {
+            SettingsStore.getInstance(getContext()).setLateLatchEnabled(value);
+        }
+    }
+
+    private void setProfiler(boolean value, boolean doApply) {
+        mBinding.profilerSwitch.setOnCheckedChangeListener(null);
+        mBinding.profilerSwitch.setValue(value, false);
+        mBinding.profilerSwitch.setOnCheckedChangeListener(mProfilerListener);
+
+        if (doApply) {
+            SettingsStore.getInstance(getContext()).setProfilerEnabled(value);
+        }
+    }
+
     @Override
     protected SettingViewType getType() {
         return SettingViewType.LANGUAGE_VOICE;
@@ -7,6 +7,9 @@
 #include "Controller.h"
 #include "ControllerContainer.h"
 #include "FadeAnimation.h"
+#include "GLStateCache.h"
+#include "GPUProfiler.h"
+#include "InputTrace.h"
 #include "Device.h"
 #include "DeviceDelegate.h"
 #include "EngineSurfaceTexture.h"
@@ -15,10 +18,14 @@
 #include "Skybox.h"
 #include "SplashAnimation.h"
 #include "Pointer.h"
+#include "Profiler.h"
+#include "ProgramCache.h"
 #include "Widget.h"
 #include "WidgetMover.h"
 #include "WidgetResizer.h"
+#include "WidgetSpatialIndex.h"
 #include "WidgetPlacement.h"
+#include "WidgetRegistry.h"
 #include "Assertions.h"
 #include "Cylinder.h"
 #include "Quad.h"
@@ -58,7 +65,10 @@
 #include "wvr/wvr_system.h"
 
 #include <android/asset_manager_jni.h>
+#include <algorithm>
 #include <array>
+#include <chrono>
+#include <cstring>
 #include <functional>
 #include <fstream>
 #include <unordered_map>
@@ -85,6 +95,13 @@ const int GestureSwipeRight = 1;
 const float kScrollFactor = 20.0f; // Just picked what fell right.
 const double kHoverRate = 1.0 / 10.0;
 
+// Head motion below these thresholds does not trigger a recomputation of widget depths.
+const float kSortHeadPositionThreshold = 0.005f; // meters
+const float kSortHeadRotationThreshold = 0.99996f; // cosine of ~0.5 degrees
+const uint64_t kSortStatsInterval = 1000; // frames
+const uint64_t kFrameTimeStatsInterval = 1000; // frames
+const uint64_t kFrameWaitStatsInterval = 1000; // frames
+
 // 'azure' color, for active pinch gesture while on hand mode
 static const vrb::Color kPointerColorSelected = vrb::Color(0.0f, 179.0f / 255.0f, 227.0f / 255.0f);
 static const vrb::Color kPointerColorNormal = vrb::Color(1.0f, 1.0f, 1.0f);
@@ -143,6 +160,7 @@ public:
 
 void
 PerformanceObserver::PoorPerformanceDetected(const double& aTargetFrameRate, const double& aAverageFrameRate)  {
+  crow::Profiler::WriteTrace("poor-performance");
   crow::VRBrowser::HandlePoorPerformance();
 }
 
@@ -156,7 +174,10 @@ PerformanceObserver::PerformanceRestored(const double& aTargetFrameRate, const d
 namespace crow {
 struct BrowserWorld::State {
   BrowserWorldWeakPtr self;
-  std::vector<WidgetPtr> widgets;
+  WidgetRegistryPtr widgets;
+  WidgetSpatialIndexPtr widgetIndex;
+  GPUProfilerPtr gpuProfiler;
+  std::vector<WidgetPtr> hitCandidates;
   SurfaceObserverPtr surfaceObserver;
   DeviceDelegatePtr device;
   bool paused;
@@ -177,8 +198,42 @@ struct BrowserWorld::State {
   GroupPtr rootController;
   LightPtr light;
   ControllerContainerPtr controllers;
+  // Devices update the controllers through the recorder, which writes the updates while recording.
+  InputRecorderPtr inputRecorder;
   CullVisitorPtr cullVisitor;
   DrawableListPtr drawList;
+  // Scene culling does not depend on the eye, so TickWorld() culls every root once and both eyes
+  // replay the same lists. The video root toggles its geometry per eye and is culled for each one.
+  enum CullList {
+    CullBackground,
+    CullEnvironment,
+    CullVideoLeft,
+    CullVideoRight,
+    CullTransparent,
+    CullControllers,
+    CullListCount
+  };
+  std::array<DrawableListPtr, CullListCount> cullLists;
+  // The lists hold references to the drawables, so they are emptied as soon as the world is no
+  // longer drawn rather than kept until it is culled again.
+  bool worldCulled = false;
+  struct FrameTimeStats {
+    uint64_t frames = 0;
+    double cullTime = 0.0;
+    double drawTime = 0.0;
+    // Reported by the device for the frames it submitted.
+    uint64_t deviceFrames = 0;
+    uint64_t lastDeviceFrame = 0;
+    uint64_t waitMicroseconds = 0;
+    uint64_t cpuMicroseconds = 0;
+    uint64_t endFrameMicroseconds = 0;
+    int64_t maxPoseToDisplayNanoseconds = 0;
+    uint64_t lateLatchedFrames = 0;
+    uint64_t gpuMicroseconds = 0;
+  };
+  FrameTimeStats frameTimeStats;
+  // ExternalVR transport counters at the last frame wait report, they are logged per interval.
+  ExternalVR::TransportStats reportedTransportStats;
   CameraPtr leftCamera;
   CameraPtr rightCamera;
   float cylinderDensity;
@@ -200,13 +255,35 @@ struct BrowserWorld::State {
   PerformanceMonitorPtr monitor;
   WidgetMoverPtr movingWidget;
   WidgetResizerPtr widgetResizer;
-  std::unordered_map<vrb::Node*, std::pair<Widget*, float>> depthSorting;
+  struct DepthSortEntry {
+    vrb::Node* node = nullptr;
+    Widget* widget = nullptr;
+    float zDelta = 0.0f;
+    float depth = 1.0f;
+    uint32_t revision = 0;
+    bool visible = false;
+  };
+  struct DepthSortStats {
+    uint64_t frames = 0;
+    uint64_t depthUpdates = 0;
+    uint64_t reorders = 0;
+    double time = 0.0;
+  };
+  std::unordered_map<vrb::Node*, Widget*> nodeWidgets;
+  std::vector<DepthSortEntry> depthSorting;
+  std::unordered_map<vrb::Node*, size_t> depthSortingRank;
+  vrb::Matrix lastSortHead;
+  vrb::Matrix lastSortProjection;
+  vrb::Matrix lastSortRoot;
+  bool depthSortingValid = false;
+  DepthSortStats depthSortStats;
   std::function<void(device::Eye)> drawHandler;
   std::function<void()> frameEndHandler;
   bool wasInGazeMode = false;
   WebXRInterstialState webXRInterstialState;
   vrb::Matrix widgetsYaw;
   bool wasWebXRRendering = false;
+  bool immersiveStereoFrame = false;
   double lastBatteryLevelUpdate = -1.0;
   bool reorientRequested = false;
   bool inHeadLockMode = false;
@@ -252,9 +329,16 @@ struct BrowserWorld::State {
     //rootTransparent->AddLight(light);
     cullVisitor = CullVisitor::Create(create);
     drawList = DrawableList::Create(create);
+    for (DrawableListPtr& list: cullLists) {
+      list = DrawableList::Create(create);
+    }
     controllers = ControllerContainer::Create(create, rootTransparent, loader);
+    inputRecorder = InputRecorder::Create(controllers);
     externalVR = ExternalVR::Create();
     blitter = ExternalBlitter::Create(create);
+    widgets = WidgetRegistry::Create();
+    widgetIndex = WidgetSpatialIndex::Create();
+    gpuProfiler = GPUProfiler::Create();
     fadeAnimation = FadeAnimation::Create(create);
     splashAnimation = SplashAnimation::Create(create);
       try {
@@ -290,10 +374,15 @@ struct BrowserWorld::State {
   void HandleControllerScroll(Controller& controller, int handle);
   WidgetPtr GetWidget(int32_t aHandle) const;
   WidgetPtr FindWidget(const std::function<bool(const WidgetPtr&)>& aCondition) const;
-  bool IsParent(const Widget& aChild, const Widget& aParent) const;
-  int ParentCount(const WidgetPtr& aWidget) const;
   float ComputeNormalizedZ(const Widget& aWidget) const;
+  bool SortViewChanged();
   void SortWidgets();
+  void Cull(const vrb::NodePtr& aRoot, DrawableList& aDrawables);
+  void Draw(DrawableList& aDrawables, const Camera& aCamera);
+  void CullWorld();
+  void ResetCullLists();
+  void UpdateFrameTimeStats();
+  void UpdateFrameWaitStats();
   void UpdateWidgetCylinder(const WidgetPtr& aWidget, const float aDensity);
 };
 
@@ -513,7 +602,10 @@ BrowserWorld::State::UpdateControllers(bool& aRelayoutWidgets) {
         hitNormal = normal;
       }
     } else if (controllers->IsVisible()){
-      for (const WidgetPtr& widget: widgets) {
+      // Widgets may have been moved or resized by the previous controller.
+      widgetIndex->Update();
+      widgetIndex->Query(start, direction, hitCandidates);
+      for (const WidgetPtr& widget: hitCandidates) {
         if (controller.focused) {
           if (isResizing && resizingWidget != widget) {
             // Don't interact with other widgets when resizing gesture is active.
@@ -538,6 +630,7 @@ BrowserWorld::State::UpdateControllers(bool& aRelayoutWidgets) {
           }
         }
       }
+      hitCandidates.clear();
     }
 
 
@@ -649,6 +742,7 @@ BrowserWorld::State::UpdateControllers(bool& aRelayoutWidgets) {
         WidgetPlacementPtr updatedPlacement = movingWidget->HandleMove(start, direction);
         if (updatedPlacement) {
           movingWidget->GetWidget()->SetPlacement(updatedPlacement);
+          widgets->SyncParent(movingWidget->GetWidget());
           aRelayoutWidgets = true;
         }
       }
@@ -785,14 +879,12 @@ BrowserWorld::State::ClearWebXRControllerData() {
 
 WidgetPtr
 BrowserWorld::State::GetWidget(int32_t aHandle) const {
-  return FindWidget([=](const WidgetPtr& aWidget){
-    return aWidget->GetHandle() == aHandle;
-  });
+  return widgets->GetWidget((uint32_t) aHandle);
 }
 
 WidgetPtr
 BrowserWorld::State::FindWidget(const std::function<bool(const WidgetPtr&)>& aCondition) const {
-  for (const WidgetPtr & widget: widgets) {
+  for (const WidgetPtr & widget: widgets->GetWidgets()) {
     if (aCondition(widget)) {
       return widget;
     }
@@ -800,35 +892,6 @@ BrowserWorld::State::FindWidget(const std::function<bool(const WidgetPtr&)>& aCo
   return {};
 }
 
-bool
-BrowserWorld::State::IsParent(const Widget& aChild, const Widget& aParent) const {
-  if (aChild.GetPlacement()->parentHandle == aParent.GetHandle()) {
-    return true;
-  }
-
-  if (aChild.GetPlacement()->parentHandle > 0) {
-    WidgetPtr next = GetWidget(aChild.GetPlacement()->parentHandle);
-    if (next) {
-      return IsParent(*next, aParent);
-    }
-  }
-
-  return false;
-}
-
-int
-BrowserWorld::State::ParentCount(const WidgetPtr& aWidget) const {
-  int result = 0;
-  WidgetPtr current = aWidget;
-  while (current && current->GetPlacement()->parentHandle > 0) {
-    current = GetWidget(current->GetPlacement()->parentHandle);
-    if (current) {
-      result++;
-    }
-  }
-  return result;
-}
-
 float
 BrowserWorld::State::ComputeNormalizedZ(const Widget& aWidget) const {
   const vrb::Vector headPosition = device->GetHeadTransform().GetTranslation();
@@ -853,67 +916,280 @@ BrowserWorld::State::ComputeNormalizedZ(const Widget& aWidget) const {
   return ndc.z();
 }
 
+static bool
+MatrixEquals(const vrb::Matrix& aA, const vrb::Matrix& aB) {
+  return memcmp(aA.Data(), aB.Data(), sizeof(float) * 16) == 0;
+}
+
+bool
+BrowserWorld::State::SortViewChanged() {
+  const vrb::Matrix& head = device->GetHeadTransform();
+  const vrb::Matrix& projection = device->GetCamera(device::Eye::Left)->GetPerspective();
+  const vrb::Matrix& root = rootTransparent->GetTransform();
+  bool changed = !depthSortingValid || !MatrixEquals(projection, lastSortProjection) || !MatrixEquals(root, lastSortRoot);
+  if (!changed) {
+    const float distance = (head.GetTranslation() - lastSortHead.GetTranslation()).Magnitude();
+    const vrb::Vector forward = head.MultiplyDirection(vrb::Vector(0.0f, 0.0f, -1.0f)).Normalize();
+    const vrb::Vector lastForward = lastSortHead.MultiplyDirection(vrb::Vector(0.0f, 0.0f, -1.0f)).Normalize();
+    changed = distance > kSortHeadPositionThreshold || forward.Dot(lastForward) < kSortHeadRotationThreshold;
+  }
+  if (changed) {
+    lastSortHead = head;
+    lastSortProjection = projection;
+    lastSortRoot = root;
+  }
+  return changed;
+}
+
 void
 BrowserWorld::State::SortWidgets() {
-  depthSorting.clear();
-
-  // Compute normalized z for each widget
-  for (int i = 0; i < rootTransparent->GetNodeCount(); ++i) {
-    vrb::NodePtr node = rootTransparent->GetNode(i);
-    Widget * target = nullptr;
-    float zDelta = 0.0f;
-    for (const auto & widget: widgets) {
-      if (widget->GetRoot() == node) {
-        target = widget.get();
-        break;
+  const auto startTime = std::chrono::steady_clock::now();
+
+  // Keep the entries in sync with the children of rootTransparent. After a sort both share the same order.
+  const size_t nodeCount = (size_t) rootTransparent->GetNodeCount();
+  bool rebuilt = depthSorting.size() != nodeCount;
+  for (size_t i = 0; !rebuilt && i < nodeCount; ++i) {
+    rebuilt = depthSorting[i].node != rootTransparent->GetNode(i).get();
+  }
+  if (rebuilt) {
+    std::unordered_map<vrb::Node*, DepthSortEntry> previous;
+    for (DepthSortEntry& entry: depthSorting) {
+      previous.emplace(entry.node, std::move(entry));
+    }
+    depthSorting.clear();
+    for (size_t i = 0; i < nodeCount; ++i) {
+      vrb::Node* node = rootTransparent->GetNode(i).get();
+      auto it = previous.find(node);
+      DepthSortEntry entry;
+      if (it != previous.end()) {
+        entry = std::move(it->second);
+        // Force a depth update, the node may have been reused for a different widget.
+        entry.widget = nullptr;
       }
+      entry.node = node;
+      depthSorting.push_back(std::move(entry));
     }
-    if (!target) {
+  }
+
+  const bool viewChanged = SortViewChanged();
+  bool relationsChanged = rebuilt;
+  uint64_t depthUpdates = 0;
+  for (DepthSortEntry& entry: depthSorting) {
+    Widget* target = nullptr;
+    float zDelta = 0.0f;
+    auto it = nodeWidgets.find(entry.node);
+    if (it != nodeWidgets.end()) {
+      target = it->second;
+    } else {
       for (Controller& controller: controllers->GetControllers()) {
-        if (controller.pointer && controller.pointer->GetRoot() == node) {
+        if (controller.pointer && controller.pointer->GetRoot().get() == entry.node) {
           target = controller.pointer->GetHitWidget().get();
           zDelta = 0.02f;
           break;
         }
       }
+      if (!target && widgetResizer && widgetResizer->GetRoot().get() == entry.node) {
+        target = widgetResizer->GetWidget();
+        zDelta = 0.01f;
+      }
     }
 
-    if (!target && widgetResizer && widgetResizer->GetRoot() == node) {
-      target = widgetResizer->GetWidget();
-      zDelta = 0.01f;
-    }
-
-    if (!target || !target->IsVisible()) {
-      depthSorting.emplace(node.get(), std::make_pair(target, 1.0f));
+    const bool visible = target && target->IsVisible();
+    const uint32_t revision = target ? target->GetBoundsRevision() : 0;
+    const bool targetChanged = target != entry.widget || revision != entry.revision;
+    if (!viewChanged && !targetChanged && visible == entry.visible && zDelta == entry.zDelta) {
       continue;
     }
 
-    const float z = ComputeNormalizedZ(*target) - zDelta;
-
-    depthSorting.emplace(node.get(), std::make_pair(target, z));
+    relationsChanged = relationsChanged || targetChanged;
+    entry.widget = target;
+    entry.revision = revision;
+    entry.visible = visible;
+    entry.zDelta = zDelta;
+    entry.depth = visible ? ComputeNormalizedZ(*target) - zDelta : 1.0f;
+    depthUpdates++;
   }
 
-  // Sort nodes based on cached depth values
-  rootTransparent->SortNodes([=](const NodePtr& a, const NodePtr& b) {
-    auto da = depthSorting.find(a.get());
-    auto db = depthSorting.find(b.get());
-    Widget* wa = da->second.first;
-    Widget* wb = db->second.first;
-
-    // Parenting or layer priority sort
-    if (wa && wb && wa->IsVisible() && wb->IsVisible()) {
-      if (IsParent(*wa, *wb)) {
+  // Parenting or layer priority sort, then depth sort.
+  auto before = [this](const DepthSortEntry& a, const DepthSortEntry& b) {
+    if (a.widget && b.widget && a.visible && b.visible) {
+      if (widgets->IsAncestor(a.widget->GetHandle(), b.widget->GetHandle())) {
         return true;
-      } else if (IsParent(*wb, *wa)) {
+      } else if (widgets->IsAncestor(b.widget->GetHandle(), a.widget->GetHandle())) {
         return false;
-      } else if (wa->GetPlacement()->layerPriority != wb->GetPlacement()->layerPriority) {
-        return wa->GetPlacement()->layerPriority > wb->GetPlacement()->layerPriority;
+      } else if (a.widget->GetPlacement()->layerPriority != b.widget->GetPlacement()->layerPriority) {
+        return a.widget->GetPlacement()->layerPriority > b.widget->GetPlacement()->layerPriority;
       }
     }
+    return a.depth < b.depth;
+  };
 
-    // Depth sort
-    return da->second.second < db->second.second;
-  });
+  // The order from the previous frame is almost always still valid, so insertion sort is close to linear.
+  bool reordered = rebuilt;
+  if (depthUpdates > 0 || relationsChanged) {
+    for (size_t i = 1; i < depthSorting.size(); ++i) {
+      size_t j = i;
+      while (j > 0 && before(depthSorting[j], depthSorting[j - 1])) {
+        std::swap(depthSorting[j], depthSorting[j - 1]);
+        reordered = true;
+        j--;
+      }
+    }
+  }
+
+  if (reordered) {
+    depthSortingRank.clear();
+    for (size_t i = 0; i < depthSorting.size(); ++i) {
+      depthSortingRank[depthSorting[i].node] = i;
+    }
+    rootTransparent->SortNodes([=](const NodePtr& a, const NodePtr& b) {
+      return depthSortingRank.at(a.get()) < depthSortingRank.at(b.get());
+    });
+  }
+  depthSortingValid = true;
+
+  depthSortStats.frames++;
+  depthSortStats.depthUpdates += depthUpdates;
+  depthSortStats.reorders += reordered ? 1 : 0;
+  depthSortStats.time += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+  if (depthSortStats.frames >= kSortStatsInterval) {
+    VRB_DEBUG("SortWidgets: %.3f ms/frame, %.1f depth updates/frame, %llu reorders in %llu frames",
+              depthSortStats.time / depthSortStats.frames,
+              (double) depthSortStats.depthUpdates / depthSortStats.frames,
+              (unsigned long long) depthSortStats.reorders, (unsigned long long) depthSortStats.frames);
+    depthSortStats = DepthSortStats();
+  }
+}
+
+void
+BrowserWorld::State::Cull(const vrb::NodePtr& aRoot, DrawableList& aDrawables) {
+  const auto startTime = std::chrono::steady_clock::now();
+  aDrawables.Reset();
+  if (aRoot) {
+    aRoot->Cull(*cullVisitor, aDrawables);
+  }
+  frameTimeStats.cullTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+// The vrb draw path sets the GL state directly, so GLStateCache must read it back afterwards.
+void
+BrowserWorld::State::Draw(DrawableList& aDrawables, const Camera& aCamera) {
+  aDrawables.Draw(aCamera);
+  GLStateCache::Invalidate();
+}
+
+void
+BrowserWorld::State::CullWorld() {
+  if (!device->IsPassthroughEnabled() || device->usesPassthroughCompositorLayer()) {
+    if (device->IsPassthroughEnabled())
+      Cull(rootPassthroughParent, *cullLists[CullBackground]);
+    else
+      Cull(rootOpaqueParent, *cullLists[CullBackground]);
+  } else {
+    cullLists[CullBackground]->Reset();
+  }
+  Cull(rootEnvironment, *cullLists[CullEnvironment]);
+  if (vrVideo) {
+    vrVideo->SelectEye(device::Eye::Left);
+    Cull(vrVideo->GetRoot(), *cullLists[CullVideoLeft]);
+    vrVideo->SelectEye(device::Eye::Right);
+    Cull(vrVideo->GetRoot(), *cullLists[CullVideoRight]);
+  } else {
+    cullLists[CullVideoLeft]->Reset();
+    cullLists[CullVideoRight]->Reset();
+  }
+  Cull(rootTransparent, *cullLists[CullTransparent]);
+  Cull(rootController, *cullLists[CullControllers]);
+  worldCulled = true;
+}
+
+void
+BrowserWorld::State::ResetCullLists() {
+  if (!worldCulled) {
+    return;
+  }
+  for (DrawableListPtr& list: cullLists) {
+    list->Reset();
+  }
+  worldCulled = false;
+}
+
+void
+BrowserWorld::State::UpdateFrameTimeStats() {
+  frameTimeStats.frames++;
+  frameTimeStats.gpuMicroseconds += gpuProfiler->GetFrameMicroseconds();
+  const DeviceDelegate::FrameStats deviceStats = device->GetFrameStats();
+  if (deviceStats.frameIndex != frameTimeStats.lastDeviceFrame) {
+    frameTimeStats.lastDeviceFrame = deviceStats.frameIndex;
+    frameTimeStats.deviceFrames++;
+    frameTimeStats.waitMicroseconds += deviceStats.waitMicroseconds;
+    frameTimeStats.cpuMicroseconds += deviceStats.cpuMicroseconds;
+    frameTimeStats.endFrameMicroseconds += deviceStats.endFrameMicroseconds;
+    frameTimeStats.maxPoseToDisplayNanoseconds =
+        std::max(frameTimeStats.maxPoseToDisplayNanoseconds, deviceStats.poseToDisplayNanoseconds);
+    frameTimeStats.lateLatchedFrames += deviceStats.lateLatched ? 1 : 0;
+  }
+  if (frameTimeStats.frames >= kFrameTimeStatsInterval) {
+    VRB_DEBUG("Frame time: cull %.3f ms/frame, draw %.3f ms/frame, GPU %.3f ms/frame (%llu frames)",
+              frameTimeStats.cullTime / frameTimeStats.frames,
+              frameTimeStats.drawTime / frameTimeStats.frames,
+              frameTimeStats.gpuMicroseconds / 1000.0 / frameTimeStats.frames,
+              (unsigned long long) frameTimeStats.frames);
+    if (frameTimeStats.deviceFrames > 0) {
+      VRB_DEBUG("Device frame: wait %.3f ms, CPU %.3f ms, submit %.3f ms, pose to display < %.3f ms, "
+                "%llu of %llu frames late latched",
+                frameTimeStats.waitMicroseconds / 1000.0 / frameTimeStats.deviceFrames,
+                frameTimeStats.cpuMicroseconds / 1000.0 / frameTimeStats.deviceFrames,
+                frameTimeStats.endFrameMicroseconds / 1000.0 / frameTimeStats.deviceFrames,
+                frameTimeStats.maxPoseToDisplayNanoseconds / 1000000.0,
+                (unsigned long long) frameTimeStats.lateLatchedFrames,
+                (unsigned long long) frameTimeStats.deviceFrames);
+    }
+    const VRBrowser::EventStats& eventStats = VRBrowser::GetEventStats();
+    if (eventStats.frames > 0) {
+      VRB_DEBUG("Java events: %.2f events/frame, %.2f coalesced/frame, %.2f JNI calls/frame",
+                (double) eventStats.totalEvents / eventStats.frames,
+                (double) eventStats.totalCoalescedEvents / eventStats.frames,
+                (double) eventStats.totalJNICalls / eventStats.frames);
+      VRBrowser::ResetEventStats();
+    }
+    const DeviceDelegate::LayerStats layerStats = device->GetLayerStats();
+    if (layerStats.frames > 0) {
+      VRB_DEBUG("Layers: %u of %u UI layers submitted (%u rebuilt, %u reused), %u layers in total, "
+                "%llu of %llu frames over budget, %u widgets drawn in the projection layer",
+                layerStats.submittedUILayers, layerStats.requestedLayers, layerStats.rebuiltLayers,
+                layerStats.reusedLayers, layerStats.submittedLayers, (unsigned long long) layerStats.framesWithDroppedLayers,
+                (unsigned long long) layerStats.frames, layerStats.fallbackLayers);
+    }
+    const uint64_t lastDeviceFrame = frameTimeStats.lastDeviceFrame;
+    frameTimeStats = FrameTimeStats();
+    frameTimeStats.lastDeviceFrame = lastDeviceFrame;
+  }
+}
+
+void
+BrowserWorld::State::UpdateFrameWaitStats() {
+  const ExternalVR::FrameWaitStats& stats = externalVR->GetFrameWaitStats();
+  if (stats.frames < kFrameWaitStatsInterval) {
+    return;
+  }
+  // Upper bound of the bucket holding the median wait.
+  uint64_t count = 0;
+  int median = 0;
+  while (median < ExternalVR::kFrameWaitBucketCount - 1 && (count += stats.buckets[median]) * 2 < stats.frames) {
+    median++;
+  }
+  const ExternalVR::TransportStats& transportStats = externalVR->GetTransportStats();
+  VRB_DEBUG("WebXR frame wait: %.3f ms/frame, median < %u us, max %llu us, %llu timeouts (%llu frames), "
+            "%llu contended locks, %.1f KB of system state copied, %llu bytes by the last push",
+            stats.totalMicroseconds / 1000.0 / stats.frames, ExternalVR::kFrameWaitBucketBase << median,
+            (unsigned long long) stats.maxMicroseconds, (unsigned long long) stats.timeouts,
+            (unsigned long long) stats.frames,
+            (unsigned long long) (transportStats.contended - reportedTransportStats.contended),
+            (transportStats.bytesCopied - reportedTransportStats.bytesCopied) / 1024.0,
+            (unsigned long long) transportStats.lastBytesCopied);
+  reportedTransportStats = transportStats;
+  externalVR->ResetFrameWaitStats();
 }
 
 void
@@ -974,7 +1250,7 @@ BrowserWorld::RegisterDeviceDelegate(DeviceDelegatePtr aDelegate) {
     m.device->SetClearColor(vrb::Color(0.0f, 0.0f, 0.0f, 0.0f));
     m.leftCamera = m.device->GetCamera(device::Eye::Left);
     m.rightCamera = m.device->GetCamera(device::Eye::Right);
-    ControllerDelegatePtr delegate = m.controllers;
+    ControllerDelegatePtr delegate = m.inputRecorder;
     delegate->SetGazeModeIndex(m.device->GazeModeIndex());
     m.device->SetClipPlanes(m.nearClip, m.farClip);
     m.device->SetControllerDelegate(delegate);
@@ -993,6 +1269,7 @@ void
 BrowserWorld::Pause() {
   ASSERT_ON_RENDER_THREAD();
   m.paused = true;
+  Profiler::WriteTrace("pause");
   m.externalVR->OnPause();
   m.monitor->Pause();
 }
@@ -1038,6 +1315,11 @@ BrowserWorld::InitializeJava(JNIEnv* aEnv, jobject& aActivity, jobject& aAssetMa
 
   VRBrowser::InitializeJava(m.env, m.activity);
   EngineSurfaceTexture::InitializeJava(m.env, m.activity);
+  // Set before InitializeGL() so that the programs built at startup can be loaded from the cache.
+  const std::string cachePath = VRBrowser::GetCacheAbsolutePath();
+  if (!cachePath.empty()) {
+    ProgramCache::SetPath(cachePath + "/programs");
+  }
   m.loader->InitializeJava(aEnv, aActivity, aAssetManager);
   VRBrowser::SetDeviceType(m.device->GetDeviceType());
 
@@ -1092,24 +1374,26 @@ BrowserWorld::InitializeJava(JNIEnv* aEnv, jobject& aActivity, jobject& aAssetMa
 void
 BrowserWorld::InitializeGL() {
   ASSERT_ON_RENDER_THREAD();
+  Profiler::SetThreadName("Render");
   VRB_LOG("BrowserWorld::InitializeGL");
   if (m.context) {
     if (!m.glInitialized) {
       m.glInitialized = m.context->InitializeGL();
-      VRB_GL_CHECK(glEnable(GL_BLEND));
-      VRB_GL_CHECK(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
-      VRB_GL_CHECK(glEnable(GL_DEPTH_TEST));
-      VRB_GL_CHECK(glEnable(GL_CULL_FACE));
+      GLStateCache::SetEnabled(GL_BLEND, true);
+      GLStateCache::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+      GLStateCache::SetEnabled(GL_DEPTH_TEST, true);
+      GLStateCache::SetEnabled(GL_CULL_FACE, true);
       if (!m.glInitialized) {
         return;
       }
+      m.gpuProfiler->InitializeGL();
       if (m.splashAnimation) {
         m.splashAnimation->Load(m.context, m.device);
       }
       // delay the m.loader->InitializeGL() call to fix some issues with Daydream activities
       m.loaderDelay = 3;
       SurfaceTextureFactoryPtr factory = m.context->GetSurfaceTextureFactory();
-      for (WidgetPtr& widget: m.widgets) {
+      for (const WidgetPtr& widget: m.widgets->GetWidgets()) {
         const std::string name = widget->GetSurfaceTextureName();
         jobject surface = factory->LookupSurfaceTexture(name);
         if (surface) {
@@ -1143,9 +1427,13 @@ BrowserWorld::ShutdownGL() {
   if (m.loader) {
     m.loader->ShutdownGL();
   }
+  m.gpuProfiler->ShutdownGL();
+  m.ResetCullLists();
+  m.drawList->Reset();
   if (m.context) {
     m.context->ShutdownGL();
   }
+  GLStateCache::Invalidate();
   m.glInitialized = false;
 }
 
@@ -1194,6 +1482,7 @@ BrowserWorld::ProcessOVRPlatformEvents() {
 void
 BrowserWorld::StartFrame() {
   ASSERT_ON_RENDER_THREAD();
+  PROFILE_SCOPE("StartFrame");
   if (!m.device) {
     VRB_WARN("No device");
     return;
@@ -1208,7 +1497,11 @@ BrowserWorld::StartFrame() {
       VRB_LOG("Failed to initialize GL");
       return;
     }
+    m.gpuProfiler->InitializeGL();
   }
+  // The device and the vrb engine may have changed the GL state since the last frame.
+  GLStateCache::Invalidate();
+  m.gpuProfiler->BeginFrame();
   if (m.loaderDelay > 0) {
     m.loaderDelay--;
     if (m.loaderDelay == 0) {
@@ -1221,7 +1514,11 @@ BrowserWorld::StartFrame() {
   ProcessOVRPlatformEvents();
 #endif
 #endif
-  m.device->ProcessEvents();
+  {
+    PROFILE_SCOPE("ProcessEvents");
+    m.device->ProcessEvents();
+  }
+  m.inputRecorder->CommitFrame(m.device->GetHeadTransform());
   m.context->Update();
   m.externalVR->PullBrowserState();
   m.externalVR->SetHapticState(m.controllers);
@@ -1238,15 +1535,20 @@ BrowserWorld::StartFrame() {
   };
 
   if (m.splashAnimation) {
+    m.ResetCullLists();
     TickSplashAnimation();
   } else if (m.externalVR->IsPresenting()) {
+    m.ResetCullLists();
     m.CheckBackButton();
     createPassthroughLayerIfNeeded();
     TickImmersive();
   } else {
     bool relayoutWidgets = false;
     m.UpdateGazeModeState();
-    m.UpdateControllers(relayoutWidgets);
+    {
+      PROFILE_SCOPE("UpdateControllers");
+      m.UpdateControllers(relayoutWidgets);
+    }
     if (m.inHeadLockMode) {
       OnReorient();
       m.device->Reorient();
@@ -1265,20 +1567,24 @@ BrowserWorld::StartFrame() {
 void
 BrowserWorld::EndFrame() {
   ASSERT_ON_RENDER_THREAD();
+  PROFILE_SCOPE("EndFrame");
 
   if (m.frameEndHandler) {
     m.frameEndHandler();
     m.frameEndHandler = nullptr;
   } else {
+    PROFILE_SCOPE("DeviceEndFrame");
     m.device->EndFrame();
   }
   m.drawHandler = nullptr;
+  m.UpdateFrameTimeStats();
 
   // Update the 3d audio engine with the most recent head rotation.
   const vrb::Matrix &head = m.device->GetHeadTransform();
   const vrb::Vector p = head.GetTranslation();
   const vrb::Quaternion q(head);
   VRBrowser::HandleAudioPose(q.x(), q.y(), q.z(), q.w(), p.x(), p.y(), p.z());
+  VRBrowser::FlushEvents();
 }
 
 void
@@ -1299,8 +1605,11 @@ BrowserWorld::TriggerHapticFeedback(const float aPulseDuration, const float aPul
 void
 BrowserWorld::Draw(device::Eye aEye) {
   ASSERT_ON_RENDER_THREAD();
+  PROFILE_SCOPE(aEye == device::Eye::Left ? "DrawLeft" : "DrawRight");
   if (m.drawHandler) {
+    const auto startTime = std::chrono::steady_clock::now();
     m.drawHandler(aEye);
+    m.frameTimeStats.drawTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
   }
 }
 
@@ -1309,6 +1618,17 @@ BrowserWorld::SetTemporaryFilePath(const std::string& aPath) {
   ASSERT_ON_RENDER_THREAD();
   VRB_LOG("Got temp path: %s", aPath.c_str());
   m.context->GetDataCache()->SetCachePath(aPath);
+  Profiler::SetTracePath(aPath);
+}
+
+void
+BrowserWorld::SetInputRecordingPath(const std::string& aPath) {
+  ASSERT_ON_RENDER_THREAD();
+  if (aPath.empty()) {
+    m.inputRecorder->Stop();
+  } else {
+    m.inputRecorder->Start(aPath);
+  }
 }
 
 void
@@ -1426,12 +1746,16 @@ BrowserWorld::AddWidget(int32_t aHandle, const WidgetPlacementPtr& aPlacement) {
   switch (aPlacement->GetScene()) {
       case WidgetPlacement::Scene::ROOT_TRANSPARENT:
         m.rootTransparent->AddNode(widget->GetRoot());
+        m.nodeWidgets[widget->GetRoot().get()] = widget.get();
+        m.widgetIndex->AddWidget(widget, m.rootTransparent);
         break;
       case WidgetPlacement::Scene::ROOT_OPAQUE:
         m.rootOpaque->AddNode(widget->GetRoot());
+        m.widgetIndex->AddWidget(widget, m.rootOpaque);
         break;
       case WidgetPlacement::Scene::WEBXR_INTERSTITIAL:
         m.webXRInterstitialWidget->AddNode(widget->GetRoot());
+        m.widgetIndex->AddWidget(widget, m.webXRInterstitialWidget);
         if(m.webXRInterstitialBackground == nullptr){
               m.webXRInterstitialBackground = createSphereBackground( m.create);
               m.rootWebXRInterstitial->AddNode(m.webXRInterstitialBackground);
@@ -1439,7 +1763,7 @@ BrowserWorld::AddWidget(int32_t aHandle, const WidgetPlacementPtr& aPlacement) {
         break;
   }
 
-  m.widgets.push_back(widget);
+  m.widgets->AddWidget(widget);
   UpdateWidget(widget->GetHandle(), aPlacement);
 }
 
@@ -1460,6 +1784,7 @@ BrowserWorld::UpdateWidget(int32_t aHandle, const WidgetPlacementPtr& aPlacement
   }
 
   widget->SetPlacement(aPlacement);
+  m.widgets->SyncParent(widget);
   m.UpdateWidgetCylinder(widget, m.cylinderDensity);
   widget->ToggleWidget(aPlacement->visible);
   widget->SetSurfaceTextureSize(aPlacement->GetTextureWidth(), aPlacement->GetTextureHeight());
@@ -1484,10 +1809,10 @@ BrowserWorld::UpdateWidget(int32_t aHandle, const WidgetPlacementPtr& aPlacement
 void
 BrowserWorld::UpdateWidgetRecursive(int32_t aHandle, const WidgetPlacementPtr& aPlacement) {
   UpdateWidget(aHandle, aPlacement);
-  for (WidgetPtr& widget: m.widgets) {
-    if (widget->GetPlacement() && widget->GetPlacement()->parentHandle == aHandle) {
-      UpdateWidgetRecursive(widget->GetHandle(), widget->GetPlacement());
-    }
+  // Copy the list, updating a child may change its parent.
+  const std::vector<WidgetPtr> children = m.widgets->GetChildren((uint32_t) aHandle);
+  for (const WidgetPtr& widget: children) {
+    UpdateWidgetRecursive(widget->GetHandle(), widget->GetPlacement());
   }
 }
 
@@ -1498,10 +1823,9 @@ BrowserWorld::RemoveWidget(int32_t aHandle) {
   if (widget) {
     widget->ResetFirstDraw();
     widget->GetRoot()->RemoveFromParents();
-    auto it = std::find(m.widgets.begin(), m.widgets.end(), widget);
-    if (it != m.widgets.end()) {
-      m.widgets.erase(it);
-    }
+    m.widgets->RemoveWidget(widget);
+    m.widgetIndex->RemoveWidget(widget);
+    m.nodeWidgets.erase(widget->GetRoot().get());
     if (widget->GetLayer()) {
       m.device->DeleteLayer(widget->GetLayer());
     }
@@ -1601,17 +1925,8 @@ void
 BrowserWorld::UpdateVisibleWidgets() {
   ASSERT_ON_RENDER_THREAD();
 
-  std::vector<WidgetPtr> widgets = m.widgets;
-  // Sort by parent before updating.
-  std::sort(widgets.begin(), widgets.end(), [=](const WidgetPtr& a, const WidgetPtr& b) {
-    int parentsA = m.ParentCount(a);
-    int parentsB = m.ParentCount(b);
-    if (parentsA != parentsB) {
-      return parentsA < parentsB;
-    }
-    return m.IsParent(*b, *a);
-  });
-
+  // Parents are laid out before their children. Copy the order, updating widgets may invalidate it.
+  const std::vector<WidgetPtr> widgets = m.widgets->GetTopologicalOrder();
   for (const WidgetPtr& widget: widgets) {
     if (widget->IsVisible() && !widget->IsResizing()) {
       UpdateWidget(widget->GetHandle(), widget->GetPlacement());
@@ -1771,7 +2086,7 @@ BrowserWorld::RecenterUIYaw(const YawTarget aTarget) {
 void
 BrowserWorld::SetCylinderDensity(const float aDensity) {
   m.cylinderDensity = aDensity;
-  for (WidgetPtr& widget: m.widgets) {
+  for (const WidgetPtr& widget: m.widgets->GetWidgets()) {
     m.UpdateWidgetCylinder(widget, aDensity);
   }
 }
@@ -1781,6 +2096,21 @@ BrowserWorld::SetCPULevel(const device::CPULevel aLevel) {
   m.device->SetCPULevel(aLevel);
 }
 
+void
+BrowserWorld::SetMultiviewEnabled(const bool aEnabled) {
+  m.device->SetMultiviewEnabled(aEnabled);
+}
+
+void
+BrowserWorld::SetLateLatchEnabled(const bool aEnabled) {
+  m.device->SetLateLatchEnabled(aEnabled);
+}
+
+void
+BrowserWorld::SetProfilerEnabled(const bool aEnabled) {
+  Profiler::SetEnabled(aEnabled);
+}
+
 void
 BrowserWorld::SetWebXRInterstitalState(const WebXRInterstialState aState) {
   m.webXRInterstialState = aState;
@@ -1820,6 +2150,7 @@ BrowserWorld::BrowserWorld(State& aState) : m(aState) {}
 
 void
 BrowserWorld::TickWorld() {
+  PROFILE_SCOPE("TickWorld");
   m.externalVR->SetCompositorEnabled(true);
   m.device->SetRenderMode(device::RenderMode::StandAlone);
   if (m.fadeAnimation) {
@@ -1830,10 +2161,18 @@ BrowserWorld::TickWorld() {
     m.skybox->SetTransform(vrb::Matrix::Translation(headPosition));
   }
 
-  m.SortWidgets();
-  m.device->StartFrame();
-  if (!m.device->ShouldRender())
+  {
+    PROFILE_SCOPE("SortWidgets");
+    m.SortWidgets();
+  }
+  {
+    PROFILE_SCOPE("DeviceStartFrame");
+    m.device->StartFrame();
+  }
+  if (!m.device->ShouldRender()) {
+    m.ResetCullLists();
     return;
+  }
 
   m.rootOpaque->SetTransform(m.device->GetReorientTransform());
   m.rootTransparent->SetTransform(m.device->GetReorientTransform().PostMultiply(m.widgetsYaw));
@@ -1843,6 +2182,10 @@ BrowserWorld::TickWorld() {
   if (m.vrVideo) {
     m.vrVideo->SetReorientTransform(m.device->GetReorientTransform());
   }
+  {
+    PROFILE_SCOPE("Cull");
+    m.CullWorld();
+  }
 
   m.drawHandler = [=](device::Eye aEye) {
     DrawWorld(aEye);
@@ -1856,64 +2199,65 @@ BrowserWorld::DrawWorld(device::Eye aEye) {
   m.device->BindEye(aEye);
 
   // Draw skybox or passthrough layer.
-  if (!m.device->IsPassthroughEnabled() || m.device->usesPassthroughCompositorLayer()) {
-    m.drawList->Reset();
-    if (m.device->IsPassthroughEnabled())
-      m.rootPassthroughParent->Cull(*m.cullVisitor, *m.drawList);
-    else
-      m.rootOpaqueParent->Cull(*m.cullVisitor, *m.drawList);
-      m.drawList->Draw(*camera);
+  {
+    GPUProfilerScope gpuPass(m.gpuProfiler, "Background");
+    m.Draw(*m.cullLists[State::CullBackground], *camera);
   }
 
   // Draw environment if available
-  if (m.layerEnvironment) {
-    m.layerEnvironment->SetCurrentEye(aEye);
-    m.layerEnvironment->Bind();
-    VRB_GL_CHECK(glViewport(0, 0, m.layerEnvironment->GetWidth(), m.layerEnvironment->GetHeight()));
-    VRB_GL_CHECK(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
-  }
-  if (m.rootEnvironment) {
-    m.drawList->Reset();
-    m.rootEnvironment->Cull(*m.cullVisitor, *m.drawList);
-    m.drawList->Draw(*camera);
-  }
-  if (m.layerEnvironment) {
-    m.layerEnvironment->Unbind();
+  if (m.layerEnvironment || m.rootEnvironment) {
+    GPUProfilerScope gpuPass(m.gpuProfiler, "Environment");
+    if (m.layerEnvironment) {
+      m.layerEnvironment->SetCurrentEye(aEye);
+      m.layerEnvironment->Bind();
+      VRB_GL_CHECK(glViewport(0, 0, m.layerEnvironment->GetWidth(), m.layerEnvironment->GetHeight()));
+      VRB_GL_CHECK(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+    }
+    if (m.rootEnvironment) {
+      m.Draw(*m.cullLists[State::CullEnvironment], *camera);
+    }
+    if (m.layerEnvironment) {
+      m.layerEnvironment->Unbind();
+    }
   }
 
   // Draw equirect video
   if (m.vrVideo) {
+    GPUProfilerScope gpuPass(m.gpuProfiler, "VRVideo");
     m.vrVideo->SelectEye(aEye);
-    m.drawList->Reset();
-    m.vrVideo->GetRoot()->Cull(*m.cullVisitor, *m.drawList);
-    m.drawList->Draw(*camera);
+    m.Draw(*m.cullLists[aEye == device::Eye::Left ? State::CullVideoLeft : State::CullVideoRight], *camera);
   }
 
   // Draw hand mesh if active
-  for (Controller& controller: m.controllers->GetControllers()) {
-    if (controller.enabled && controller.mode == ControllerMode::Hand)
-      m.device->DrawHandMesh(controller.index, *camera);
+  {
+    GPUProfilerScope gpuPass(m.gpuProfiler, "HandMesh");
+    for (Controller& controller: m.controllers->GetControllers()) {
+      if (controller.enabled && controller.mode == ControllerMode::Hand)
+        m.device->DrawHandMesh(controller.index, *camera);
+    }
   }
 
   //Christ: re-order draw order to ensure controllers be draw after widges
   // Draw widges
-  m.drawList->Reset();
-  m.rootTransparent->Cull(*m.cullVisitor, *m.drawList);
-  GLboolean depthMask = GL_TRUE;
-  VRB_GL_CHECK(glGetBooleanv(GL_DEPTH_WRITEMASK, &depthMask));
-  VRB_GL_CHECK(glDepthMask(GL_FALSE));
-  m.drawList->Draw(*camera);
-  VRB_GL_CHECK(glDepthMask(depthMask));
+  {
+    GPUProfilerScope gpuPass(m.gpuProfiler, "Widgets");
+    const GLboolean depthMask = GLStateCache::GetDepthMask();
+    GLStateCache::DepthMask(GL_FALSE);
+    m.Draw(*m.cullLists[State::CullTransparent], *camera);
+    GLStateCache::DepthMask(depthMask);
+  }
 
   //Draw controllers
-  m.drawList->Reset();
-  m.rootController->Cull(*m.cullVisitor, *m.drawList);
-  m.drawList->Draw(*camera);
+  {
+    GPUProfilerScope gpuPass(m.gpuProfiler, "Controllers");
+    m.Draw(*m.cullLists[State::CullControllers], *camera);
+  }
 
 }
 
 void
 BrowserWorld::TickImmersive() {
+  PROFILE_SCOPE("TickImmersive");
   m.externalVR->SetCompositorEnabled(false);
   m.device->SetRenderMode(device::RenderMode::Immersive);
   m.device->SetImmersiveBlendMode(m.externalVR->GetImmersiveBlendMode());
@@ -1934,7 +2278,12 @@ BrowserWorld::TickImmersive() {
   }
   int32_t surfaceHandle, textureWidth, textureHeight = 0;
   device::EyeRect leftEye, rightEye;
-  bool aDiscardFrame = !m.externalVR->WaitFrameResult();
+  bool aDiscardFrame;
+  {
+    PROFILE_SCOPE("WaitFrameResult");
+    aDiscardFrame = !m.externalVR->WaitFrameResult();
+  }
+  m.UpdateFrameWaitStats();
   m.externalVR->GetFrameResult(surfaceHandle, textureWidth, textureHeight, leftEye, rightEye);
   ExternalVR::VRState state = m.externalVR->GetVRState();
   if (supportsFrameAhead) {
@@ -1988,7 +2337,19 @@ BrowserWorld::TickImmersive() {
 void
 BrowserWorld::DrawImmersive(device::Eye aEye) {
   ASSERT(m.device->ShouldRender());
+  if (aEye == device::Eye::Left) {
+    m.immersiveStereoFrame = m.blitter->IsStereoDrawSupported() && m.device->BindStereo();
+    if (m.immersiveStereoFrame) {
+      GPUProfilerScope gpuPass(m.gpuProfiler, "ExternalBlitStereo");
+      m.blitter->DrawStereo();
+      return;
+    }
+  } else if (m.immersiveStereoFrame) {
+    // Both eyes were blitted in a single pass.
+    return;
+  }
   m.device->BindEye(aEye);
+  GPUProfilerScope gpuPass(m.gpuProfiler, "ExternalBlit");
   m.blitter->Draw(aEye);
 }
 
@@ -1998,6 +2359,7 @@ BrowserWorld::TickWebXRInterstitial() {
     return;
 
   m.rootWebXRInterstitial->SetTransform(m.device->GetReorientTransform());
+  m.Cull(m.rootWebXRInterstitial, *m.drawList);
   m.drawHandler = [=](device::Eye eye) {
       DrawWebXRInterstitial(eye);
   };
@@ -2008,11 +2370,9 @@ BrowserWorld::DrawWebXRInterstitial(crow::device::Eye aEye) {
   ASSERT(m.device->ShouldRender());
   const CameraPtr camera = aEye == device::Eye::Left ? m.leftCamera : m.rightCamera;
   m.device->BindEye(aEye);
-  VRB_GL_CHECK(glDepthMask(GL_FALSE));
-  m.drawList->Reset();
-  m.rootWebXRInterstitial->Cull(*m.cullVisitor, *m.drawList);
-  m.drawList->Draw(*camera);
-  VRB_GL_CHECK(glDepthMask(GL_TRUE));
+  GLStateCache::DepthMask(GL_FALSE);
+  m.Draw(*m.drawList, *camera);
+  GLStateCache::DepthMask(GL_TRUE);
 }
 
 void
@@ -2025,6 +2385,7 @@ BrowserWorld::TickSplashAnimation() {
     return;
 
   const bool animationFinished = m.splashAnimation->Update(m.device->GetHeadTransform());
+  m.Cull(m.splashAnimation->GetRoot(), *m.drawList);
   m.drawHandler = [=](device::Eye aEye) {
     DrawSplashAnimation(aEye);
   };
@@ -2045,11 +2406,9 @@ BrowserWorld::TickSplashAnimation() {
 void
 BrowserWorld::DrawSplashAnimation(device::Eye aEye) {
   ASSERT(m.device->ShouldRender());
-  m.drawList->Reset();
-  m.splashAnimation->GetRoot()->Cull(*m.cullVisitor, *m.drawList);
-
   m.device->BindEye(aEye);
-  m.drawList->Draw(aEye == device::Eye::Left ? *m.leftCamera : *m.rightCamera);
+  GPUProfilerScope gpuPass(m.gpuProfiler, "SplashAnimation");
+  m.Draw(*m.drawList, aEye == device::Eye::Left ? *m.leftCamera : *m.rightCamera);
 }
 
 void
@@ -2256,6 +2615,14 @@ JNI_METHOD(void, setTemporaryFilePath)
   crow::BrowserWorld::Instance().SetTemporaryFilePath(path);
 }
 
+JNI_METHOD(void, setInputRecordingPathNative)
+(JNIEnv* aEnv, jobject, jstring aPath) {
+  const char *nativeString = aEnv->GetStringUTFChars(aPath, nullptr);
+  std::string path = nativeString;
+  aEnv->ReleaseStringUTFChars(aPath, nativeString);
+  crow::BrowserWorld::Instance().SetInputRecordingPath(path);
+}
+
 JNI_METHOD(void, togglePassthroughNative)
 (JNIEnv*, jobject) {
   crow::BrowserWorld::Instance().TogglePassthrough();
@@ -2346,6 +2713,21 @@ JNI_METHOD(void, setCPULevelNative)
   crow::BrowserWorld::Instance().SetCPULevel(static_cast<crow::device::CPULevel>(aCPULevel));
 }
 
+JNI_METHOD(void, setMultiviewEnabledNative)
+(JNIEnv*, jobject, jboolean aEnabled) {
+  crow::BrowserWorld::Instance().SetMultiviewEnabled(aEnabled);
+}
+
+JNI_METHOD(void, setLateLatchEnabledNative)
+(JNIEnv*, jobject, jboolean aEnabled) {
+  crow::BrowserWorld::Instance().SetLateLatchEnabled(aEnabled);
+}
+
+JNI_METHOD(void, setProfilerEnabledNative)
+(JNIEnv*, jobject, jboolean aEnabled) {
+  crow::BrowserWorld::Instance().SetProfilerEnabled(aEnabled);
+}
+
 JNI_METHOD(void, setWebXRIntersitialStateNative)
 (JNIEnv*, jobject, jint aState) {
   crow::BrowserWorld::WebXRInterstialState value;
@@ -51,6 +51,8 @@ public:
   void TogglePassthrough();
   void SetHeadLockEnabled(const bool isEnabled);
   void SetTemporaryFilePath(const std::string& aPath);
+  // Records the controller input to aPath until it is called with an empty path.
+  void SetInputRecordingPath(const std::string& aPath);
   void UpdateEnvironment();
   void UpdatePointerColor();
   void SetSurfaceTexture(const std::string& aName, jobject& aSurface);
@@ -77,6 +79,9 @@ public:
   void SetWebXRInterstitalState(const WebXRInterstialState aState);
   void SetIsServo(const bool aIsServo);
   void SetCPULevel(const device::CPULevel aLevel);
+  void SetMultiviewEnabled(const bool aEnabled);
+  void SetLateLatchEnabled(const bool aEnabled);
+  void SetProfilerEnabled(const bool aEnabled);
   JNIEnv* GetJNIEnv() const;
   void OnReorient() override;
 #if HVR
@@ -31,6 +31,9 @@ using namespace vrb;
 
 namespace crow {
 
+static_assert(ControllerInputState::kMaxAxes == kControllerMaxAxes,
+              "ControllerInputState must hold every axis of a Controller, and no more");
+
 struct ControllerContainer::State {
   std::vector<Controller> list;
   CreationContextWeak context;
@@ -62,6 +65,50 @@ struct ControllerContainer::State {
     return (aControllerIndex >= 0) && (aControllerIndex < list.size());
   }
 
+  static void UpdateButton(Controller& aController, const Button aWhichButton, const int32_t aImmersiveIndex,
+                           const bool aPressed, const bool aTouched, const float aImmersiveTrigger) {
+    assert(kControllerMaxButtonCount > aImmersiveIndex
+           && "Button index must < kControllerMaxButtonCount.");
+
+    const int32_t immersiveButtonMask = 1 << aImmersiveIndex;
+
+    if (aPressed) {
+      aController.buttonState |= aWhichButton;
+    } else {
+      aController.buttonState &= ~aWhichButton;
+    }
+
+    if (aImmersiveIndex >= 0) {
+      if (aPressed) {
+        aController.immersivePressedState |= immersiveButtonMask;
+      } else {
+        aController.immersivePressedState &= ~immersiveButtonMask;
+      }
+
+      if (aTouched) {
+        aController.immersiveTouchedState |= immersiveButtonMask;
+      } else {
+        aController.immersiveTouchedState &= ~immersiveButtonMask;
+      }
+
+      float trigger = aImmersiveTrigger;
+      if (trigger < 0.0f) {
+        trigger = aPressed ? 1.0f : 0.0f;
+      }
+      aController.immersiveTriggerValues[aImmersiveIndex] = trigger;
+    }
+  }
+
+  static void UpdateAxes(Controller& aController, const float* aData, const uint32_t aLength) {
+    assert(kControllerMaxAxes >= aLength
+           && "Axis length must <= kControllerMaxAxes.");
+
+    aController.numAxes = aLength;
+    for (int i = 0; i < aLength; ++i) {
+      aController.immersiveAxes[i] = aData[i];
+    }
+  }
+
   void SetUpModelsGroup(const int32_t aModelIndex) {
     if (aModelIndex >= models.size()) {
       models.resize((size_t)(aModelIndex + 1));
@@ -562,54 +609,43 @@ ControllerContainer::SetButtonCount(const int32_t aControllerIndex, const uint32
 
 void
 ControllerContainer::SetButtonState(const int32_t aControllerIndex, const Button aWhichButton, const int32_t aImmersiveIndex, const bool aPressed, const bool aTouched, const float aImmersiveTrigger) {
-  assert(kControllerMaxButtonCount > aImmersiveIndex
-         && "Button index must < kControllerMaxButtonCount.");
-
   if (!m.Contains(aControllerIndex)) {
     return;
   }
-
-  const int32_t immersiveButtonMask = 1 << aImmersiveIndex;
-
-  if (aPressed) {
-    m.list[aControllerIndex].buttonState |= aWhichButton;
-  } else {
-    m.list[aControllerIndex].buttonState &= ~aWhichButton;
-  }
-
-  if (aImmersiveIndex >= 0) {
-    if (aPressed) {
-      m.list[aControllerIndex].immersivePressedState |= immersiveButtonMask;
-    } else {
-      m.list[aControllerIndex].immersivePressedState &= ~immersiveButtonMask;
-    }
-
-    if (aTouched) {
-      m.list[aControllerIndex].immersiveTouchedState |= immersiveButtonMask;
-    } else {
-      m.list[aControllerIndex].immersiveTouchedState &= ~immersiveButtonMask;
-    }
-
-    float trigger = aImmersiveTrigger;
-    if (trigger < 0.0f) {
-      trigger = aPressed ? 1.0f : 0.0f;
-    }
-    m.list[aControllerIndex].immersiveTriggerValues[aImmersiveIndex] = trigger;
-  }
+  State::UpdateButton(m.list[aControllerIndex], aWhichButton, aImmersiveIndex, aPressed, aTouched, aImmersiveTrigger);
 }
 
 void
 ControllerContainer::SetAxes(const int32_t aControllerIndex, const float* aData, const uint32_t aLength) {
-  assert(kControllerMaxAxes >= aLength
-         && "Axis length must <= kControllerMaxAxes.");
-
   if (!m.Contains(aControllerIndex)) {
     return;
   }
+  State::UpdateAxes(m.list[aControllerIndex], aData, aLength);
+}
 
-  m.list[aControllerIndex].numAxes = aLength;
-  for (int i = 0; i < aLength; ++i) {
-    m.list[aControllerIndex].immersiveAxes[i] = aData[i];
+void
+ControllerContainer::SetInputState(const int32_t aControllerIndex, const ControllerInputState& aState) {
+  if (!m.Contains(aControllerIndex)) {
+    return;
+  }
+  Controller& controller = m.list[aControllerIndex];
+  for (uint32_t i = 0; i < aState.buttonStateCount; ++i) {
+    const ControllerInputState::ButtonState& button = aState.buttons[i];
+    State::UpdateButton(controller, button.button, button.immersiveIndex, button.pressed, button.touched, button.value);
+  }
+  controller.numButtons = aState.buttonCount;
+  State::UpdateAxes(controller, aState.axes, aState.axisCount);
+  if (aState.hasSelectFactor) {
+    controller.selectFactor = aState.selectFactor;
+  }
+  if (aState.hasTouch) {
+    controller.touched = !aState.touchEnded;
+    controller.touchX = aState.touchEnded ? 0.0f : aState.touchX;
+    controller.touchY = aState.touchEnded ? 0.0f : aState.touchY;
+  }
+  if (aState.hasScroll) {
+    controller.scrollDeltaX = aState.scrollDeltaX;
+    controller.scrollDeltaY = aState.scrollDeltaY;
   }
 }
 
@@ -52,6 +52,7 @@ public:
   void SetButtonCount(const int32_t aControllerIndex, const uint32_t aNumButtons) override;
   void SetButtonState(const int32_t aControllerIndex, const Button aWhichButton, const int32_t aImmersiveIndex, const bool aPressed, const bool aTouched, const float aImmersiveTrigger = -1.0f) override;
   void SetAxes(const int32_t aControllerIndex, const float* aData, const uint32_t aLength) override;
+  void SetInputState(const int32_t aControllerIndex, const ControllerInputState& aState) override;
   void SetHapticCount(const int32_t aControllerIndex, const uint32_t aNumHaptics) override;
   uint32_t GetHapticCount(const int32_t aControllerIndex) override;
   void SetHapticFeedback(const int32_t aControllerIndex, const uint64_t aInputFrameID, const float aPulseDuration, const float aPulseIntensity) override;
@@ -21,6 +21,7 @@ namespace crow {
 
 class ControllerDelegate;
 typedef std::shared_ptr<ControllerDelegate> ControllerDelegatePtr;
+struct ControllerInputState;
 
 enum class ControllerMode { None, Device, Hand };
 enum class BeamColor { Normal, Press };
@@ -66,6 +67,8 @@ public:
   virtual void SetButtonCount(const int32_t aControllerIndex, const uint32_t aNumButtons) = 0;
   virtual void SetButtonState(const int32_t aControllerIndex, const Button aWhichButton, const int32_t aImmersiveIndex, const bool aPressed, const bool aTouched, const float aImmersiveTrigger = -1.0f) = 0;
   virtual void SetAxes(const int32_t aControllerIndex, const float* aData, const uint32_t aLength) = 0;
+  // Commits the buttons, axes, touch and scroll state gathered for a frame in a single call.
+  virtual void SetInputState(const int32_t aControllerIndex, const ControllerInputState& aState) = 0;
   virtual void SetHapticCount(const int32_t aControllerIndex, const uint32_t aNumHaptics) = 0;
   virtual uint32_t GetHapticCount(const int32_t aControllerIndex) = 0;
   virtual void SetHapticFeedback(const int32_t aControllerIndex, const uint64_t aInputFrameID, const float aPulseDuration, const float aPulseIntensity) = 0;
@@ -94,6 +97,48 @@ private:
   VRB_NO_DEFAULTS(ControllerDelegate)
 };
 
+// Plain snapshot of the input of a controller for one frame. Each field mirrors the matching
+// ControllerDelegate setter, so that devices can fill it without allocations and commit it at once.
+struct ControllerInputState {
+  static const uint32_t kMaxButtons = 16;
+  // Matches kControllerMaxAxes.
+  static const uint32_t kMaxAxes = 6;
+
+  struct ButtonState {
+    ControllerDelegate::Button button;
+    int32_t immersiveIndex;
+    bool pressed;
+    bool touched;
+    float value;
+  };
+
+  ButtonState buttons[kMaxButtons];
+  uint32_t buttonStateCount = 0;
+  // Number of buttons exposed to WebXR, which may include placeholders without a state.
+  uint32_t buttonCount = 0;
+  float axes[kMaxAxes];
+  uint32_t axisCount = 0;
+  bool hasSelectFactor = false;
+  float selectFactor = 0.0f;
+  bool hasTouch = false;
+  bool touchEnded = false;
+  float touchX = 0.0f;
+  float touchY = 0.0f;
+  bool hasScroll = false;
+  float scrollDeltaX = 0.0f;
+  float scrollDeltaY = 0.0f;
+
+  void Reset() {
+    buttonStateCount = 0;
+    buttonCount = 0;
+    axisCount = 0;
+    hasSelectFactor = false;
+    hasTouch = false;
+    touchEnded = false;
+    hasScroll = false;
+  }
+};
+
 }
 
 #endif // CONTROLLER_DELEGATE_DOT_H
@@ -7,6 +7,7 @@
 #include "Quad.h"
 #include "VRLayer.h"
 #include "VRLayerNode.h"
+#include "WorldInverseCache.h"
 #include "vrb/ConcreteClass.h"
 
 #include "vrb/Color.h"
@@ -47,6 +48,7 @@ struct Cylinder::State {
   float border;
   vrb::Color borderColor;
   vrb::Color solidColor;
+  WorldInverseCache worldInverse;
 
   State()
       : textureWidth(0)
@@ -407,7 +409,7 @@ Cylinder::TestIntersection(const vrb::Vector& aStartPoint, const vrb::Vector& aD
   }
 
   vrb::Matrix worldTransform = m.transform->GetWorldTransform();
-  vrb::Matrix modelView = worldTransform.AfineInverse();
+  const vrb::Matrix& modelView = m.worldInverse.Get(worldTransform);
   vrb::Vector start = modelView.MultiplyPosition(aStartPoint);
   vrb::Vector direction = modelView.MultiplyDirection(aDirection);
   if (vrb::Vector(start.x(), 0.0f, start.z()).Magnitude() <= m.radius) {
@@ -477,7 +479,7 @@ Cylinder::TestIntersection(const vrb::Vector& aStartPoint, const vrb::Vector& aD
 
 void
 Cylinder::ConvertToQuadCoordinates(const vrb::Vector& point, float& aX, float& aY, bool aClamp) const {
-  const vrb::Vector intersection = m.transform->GetWorldTransform().AfineInverse().MultiplyPosition(point);
+  const vrb::Vector intersection = m.worldInverse.Get(m.transform->GetWorldTransform()).MultiplyPosition(point);
   const float radius = GetCylinderRadius();
   float ratioY;
   if (intersection.y() > 0.0f) {
@@ -551,7 +553,7 @@ float Cylinder::DistanceToBackPlane(const vrb::Vector &aStartPoint, const vrb::V
     return result;
   }
   vrb::Matrix worldTransform = m.transform->GetWorldTransform();
-  vrb::Matrix modelView = worldTransform.AfineInverse();
+  const vrb::Matrix& modelView = m.worldInverse.Get(worldTransform);
   vrb::Vector point = modelView.MultiplyPosition(aStartPoint);
   vrb::Vector direction = modelView.MultiplyDirection(aDirection);
 
@@ -591,7 +593,7 @@ Cylinder::ProjectPointToQuad(const vrb::Vector& aWorldPoint, const float aAnchor
   // For cylinders we want to map the position in the cylinder to the position it would have on a quad.
   // This way we can reuse the same resize logic between quads and cylinders.
   // First Convert to world point to local point in the cylinder.
-  vrb::Matrix modelView = GetTransformNode()->GetWorldTransform().AfineInverse();
+  vrb::Matrix modelView = m.worldInverse.Get(m.transform->GetWorldTransform());
   vrb::Vector localPoint = modelView.MultiplyPosition(aWorldPoint);
   const float pointAngle = GetCylinderAngle(localPoint);
 
@@ -88,6 +88,11 @@ public:
   }
   virtual void StartFrame(const FramePrediction aPrediction = FramePrediction::NO_FRAME_AHEAD) = 0;
   virtual void BindEye(const device::Eye aWhich) = 0;
+  // Binds a multiview framebuffer with one layer per eye for single pass stereo rendering.
+  // Returns false if the device can only render one eye at a time.
+  virtual bool BindStereo() { return false; }
+  // Renders both eyes to a single texture array swapchain when supported. Takes effect on the next frame.
+  virtual void SetMultiviewEnabled(const bool aEnabled) {}
   virtual bool ShouldRender() const { return mShouldRender; };
   virtual void EndFrame(const FrameEndMode aMode = FrameEndMode::APPLY) = 0;
   virtual bool IsInGazeMode() const { return false; };
@@ -122,6 +127,41 @@ public:
                               const vrb::GroupPtr& aRoot, const bool aEnabled, const bool leftHanded) {};
   virtual void DrawHandMesh(const uint32_t aControllerIndex, const vrb::Camera&) {};
   virtual void SetImmersiveBlendMode(device::BlendMode) {};
+  // Composition layers of the last frame and how often the layer budget of the runtime was exceeded.
+  struct LayerStats {
+    // UI layers requested and submitted, and all the layers submitted, the projection, background and
+    // video layers included.
+    uint32_t requestedLayers = 0;
+    uint32_t submittedUILayers = 0;
+    uint32_t submittedLayers = 0;
+    uint32_t droppedLayers = 0;
+    uint64_t frames = 0;
+    uint64_t framesWithDroppedLayers = 0;
+    // UI layers whose headers were rebuilt or reused from a previous frame.
+    uint32_t rebuiltLayers = 0;
+    uint32_t reusedLayers = 0;
+    // UI layers refused because the runtime had no slot left for them. Their widgets are drawn in
+    // the projection layer with their own geometry instead.
+    uint32_t fallbackLayers = 0;
+  };
+  virtual LayerStats GetLayerStats() const { return LayerStats(); }
+  // Timing of the last submitted frame. The GPU time of the frame is measured by the GPUProfiler.
+  struct FrameStats {
+    uint64_t frameIndex = 0;
+    // Blocked waiting for the compositor to start the frame.
+    uint64_t waitMicroseconds = 0;
+    // From the start of the frame to its submission.
+    uint64_t cpuMicroseconds = 0;
+    // Handing the frame to the compositor.
+    uint64_t endFrameMicroseconds = 0;
+    int64_t displayPeriodNanoseconds = 0;
+    // Time between locating the rendered head pose and its predicted display time. Zero if unknown.
+    int64_t poseToDisplayNanoseconds = 0;
+    bool lateLatched = false;
+  };
+  virtual FrameStats GetFrameStats() const { return FrameStats(); }
+  // Re-locates the head pose right before the first eye is drawn, when supported.
+  virtual void SetLateLatchEnabled(const bool aEnabled) {}
 
 protected:
   DeviceDelegate() {}
@@ -9,6 +9,9 @@
 #include "vrb/Transform.h"
 #include "vrb/Vector.h"
 #include "vrb/VertexArray.h"
+#include "vrb/gl.h"
+
+#include <cstring>
 
 namespace crow {
 
@@ -150,5 +153,22 @@ device::DeviceType DeviceUtils::GetDeviceTypeFromSystem(bool is6DoF) {
     return device->second;
 }
 
+bool
+DeviceUtils::HasGLExtension(const char* aName) {
+  const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+  if (!extensions) {
+    return false;
+  }
+  const size_t length = strlen(aName);
+  const char* match = extensions;
+  while ((match = strstr(match, aName))) {
+    if ((match == extensions || match[-1] == ' ') && (match[length] == ' ' || match[length] == '\0')) {
+      return true;
+    }
+    match += length;
+  }
+  return false;
+}
+
 }
 
@@ -31,6 +31,8 @@ public:
                                      uint32_t& aTargetWidth, uint32_t& aTargetHeight);
   static vrb::GeometryPtr GetSphereGeometry(vrb::CreationContextPtr& context, uint32_t resolution, float radius);
   static device::DeviceType GetDeviceTypeFromSystem(bool is6DoF);
+  // Whether the current GL context lists aName as a whole word in GL_EXTENSIONS.
+  static bool HasGLExtension(const char* aName);
 
 private:
   static vrb::Matrix CalculateReorientationMatrixWithThreshold(const vrb::Matrix& aHeadTransform, const vrb::Vector& aHeightPosition,
@@ -4,7 +4,10 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 
 #include "ExternalBlitter.h"
+#include "DeviceUtils.h"
 #include "EngineSurfaceTexture.h"
+#include "GLStateCache.h"
+#include "ProgramCache.h"
 #include "vrb/ConcreteClass.h"
 #include "vrb/private/ResourceGLState.h"
 #include "vrb/gl.h"
@@ -12,7 +15,8 @@
 #include "vrb/Logger.h"
 #include "vrb/ShaderUtil.h"
 
-#include <map>
+#include <algorithm>
+#include <vector>
 
 namespace {
 const char* sVertexShader = R"SHADER(
@@ -38,6 +42,34 @@ void main() {
 }
 )SHADER";
 
+// Single pass stereo variant, each view samples its own half of the frame.
+const char* sStereoVertexShader = R"SHADER(#version 300 es
+#extension GL_OVR_multiview2 : require
+layout(num_views = 2) in;
+in vec4 a_position;
+in vec2 a_uvLeft;
+in vec2 a_uvRight;
+out vec2 v_uv;
+void main(void) {
+  v_uv = gl_ViewID_OVR == 0u ? a_uvLeft : a_uvRight;
+  gl_Position = a_position;
+}
+)SHADER";
+
+const char* sStereoFragmentShader = R"SHADER(#version 300 es
+#extension GL_OES_EGL_image_external_essl3 : require
+precision mediump float;
+
+uniform samplerExternalOES u_texture0;
+
+in vec2 v_uv;
+out vec4 fragColor;
+
+void main() {
+  fragColor = texture(u_texture0, v_uv);
+}
+)SHADER";
+
 const GLfloat sVerticies[] = {
     -1.0f, 1.0f, 0.0f,
     -1.0f, -1.0f, 0.0f,
@@ -45,6 +77,29 @@ const GLfloat sVerticies[] = {
     1.0f, -1.0f, 0.0f
 };
 
+// Content usually rotates between two or three surfaces, leave room for a resized swap chain.
+const size_t kMaxPooledSurfaces = 6;
+
+// Layout of the static vertex buffer: positions followed by the left and right eye UVs.
+const GLsizeiptr kVertexBufferPositionOffset = 0;
+const GLsizeiptr kVertexBufferLeftUVOffset = sizeof(sVerticies);
+const GLsizeiptr kVertexBufferRightUVOffset = kVertexBufferLeftUVOffset + 8 * sizeof(GLfloat);
+const GLsizeiptr kVertexBufferSize = kVertexBufferRightUVOffset + 8 * sizeof(GLfloat);
+
+// Lookups of the surface pool during an immersive session, logged when it ends.
+struct SurfacePoolStats {
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t evictions = 0;
+};
+
+struct PooledSurface {
+  int32_t handle;
+  // Null if the lookup failed, so that it is not retried through JNI every frame.
+  crow::EngineSurfaceTexturePtr surface;
+  uint64_t lastUse;
+};
+
 }
 
 namespace crow {
@@ -56,11 +111,19 @@ struct ExternalBlitter::State : public vrb::ResourceGL::State {
   GLint aPosition;
   GLint aUV;
   GLint uTexture0;
+  GLuint stereoVertexShader;
+  GLuint stereoFragmentShader;
+  GLuint stereoProgram;
+  GLuint vertexBuffer;
+  GLuint vertexArrays[device::EyeCount];
+  GLuint stereoVertexArray;
   device::EyeRect eyes[device::EyeCount];
   EngineSurfaceTexturePtr surface;
   GLfloat leftUV[8];
   GLfloat rightUV[8];
-  std::map<const int32_t, EngineSurfaceTexturePtr> surfaceMap;
+  std::vector<PooledSurface> surfaces;
+  uint64_t useCounter;
+  SurfacePoolStats poolStats;
   State()
       : vertexShader(0)
       , fragmentShader(0)
@@ -68,9 +131,119 @@ struct ExternalBlitter::State : public vrb::ResourceGL::State {
       , aPosition(0)
       , aUV(0)
       , uTexture0(0)
+      , stereoVertexShader(0)
+      , stereoFragmentShader(0)
+      , stereoProgram(0)
+      , vertexBuffer(0)
+      , vertexArrays{0, 0}
+      , stereoVertexArray(0)
+      , useCounter(0)
       , leftUV{0.0f, 0.0f, 0.0f, 1.0f, 0.5f, 0.0f, 0.5f, 1.0f}
       , rightUV{0.5f, 0.0f, 0.5f, 1.0f, 1.0f, 0.0f, 1.0f, 1.0f}
   {}
+
+  PooledSurface* FindSurface(const int32_t aHandle) {
+    for (PooledSurface& entry: surfaces) {
+      if (entry.handle == aHandle) {
+        return &entry;
+      }
+    }
+    return nullptr;
+  }
+
+  // Releasing the last reference detaches the surface from the current GL context, so surfaces
+  // must only be evicted on the GL thread.
+  void EvictLeastRecentlyUsed() {
+    auto lru = surfaces.end();
+    for (auto it = surfaces.begin(); it != surfaces.end(); ++it) {
+      if (it->surface && it->surface == surface) {
+        continue;
+      }
+      if (lru == surfaces.end() || it->lastUse < lru->lastUse) {
+        lru = it;
+      }
+    }
+    if (lru != surfaces.end()) {
+      VRB_LOG("Evicting EngineSurfaceTexture for handle: %d", lru->handle);
+      surfaces.erase(lru);
+      poolStats.evictions++;
+    }
+  }
+
+  EngineSurfaceTexturePtr AcquireSurface(const int32_t aHandle) {
+    PooledSurface* entry = FindSurface(aHandle);
+    if (entry) {
+      entry->lastUse = ++useCounter;
+      poolStats.hits++;
+      return entry->surface;
+    }
+    poolStats.misses++;
+    return CreateSurface(aHandle);
+  }
+
+  EngineSurfaceTexturePtr CreateSurface(const int32_t aHandle) {
+    if (surfaces.size() >= kMaxPooledSurfaces) {
+      EvictLeastRecentlyUsed();
+    }
+    VRB_LOG("Creating EngineSurfaceTexture for handle: %d", aHandle);
+    PooledSurface created;
+    created.handle = aHandle;
+    created.surface = EngineSurfaceTexture::Create(aHandle);
+    created.lastUse = ++useCounter;
+    surfaces.push_back(created);
+    return created.surface;
+  }
+
+  // Records the vertex buffer bindings of the given attributes in a new vertex array object.
+  GLuint CreateVertexArray(const GLint aPosition, const GLint aUV, const GLsizeiptr aUVOffset,
+                           const GLint aSecondUV = -1, const GLsizeiptr aSecondUVOffset = 0) {
+    GLuint result = 0;
+    VRB_GL_CHECK(glGenVertexArrays(1, &result));
+    VRB_GL_CHECK(glBindVertexArray(result));
+    VRB_GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer));
+    VRB_GL_CHECK(glVertexAttribPointer((GLuint)aPosition, 3, GL_FLOAT, GL_FALSE, 0, (void*)kVertexBufferPositionOffset));
+    VRB_GL_CHECK(glEnableVertexAttribArray((GLuint)aPosition));
+    VRB_GL_CHECK(glVertexAttribPointer((GLuint)aUV, 2, GL_FLOAT, GL_FALSE, 0, (void*)aUVOffset));
+    VRB_GL_CHECK(glEnableVertexAttribArray((GLuint)aUV));
+    if (aSecondUV >= 0) {
+      VRB_GL_CHECK(glVertexAttribPointer((GLuint)aSecondUV, 2, GL_FLOAT, GL_FALSE, 0, (void*)aSecondUVOffset));
+      VRB_GL_CHECK(glEnableVertexAttribArray((GLuint)aSecondUV));
+    }
+    VRB_GL_CHECK(glBindVertexArray(0));
+    VRB_GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, 0));
+    return result;
+  }
+
+  void InitializeStereoProgram() {
+    if (!DeviceUtils::HasGLExtension("GL_OVR_multiview2") ||
+        !DeviceUtils::HasGLExtension("GL_OES_EGL_image_external_essl3")) {
+      return;
+    }
+    stereoProgram = ProgramCache::CreateProgram(sStereoVertexShader, sStereoFragmentShader,
+                                                stereoVertexShader, stereoFragmentShader);
+    if (!stereoProgram) {
+      return;
+    }
+    const GLint position = vrb::GetAttributeLocation(stereoProgram, "a_position");
+    const GLint leftUV = vrb::GetAttributeLocation(stereoProgram, "a_uvLeft");
+    const GLint rightUV = vrb::GetAttributeLocation(stereoProgram, "a_uvRight");
+    const GLint texture = vrb::GetUniformLocation(stereoProgram, "u_texture0");
+    VRB_GL_CHECK(glUseProgram(stereoProgram));
+    VRB_GL_CHECK(glUniform1i(texture, 0));
+    stereoVertexArray = CreateVertexArray(position, leftUV, kVertexBufferLeftUVOffset, rightUV, kVertexBufferRightUVOffset);
+  }
+
+  void BindSurface() {
+    VRB_GL_CHECK(glActiveTexture(GL_TEXTURE0));
+    VRB_GL_CHECK(glBindTexture(GL_TEXTURE_EXTERNAL_OES, surface->GetTextureName()));
+  }
+
+  static void Attach(const EngineSurfaceTexturePtr& aSurface) {
+    EGLContext ctx = eglGetCurrentContext();
+    if (!aSurface->IsAttachedToGLContext(ctx)) {
+      aSurface->AttachToGLContext(ctx);
+    }
+  }
 };
 
 ExternalBlitterPtr
@@ -81,26 +254,14 @@ ExternalBlitter::Create(vrb::CreationContextPtr& aContext) {
 void
 ExternalBlitter::StartFrame(const int32_t aSurfaceHandle, const device::EyeRect& aLeftEye,
                             const device::EyeRect& aRightEye) {
-  std::map<const int32_t, EngineSurfaceTexturePtr>::iterator iter = m.surfaceMap.find(aSurfaceHandle);
-
-  if (iter == m.surfaceMap.end()) {
-    VRB_LOG("Creating EngineSurfaceTexture for handle: %d", aSurfaceHandle);
-    m.surface = EngineSurfaceTexture::Create(aSurfaceHandle);
-    m.surfaceMap[aSurfaceHandle] = m.surface;
-  } else {
-    m.surface = iter->second;
-  }
+  m.surface = m.AcquireSurface(aSurfaceHandle);
 
   if (!m.surface) {
     VRB_ERROR("Failed to find EngineSurfaceTexture for handle: %d", aSurfaceHandle);
     return;
   }
 
-
-  EGLContext  ctx = eglGetCurrentContext();
-  if (!m.surface->IsAttachedToGLContext(ctx)) {
-    m.surface->AttachToGLContext(ctx);
-  }
+  State::Attach(m.surface);
 
   m.surface->UpdateTexImage();
   m.eyes[device::EyeIndex(device::Eye::Left)] = aLeftEye;
@@ -113,24 +274,35 @@ ExternalBlitter::Draw(const device::Eye aEye) {
     VRB_ERROR("ExternalBlitter::Draw FAILED!");
     return;
   }
-  const GLboolean enabled = glIsEnabled(GL_DEPTH_TEST);
-  if (enabled) {
-    VRB_GL_CHECK(glDisable(GL_DEPTH_TEST));
-  }
+  const bool depthTest = GLStateCache::IsEnabled(GL_DEPTH_TEST);
+  GLStateCache::SetEnabled(GL_DEPTH_TEST, false);
   VRB_GL_CHECK(glUseProgram(m.program));
-  VRB_GL_CHECK(glActiveTexture(GL_TEXTURE0));
-  VRB_GL_CHECK(glBindTexture(GL_TEXTURE_EXTERNAL_OES, m.surface->GetTextureName()));
-  //m.defaultT->Bind();
-  VRB_GL_CHECK(glUniform1i(m.uTexture0, 0));
-  VRB_GL_CHECK(glVertexAttribPointer((GLuint)m.aPosition, 3, GL_FLOAT, GL_FALSE, 0, sVerticies));
-  VRB_GL_CHECK(glEnableVertexAttribArray((GLuint)m.aPosition));
-  GLfloat* data = (aEye == device::Eye::Left ? &m.leftUV[0] : &m.rightUV[0]);
-  VRB_GL_CHECK(glVertexAttribPointer((GLuint)m.aUV, 2, GL_FLOAT, GL_FALSE, 0, data));
-  VRB_GL_CHECK(glEnableVertexAttribArray((GLuint)m.aUV));
+  m.BindSurface();
+  VRB_GL_CHECK(glBindVertexArray(m.vertexArrays[device::EyeIndex(aEye)]));
   VRB_GL_CHECK(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
-  if (enabled) {
-    VRB_GL_CHECK(glEnable(GL_DEPTH_TEST));
+  VRB_GL_CHECK(glBindVertexArray(0));
+  GLStateCache::SetEnabled(GL_DEPTH_TEST, depthTest);
+}
+
+bool
+ExternalBlitter::IsStereoDrawSupported() const {
+  return m.stereoProgram != 0;
+}
+
+void
+ExternalBlitter::DrawStereo() {
+  if (!m.stereoProgram || !m.surface) {
+    VRB_ERROR("ExternalBlitter::DrawStereo FAILED!");
+    return;
   }
+  const bool depthTest = GLStateCache::IsEnabled(GL_DEPTH_TEST);
+  GLStateCache::SetEnabled(GL_DEPTH_TEST, false);
+  VRB_GL_CHECK(glUseProgram(m.stereoProgram));
+  m.BindSurface();
+  VRB_GL_CHECK(glBindVertexArray(m.stereoVertexArray));
+  VRB_GL_CHECK(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
+  VRB_GL_CHECK(glBindVertexArray(0));
+  GLStateCache::SetEnabled(GL_DEPTH_TEST, depthTest);
 }
 
 void
@@ -151,25 +323,21 @@ ExternalBlitter::StopPresenting() {
     m.surface->ReleaseTexImage();
     m.surface = nullptr;
   }
-  m.surfaceMap.clear();
+  m.surfaces.clear();
+  if (m.poolStats.hits + m.poolStats.misses > 0) {
+    VRB_DEBUG("ExternalBlitter surface pool: %llu hits, %llu misses, %llu evictions",
+              (unsigned long long) m.poolStats.hits, (unsigned long long) m.poolStats.misses,
+              (unsigned long long) m.poolStats.evictions);
+  }
+  m.poolStats = SurfacePoolStats();
 }
 
 void
 ExternalBlitter::CancelFrame(const int32_t aSurfaceHandle) {
-  EngineSurfaceTexturePtr surface;
-  auto iter = m.surfaceMap.find(aSurfaceHandle);
-  if (iter != m.surfaceMap.end()) {
-    surface = iter->second;
-  } else {
-    surface = EngineSurfaceTexture::Create(aSurfaceHandle);
-    m.surfaceMap[aSurfaceHandle] = surface;
-  }
+  EngineSurfaceTexturePtr surface = m.AcquireSurface(aSurfaceHandle);
 
   if (surface) {
-    EGLContext ctx = eglGetCurrentContext();
-    if (!surface->IsAttachedToGLContext(ctx)) {
-      surface->AttachToGLContext(ctx);
-    }
+    State::Attach(surface);
     surface->UpdateTexImage();
     surface->ReleaseTexImage();
   }
@@ -182,16 +350,30 @@ ExternalBlitter::ExternalBlitter(State& aState, vrb::CreationContextPtr& aContex
 
 void
 ExternalBlitter::InitializeGL() {
-  m.vertexShader = vrb::LoadShader(GL_VERTEX_SHADER, sVertexShader);
-  m.fragmentShader = vrb::LoadShader(GL_FRAGMENT_SHADER, sFragmentShader);
-  if (m.vertexShader && m.fragmentShader) {
-    m.program = vrb::CreateProgram(m.vertexShader, m.fragmentShader);
-  }
+  m.program = ProgramCache::CreateProgram(sVertexShader, sFragmentShader, m.vertexShader, m.fragmentShader);
   if (m.program) {
     m.aPosition = vrb::GetAttributeLocation(m.program, "a_position");
     m.aUV = vrb::GetAttributeLocation(m.program, "a_uv");
     m.uTexture0 = vrb::GetUniformLocation(m.program, "u_texture0");
+    VRB_GL_CHECK(glUseProgram(m.program));
+    VRB_GL_CHECK(glUniform1i(m.uTexture0, 0));
+  }
+
+  // The quad and its UVs never change, upload them once and record the bindings in VAOs.
+  VRB_GL_CHECK(glGenBuffers(1, &m.vertexBuffer));
+  VRB_GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, m.vertexBuffer));
+  VRB_GL_CHECK(glBufferData(GL_ARRAY_BUFFER, kVertexBufferSize, nullptr, GL_STATIC_DRAW));
+  VRB_GL_CHECK(glBufferSubData(GL_ARRAY_BUFFER, kVertexBufferPositionOffset, sizeof(sVerticies), sVerticies));
+  VRB_GL_CHECK(glBufferSubData(GL_ARRAY_BUFFER, kVertexBufferLeftUVOffset, sizeof(m.leftUV), m.leftUV));
+  VRB_GL_CHECK(glBufferSubData(GL_ARRAY_BUFFER, kVertexBufferRightUVOffset, sizeof(m.rightUV), m.rightUV));
+  VRB_GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, 0));
+  if (m.program) {
+    m.vertexArrays[device::EyeIndex(device::Eye::Left)] = m.CreateVertexArray(m.aPosition, m.aUV, kVertexBufferLeftUVOffset);
+    m.vertexArrays[device::EyeIndex(device::Eye::Right)] = m.CreateVertexArray(m.aPosition, m.aUV, kVertexBufferRightUVOffset);
   }
+
+  m.InitializeStereoProgram();
+  VRB_GL_CHECK(glUseProgram(0));
 }
 
 void
@@ -208,6 +390,32 @@ ExternalBlitter::ShutdownGL() {
     VRB_GL_CHECK(glDeleteShader(m.fragmentShader));
     m.fragmentShader = 0;
   }
+  if (m.stereoProgram) {
+    VRB_GL_CHECK(glDeleteProgram(m.stereoProgram));
+    m.stereoProgram = 0;
+  }
+  if (m.stereoVertexShader) {
+    VRB_GL_CHECK(glDeleteShader(m.stereoVertexShader));
+    m.stereoVertexShader = 0;
+  }
+  if (m.stereoFragmentShader) {
+    VRB_GL_CHECK(glDeleteShader(m.stereoFragmentShader));
+    m.stereoFragmentShader = 0;
+  }
+  for (GLuint& vertexArray: m.vertexArrays) {
+    if (vertexArray) {
+      VRB_GL_CHECK(glDeleteVertexArrays(1, &vertexArray));
+      vertexArray = 0;
+    }
+  }
+  if (m.stereoVertexArray) {
+    VRB_GL_CHECK(glDeleteVertexArrays(1, &m.stereoVertexArray));
+    m.stereoVertexArray = 0;
+  }
+  if (m.vertexBuffer) {
+    VRB_GL_CHECK(glDeleteBuffers(1, &m.vertexBuffer));
+    m.vertexBuffer = 0;
+  }
 }
 
 } // namespace crow
@@ -23,6 +23,10 @@ public:
   static ExternalBlitterPtr Create(vrb::CreationContextPtr& aContext);
   void StartFrame(const int32_t aSurfaceHandle, const device::EyeRect& aLeftEye, const device::EyeRect& aRightEye);
   void Draw(const device::Eye aEye);
+  // True if DrawStereo() can be used, which requires GL_OVR_multiview2.
+  bool IsStereoDrawSupported() const;
+  // Draws both eyes in a single pass. A multiview framebuffer with one layer per eye must be bound.
+  void DrawStereo();
   void EndFrame();
   void StopPresenting();
   void CancelFrame(const int32_t aSurfaceHandle);
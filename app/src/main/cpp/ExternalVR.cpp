@@ -11,22 +11,43 @@
 #include "vrb/Vector.h"
 #include "moz_external_vr.h"
 #include "Assertions.h"
+#include <algorithm>
 #include <assert.h>
+#include <chrono>
+#include <cstddef>
 #include <pthread.h>
+#include <time.h>
 #include <unistd.h>
 
 namespace {
 
 const float SecondsToNanoseconds = 1e9f;
 const int SecondsToNanosecondsI32 = int(1e9);
-const int MicrosecondsToNanoseconds = 1000;
+const float kConditionTimeout = 0.25f;
+// Sections of VRControllerState tracked separately by PushFramePoses: the name, which only changes
+// when a controller connects, the per frame body and, on Chromium, the hand tracking data.
+const size_t kControllerBodyOffset = offsetof(mozilla::gfx::VRControllerState, hand);
+#if CHROMIUM
+const size_t kControllerBodyEnd = offsetof(mozilla::gfx::VRControllerState, hasHandTrackingData);
+#else
+const size_t kControllerBodyEnd = sizeof(mozilla::gfx::VRControllerState);
+#endif
+const uint32_t kAllControllers = 0xffffffff;
+static_assert(mozilla::gfx::kVRControllerMaxCount <= 32, "Controller dirty masks are 32 bit wide");
 
 class Lock {
   pthread_mutex_t* mMutex;
   bool mLocked;
 public:
   Lock() = delete;
-  explicit Lock(pthread_mutex_t* aMutex) : mMutex(aMutex), mLocked(false) {
+  explicit Lock(pthread_mutex_t* aMutex, uint64_t* aContended = nullptr) : mMutex(aMutex), mLocked(false) {
+    if (pthread_mutex_trylock(mMutex) == 0) {
+      mLocked = true;
+      return;
+    }
+    if (aContended) {
+      (*aContended)++;
+    }
     if (pthread_mutex_lock(mMutex) == 0) {
       mLocked = true;
     }
@@ -71,13 +92,14 @@ public:
       if (aWait == 0.0f) {
         return pthread_cond_wait(mCond, mMutex) == 0;
       } else {
+        // The browser engine creates its waits against the default CLOCK_REALTIME condition clock,
+        // so the deadline must be expressed in wall clock time.
         float sec = 0;
         float nsec = modff(aWait, &sec);
-        struct timeval tv = {};
         struct timespec ts = {};
-        gettimeofday(&tv, nullptr);
-        ts.tv_sec = tv.tv_sec + int(sec);
-        ts.tv_nsec = (tv.tv_usec * MicrosecondsToNanoseconds) + int(SecondsToNanoseconds * nsec);
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_sec += int(sec);
+        ts.tv_nsec += int(SecondsToNanoseconds * nsec);
         if (ts.tv_nsec >= SecondsToNanosecondsI32) {
           ts.tv_nsec -= SecondsToNanosecondsI32;
           ts.tv_sec++;
@@ -125,6 +147,15 @@ struct ExternalVR::State {
   mozilla::gfx::VRExternalShmem data = {};
   mozilla::gfx::VRSystemState system = {};
   mozilla::gfx::VRBrowserState browser = {};
+  ExternalVR::TransportStats stats;
+  ExternalVR::FrameWaitStats waitStats;
+  // Controllers changed since the last PushSystemState, and controllers that are out of date in the
+  // shared VRSystemState.
+  uint32_t controllerDirty = 0;
+  uint32_t sharedStale = kAllControllers;
+  bool controllerConnected[mozilla::gfx::kVRControllerMaxCount] = {};
+  std::string controllerNames[mozilla::gfx::kVRControllerMaxCount];
+  mozilla::gfx::VRControllerState controllerScratch = {};
   // device::CapabilityFlags deviceCapabilities = 0;
   vrb::Matrix eyeTransforms[device::EyeCount];
   uint64_t lastFrameId = 0;
@@ -151,9 +182,19 @@ struct ExternalVR::State {
   }
 
   void Reset() {
-    memset(&data, 0, sizeof(mozilla::gfx::VRExternalShmem));
+    // The browser engine may be holding or waiting on the mutexes and conditions, so only the
+    // states are cleared.
+    memset(&data.state, 0, sizeof(mozilla::gfx::VRSystemState));
+    memset(&data.geckoState, 0, sizeof(mozilla::gfx::VRBrowserState));
+    memset(&data.servoState, 0, sizeof(mozilla::gfx::VRBrowserState));
     memset(&system, 0, sizeof(mozilla::gfx::VRSystemState));
     memset(&browser, 0, sizeof(mozilla::gfx::VRBrowserState));
+    controllerDirty = 0;
+    sharedStale = kAllControllers;
+    for (int i = 0; i < mozilla::gfx::kVRControllerMaxCount; ++i) {
+      controllerConnected[i] = false;
+      controllerNames[i].clear();
+    }
     data.version = mozilla::gfx::kVRExternalVersion;
     data.size = sizeof(mozilla::gfx::VRExternalShmem);
     system.displayState.isConnected = true;
@@ -178,9 +219,85 @@ struct ExternalVR::State {
   }
 
   void PullBrowserStateWhileLocked() {
-    const bool wasPresenting = IsPresenting();
-    memcpy(&browser, sourceBrowserState, sizeof(mozilla::gfx::VRBrowserState));
+    UpdateBrowserState(*sourceBrowserState);
+  }
 
+  void DisconnectController(const int aIndex) {
+    if (!controllerConnected[aIndex]) {
+      return;
+    }
+    memset(&system.controllerState[aIndex], 0, sizeof(mozilla::gfx::VRControllerState));
+    controllerConnected[aIndex] = false;
+    controllerNames[aIndex].clear();
+    controllerDirty |= 1u << aIndex;
+  }
+
+  // Writes the [aBegin, aEnd) byte range of the scratch controller into the system state if it changed.
+  void UpdateControllerSection(const int aIndex, const size_t aBegin, const size_t aEnd) {
+    const uint8_t* source = reinterpret_cast<const uint8_t*>(&controllerScratch) + aBegin;
+    uint8_t* target = reinterpret_cast<uint8_t*>(&system.controllerState[aIndex]) + aBegin;
+    if (memcmp(target, source, aEnd - aBegin) != 0) {
+      memcpy(target, source, aEnd - aBegin);
+      controllerDirty |= 1u << aIndex;
+    }
+  }
+
+  // Copies the system state into aTarget, skipping the controllers that are up to date in it.
+  void CopySystemState(mozilla::gfx::VRSystemState& aTarget, uint32_t& aStale) {
+    uint64_t bytes = offsetof(mozilla::gfx::VRSystemState, controllerState);
+    memcpy(&aTarget, &system, bytes);
+    for (int i = 0; i < mozilla::gfx::kVRControllerMaxCount; ++i) {
+      if (aStale & (1u << i)) {
+        memcpy(&aTarget.controllerState[i], &system.controllerState[i], sizeof(mozilla::gfx::VRControllerState));
+        bytes += sizeof(mozilla::gfx::VRControllerState);
+      }
+    }
+    aStale = 0;
+    stats.lastBytesCopied = bytes;
+    stats.bytesCopied += bytes;
+  }
+
+  bool WaitFrameResultPThread(bool& aTimedOut) {
+    bool result = false;
+    Wait wait(browserMutex, browserCond);
+    wait.Lock();
+    // browserMutex is locked in wait.lock().
+    PullBrowserStateWhileLocked();
+    while (!CheckFrameResult(result)) {
+      // VRB_LOG("RequestFrame ABOUT TO WAIT FOR FRAME %llu %llu",browser.layerState[0].layer_stereo_immersive.frameId, lastFrameId);
+      // Wait causes the current thread to block until the condition variable is notified or the timeout happens.
+      // Waiting for the condition variable releases the mutex atomically. So GV can modify the browser data.
+      if (!wait.DoWait(kConditionTimeout)) {
+        aTimedOut = true;
+        return false;
+      }
+      // VRB_LOG("RequestFrame DONE TO WAIT FOR FRAME");
+
+      // browserMutex lock is reacquired again after the condition variable wait exits.
+      PullBrowserStateWhileLocked();
+    }
+    return result;
+  }
+
+  void RecordFrameWait(const std::chrono::steady_clock::duration& aDuration, const bool aTimedOut) {
+    const uint64_t microseconds = (uint64_t) std::chrono::duration_cast<std::chrono::microseconds>(aDuration).count();
+    int bucket = 0;
+    while (bucket < ExternalVR::kFrameWaitBucketCount - 1 &&
+           microseconds >= ((uint64_t) ExternalVR::kFrameWaitBucketBase << bucket)) {
+      bucket++;
+    }
+    waitStats.buckets[bucket]++;
+    waitStats.frames++;
+    waitStats.totalMicroseconds += microseconds;
+    waitStats.maxMicroseconds = std::max(waitStats.maxMicroseconds, microseconds);
+    if (aTimedOut) {
+      waitStats.timeouts++;
+    }
+  }
+
+  void UpdateBrowserState(const mozilla::gfx::VRBrowserState& aState) {
+    const bool wasPresenting = IsPresenting();
+    memcpy(&browser, &aState, sizeof(mozilla::gfx::VRBrowserState));
 
     if ((!wasPresenting && IsPresenting()) || browser.navigationTransitionActive) {
       firstPresentingFrame = true;
@@ -191,6 +308,33 @@ struct ExternalVR::State {
     }
   }
 
+  // Returns true when WaitFrameResult must stop waiting, with aResult holding its return value.
+  bool CheckFrameResult(bool& aResult) {
+    if (!IsPresenting() || browser.layerState[0].layer_stereo_immersive.frameId != lastFrameId) {
+      firstPresentingFrame = false;
+      system.displayState.lastSubmittedFrameSuccessful = true;
+      system.displayState.lastSubmittedFrameId = browser.layerState[0].layer_stereo_immersive.frameId;
+      // VRB_LOG("RequestFrame BREAK %llu",  browser.layerState[0].layer_stereo_immersive.frameId);
+      lastFrameId = browser.layerState[0].layer_stereo_immersive.frameId;
+      aResult = true;
+      return true;
+    }
+
+#if CHROMIUM
+    if(browser.dropFame) {
+       system.displayState.droppedFrameCount++;
+       aResult = false;
+       return true;
+    }
+#endif
+
+    if (firstPresentingFrame || waitingForExit) {
+      aResult = true; // Do not block to show loading screen until the first frame arrives.
+      return true;
+    }
+    return false;
+  }
+
   bool IsPresenting() const {
     return browser.presentationActive || browser.navigationTransitionActive || browser.layerState[0].type == mozilla::gfx::VRLayerType::LayerType_Stereo_Immersive;
   }
@@ -287,6 +431,21 @@ ExternalVR::GetSharedData() {
   return &(m.data);
 }
 
+const ExternalVR::TransportStats&
+ExternalVR::GetTransportStats() const {
+  return m.stats;
+}
+
+const ExternalVR::FrameWaitStats&
+ExternalVR::GetFrameWaitStats() const {
+  return m.waitStats;
+}
+
+void
+ExternalVR::ResetFrameWaitStats() {
+  m.waitStats = FrameWaitStats();
+}
+
 void
 ExternalVR::SetDeviceName(const std::string& aName) {
   if (aName.length() == 0) {
@@ -412,16 +571,18 @@ ExternalVR::SetBlendModes(std::vector<device::BlendMode> aBlendModes) {
 
 void
 ExternalVR::PushSystemState() {
-  Lock lock(&(m.data.systemMutex));
+  m.sharedStale |= m.controllerDirty;
+  m.controllerDirty = 0;
+  Lock lock(&(m.data.systemMutex), &(m.stats.contended));
   if (lock.IsLocked()) {
-    memcpy(&(m.data.state), &(m.system), sizeof(mozilla::gfx::VRSystemState));
+    m.CopySystemState(m.data.state, m.sharedStale);
     pthread_cond_signal(&m.data.systemCond);
   }
 }
 
 void
 ExternalVR::PullBrowserState() {
-  Lock lock(m.browserMutex);
+  Lock lock(m.browserMutex, &(m.stats.contended));
   if (lock.IsLocked()) {
    m.PullBrowserStateWhileLocked();
   }
@@ -528,14 +689,25 @@ ExternalVR::PushFramePoses(const vrb::Matrix& aHeadTransform, const std::vector<
          sizeof(m.system.sensorState.rightViewMatrix));
 
 
-  memset(m.system.controllerState, 0, sizeof(m.system.controllerState));
-  for (int i = 0; i < aControllers.size(); ++i) {
-    const Controller& controller = aControllers[i];
-    if (controller.immersiveName.empty() || !controller.enabled) {
+  const int controllerCount = std::min((int) aControllers.size(), (int) mozilla::gfx::kVRControllerMaxCount);
+  for (int i = 0; i < mozilla::gfx::kVRControllerMaxCount; ++i) {
+    if (i >= controllerCount || aControllers[i].immersiveName.empty() || !aControllers[i].enabled) {
+      m.DisconnectController(i);
       continue;
     }
-    mozilla::gfx::VRControllerState& immersiveController = m.system.controllerState[i];
-    memcpy(immersiveController.controllerName, controller.immersiveName.c_str(), controller.immersiveName.size() + 1);
+    const Controller& controller = aControllers[i];
+    // Controller names are only written when a controller connects to the slot.
+    if (!m.controllerConnected[i] || m.controllerNames[i] != controller.immersiveName) {
+      m.DisconnectController(i);
+      const size_t length = std::min(controller.immersiveName.size(), (size_t) mozilla::gfx::kVRControllerNameMaxLen - 1);
+      memcpy(m.system.controllerState[i].controllerName, controller.immersiveName.c_str(), length);
+      m.controllerNames[i] = controller.immersiveName;
+      m.controllerConnected[i] = true;
+      m.controllerDirty |= 1u << i;
+    }
+    // The rest of the state is built in a scratch controller and only written if it changed.
+    mozilla::gfx::VRControllerState& immersiveController = m.controllerScratch;
+    memset(reinterpret_cast<uint8_t*>(&immersiveController) + kControllerBodyOffset, 0, kControllerBodyEnd - kControllerBodyOffset);
     immersiveController.numButtons = controller.numButtons;
     immersiveController.buttonPressed = controller.immersivePressedState;
     immersiveController.buttonTouched = controller.immersiveTouchedState;
@@ -598,6 +770,8 @@ ExternalVR::PushFramePoses(const vrb::Matrix& aHeadTransform, const std::vector<
     immersiveController.squeezeActionStopFrameId = controller.squeezeActionStopFrameId;
     //VRB_WARN("immersiveController.pose.position %f, %f, %f",  immersiveController.pose.position[0], immersiveController.pose.position[1], immersiveController.pose.position[2]);
 
+    m.UpdateControllerSection(i, kControllerBodyOffset, kControllerBodyEnd);
+
 #if CHROMIUM
     // WebXR hand-tracking support
     if (controller.mode == ControllerMode::Hand) {
@@ -614,6 +788,11 @@ ExternalVR::PushFramePoses(const vrb::Matrix& aHeadTransform, const std::vector<
                &controller.handJointTransforms[j + 1], sizeof(vrb::Matrix));
         immersiveController.handTrackingData.handJointData[j].radius = controller.handJointRadii[j + 1];
       }
+      m.UpdateControllerSection(i, kControllerBodyEnd, sizeof(mozilla::gfx::VRControllerState));
+    } else if (m.system.controllerState[i].hasHandTrackingData) {
+      memset(reinterpret_cast<uint8_t*>(&m.system.controllerState[i]) + kControllerBodyEnd, 0,
+             sizeof(mozilla::gfx::VRControllerState) - kControllerBodyEnd);
+      m.controllerDirty |= 1u << i;
     }
 #endif
   }
@@ -625,43 +804,11 @@ ExternalVR::PushFramePoses(const vrb::Matrix& aHeadTransform, const std::vector<
 
 bool
 ExternalVR::WaitFrameResult() {
-  Wait wait(m.browserMutex, m.browserCond);
-  wait.Lock();
-  // browserMutex is locked in wait.lock().
-  m.PullBrowserStateWhileLocked();
-  while (true) {
-    if (!IsPresenting() || m.browser.layerState[0].layer_stereo_immersive.frameId != m.lastFrameId) {
-      m.firstPresentingFrame = false;
-      m.system.displayState.lastSubmittedFrameSuccessful = true;
-      m.system.displayState.lastSubmittedFrameId = m.browser.layerState[0].layer_stereo_immersive.frameId;
-      // VRB_LOG("RequestFrame BREAK %llu",  m.browser.layerState[0].layer_stereo_immersive.frameId);
-      break;
-    }
-
-#if CHROMIUM
-    if(m.browser.dropFame) {
-       m.system.displayState.droppedFrameCount++;
-       return false;
-    }
-#endif
-
-    if (m.firstPresentingFrame || m.waitingForExit) {
-      return true; // Do not block to show loading screen until the first frame arrives.
-    }
-    // VRB_LOG("RequestFrame ABOUT TO WAIT FOR FRAME %llu %llu",m.browser.layerState[0].layer_stereo_immersive.frameId, m.lastFrameId);
-    const float kConditionTimeout = 0.25f;
-    // Wait causes the current thread to block until the condition variable is notified or the timeout happens.
-    // Waiting for the condition variable releases the mutex atomically. So GV can modify the browser data.
-    if (!wait.DoWait(kConditionTimeout)) {
-      return false;
-    }
-    // VRB_LOG("RequestFrame DONE TO WAIT FOR FRAME");
-
-    // browserMutex lock is reacquired again after the condition variable wait exits.
-    m.PullBrowserStateWhileLocked();
-  }
-  m.lastFrameId = m.browser.layerState[0].layer_stereo_immersive.frameId;
-  return true;
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  bool timedOut = false;
+  const bool result = m.WaitFrameResultPThread(timedOut);
+  m.RecordFrameWait(std::chrono::steady_clock::now() - start, timedOut);
+  return result;
 }
 
 void
@@ -34,8 +34,30 @@ public:
     Gecko,
     Servo
   };
+  struct TransportStats {
+    // Mutex acquisitions that had to block.
+    uint64_t contended = 0;
+    // Bytes of VRSystemState written to shared memory, in total and by the last push.
+    uint64_t bytesCopied = 0;
+    uint64_t lastBytesCopied = 0;
+  };
+  // Time spent by the render thread in WaitFrameResult, which is the time spent waiting for the
+  // browser engine to produce a frame. Bucket i counts the waits shorter than
+  // kFrameWaitBucketBase << i microseconds, the last bucket counts every longer wait.
+  static const int kFrameWaitBucketCount = 14;
+  static const uint32_t kFrameWaitBucketBase = 64;
+  struct FrameWaitStats {
+    uint64_t buckets[kFrameWaitBucketCount] = {};
+    uint64_t frames = 0;
+    uint64_t timeouts = 0;
+    uint64_t totalMicroseconds = 0;
+    uint64_t maxMicroseconds = 0;
+  };
   static ExternalVRPtr Create();
   mozilla::gfx::VRExternalShmem* GetSharedData();
+  const TransportStats& GetTransportStats() const;
+  const FrameWaitStats& GetFrameWaitStats() const;
+  void ResetFrameWaitStats();
   // DeviceDisplay interface
   void SetDeviceName(const std::string& aName) override;
   void SetCapabilityFlags(const device::CapabilityFlags aFlags) override;
@@ -0,0 +1,323 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "GLStateCache.h"
+
+#include "vrb/GLError.h"
+#include "vrb/Logger.h"
+
+namespace {
+
+using crow::GLStateCache::Snapshot;
+
+// Fields of the snapshot that are read back from the driver together.
+enum Field : uint32_t {
+  kBlend = 1u << 0u,
+  kCullFace = 1u << 1u,
+  kDepthTest = 1u << 2u,
+  kPolygonOffsetFill = 1u << 3u,
+  kDepthMask = 1u << 4u,
+  kColorMask = 1u << 5u,
+  kDepthFunc = 1u << 6u,
+  kCullFaceMode = 1u << 7u,
+  kFrontFace = 1u << 8u,
+  kBlendFunc = 1u << 9u,
+  kPolygonOffset = 1u << 10u,
+  kAllFields = (1u << 11u) - 1u,
+};
+
+Snapshot sState;
+// Fields of sState that hold the driver state.
+uint32_t sLoaded = 0;
+
+bool*
+Capability(Snapshot& aState, const GLenum aCapability) {
+  switch (aCapability) {
+    case GL_BLEND: return &aState.blend;
+    case GL_CULL_FACE: return &aState.cullFace;
+    case GL_DEPTH_TEST: return &aState.depthTest;
+    case GL_POLYGON_OFFSET_FILL: return &aState.polygonOffsetFill;
+    default: return nullptr;
+  }
+}
+
+uint32_t
+CapabilityField(const GLenum aCapability) {
+  switch (aCapability) {
+    case GL_BLEND: return kBlend;
+    case GL_CULL_FACE: return kCullFace;
+    case GL_DEPTH_TEST: return kDepthTest;
+    case GL_POLYGON_OFFSET_FILL: return kPolygonOffsetFill;
+    default: return 0;
+  }
+}
+
+GLenum
+QueryEnum(const GLenum aName) {
+  GLint result = 0;
+  VRB_GL_CHECK(glGetIntegerv(aName, &result));
+  return (GLenum) result;
+}
+
+// Reads aFields back from the driver into aResult, leaving the other fields untouched.
+void
+Query(const uint32_t aFields, Snapshot& aResult) {
+  if (aFields & kBlend) {
+    aResult.blend = glIsEnabled(GL_BLEND) == GL_TRUE;
+  }
+  if (aFields & kCullFace) {
+    aResult.cullFace = glIsEnabled(GL_CULL_FACE) == GL_TRUE;
+  }
+  if (aFields & kDepthTest) {
+    aResult.depthTest = glIsEnabled(GL_DEPTH_TEST) == GL_TRUE;
+  }
+  if (aFields & kPolygonOffsetFill) {
+    aResult.polygonOffsetFill = glIsEnabled(GL_POLYGON_OFFSET_FILL) == GL_TRUE;
+  }
+  if (aFields & kDepthMask) {
+    VRB_GL_CHECK(glGetBooleanv(GL_DEPTH_WRITEMASK, &aResult.depthMask));
+  }
+  if (aFields & kColorMask) {
+    VRB_GL_CHECK(glGetBooleanv(GL_COLOR_WRITEMASK, aResult.colorMask));
+  }
+  if (aFields & kDepthFunc) {
+    aResult.depthFunc = QueryEnum(GL_DEPTH_FUNC);
+  }
+  if (aFields & kCullFaceMode) {
+    aResult.cullFaceMode = QueryEnum(GL_CULL_FACE_MODE);
+  }
+  if (aFields & kFrontFace) {
+    aResult.frontFace = QueryEnum(GL_FRONT_FACE);
+  }
+  if (aFields & kBlendFunc) {
+    aResult.blendSrcRGB = QueryEnum(GL_BLEND_SRC_RGB);
+    aResult.blendDstRGB = QueryEnum(GL_BLEND_DST_RGB);
+    aResult.blendSrcAlpha = QueryEnum(GL_BLEND_SRC_ALPHA);
+    aResult.blendDstAlpha = QueryEnum(GL_BLEND_DST_ALPHA);
+  }
+  if (aFields & kPolygonOffset) {
+    VRB_GL_CHECK(glGetFloatv(GL_POLYGON_OFFSET_FACTOR, &aResult.polygonOffsetFactor));
+    VRB_GL_CHECK(glGetFloatv(GL_POLYGON_OFFSET_UNITS, &aResult.polygonOffsetUnits));
+  }
+}
+
+int VerifyFields(const uint32_t aFields, const char* aLocation);
+
+// Reads the fields that are not known yet back from the driver. aLocation is only used when the
+// known fields are cross-checked.
+void
+Load(const uint32_t aFields, const char* aLocation) {
+  const uint32_t missing = aFields & ~sLoaded;
+  if (missing) {
+    Query(missing, sState);
+    sLoaded |= missing;
+  }
+#if WOLVIC_GL_STATE_CHECK
+  VerifyFields(aFields & ~missing, aLocation);
+#endif
+}
+
+int
+Compare(const char* aLocation, const char* aName, const GLenum aCached, const GLenum aDriver) {
+  if (aCached == aDriver) {
+    return 0;
+  }
+  VRB_ERROR("GL state mismatch in %s: %s is 0x%x but the driver has 0x%x", aLocation, aName, aCached, aDriver);
+  return 1;
+}
+
+int
+CompareFloat(const char* aLocation, const char* aName, const GLfloat aCached, const GLfloat aDriver) {
+  if (aCached == aDriver) {
+    return 0;
+  }
+  VRB_ERROR("GL state mismatch in %s: %s is %f but the driver has %f", aLocation, aName, aCached, aDriver);
+  return 1;
+}
+
+// Compares aFields with the driver, logs every difference and adopts the driver values.
+int
+VerifyFields(const uint32_t aFields, const char* aLocation) {
+  if (!aFields) {
+    return 0;
+  }
+  Snapshot driver = sState;
+  Query(aFields, driver);
+  int result = 0;
+  result += Compare(aLocation, "GL_BLEND", sState.blend, driver.blend);
+  result += Compare(aLocation, "GL_CULL_FACE", sState.cullFace, driver.cullFace);
+  result += Compare(aLocation, "GL_DEPTH_TEST", sState.depthTest, driver.depthTest);
+  result += Compare(aLocation, "GL_POLYGON_OFFSET_FILL", sState.polygonOffsetFill, driver.polygonOffsetFill);
+  result += Compare(aLocation, "GL_DEPTH_WRITEMASK", sState.depthMask, driver.depthMask);
+  for (int channel = 0; channel < 4; channel++) {
+    result += Compare(aLocation, "GL_COLOR_WRITEMASK", sState.colorMask[channel], driver.colorMask[channel]);
+  }
+  result += Compare(aLocation, "GL_DEPTH_FUNC", sState.depthFunc, driver.depthFunc);
+  result += Compare(aLocation, "GL_CULL_FACE_MODE", sState.cullFaceMode, driver.cullFaceMode);
+  result += Compare(aLocation, "GL_FRONT_FACE", sState.frontFace, driver.frontFace);
+  result += Compare(aLocation, "GL_BLEND_SRC_RGB", sState.blendSrcRGB, driver.blendSrcRGB);
+  result += Compare(aLocation, "GL_BLEND_DST_RGB", sState.blendDstRGB, driver.blendDstRGB);
+  result += Compare(aLocation, "GL_BLEND_SRC_ALPHA", sState.blendSrcAlpha, driver.blendSrcAlpha);
+  result += Compare(aLocation, "GL_BLEND_DST_ALPHA", sState.blendDstAlpha, driver.blendDstAlpha);
+  result += CompareFloat(aLocation, "GL_POLYGON_OFFSET_FACTOR", sState.polygonOffsetFactor, driver.polygonOffsetFactor);
+  result += CompareFloat(aLocation, "GL_POLYGON_OFFSET_UNITS", sState.polygonOffsetUnits, driver.polygonOffsetUnits);
+  sState = driver;
+  return result;
+}
+
+} // namespace
+
+namespace crow {
+
+void
+GLStateCache::Invalidate() {
+  sLoaded = 0;
+}
+
+const GLStateCache::Snapshot&
+GLStateCache::Get() {
+  Load(kAllFields, "GLStateCache::Get");
+  return sState;
+}
+
+GLboolean
+GLStateCache::GetDepthMask() {
+  Load(kDepthMask, "GLStateCache::GetDepthMask");
+  return sState.depthMask;
+}
+
+void
+GLStateCache::Restore(const Snapshot& aState) {
+  SetEnabled(GL_BLEND, aState.blend);
+  SetEnabled(GL_CULL_FACE, aState.cullFace);
+  SetEnabled(GL_DEPTH_TEST, aState.depthTest);
+  SetEnabled(GL_POLYGON_OFFSET_FILL, aState.polygonOffsetFill);
+  DepthMask(aState.depthMask);
+  ColorMask(aState.colorMask[0], aState.colorMask[1], aState.colorMask[2], aState.colorMask[3]);
+  DepthFunc(aState.depthFunc);
+  CullFace(aState.cullFaceMode);
+  FrontFace(aState.frontFace);
+  BlendFuncSeparate(aState.blendSrcRGB, aState.blendDstRGB, aState.blendSrcAlpha, aState.blendDstAlpha);
+  PolygonOffset(aState.polygonOffsetFactor, aState.polygonOffsetUnits);
+}
+
+bool
+GLStateCache::IsEnabled(const GLenum aCapability) {
+  const bool* enabled = Capability(sState, aCapability);
+  if (!enabled) {
+    return glIsEnabled(aCapability) == GL_TRUE;
+  }
+  Load(CapabilityField(aCapability), "GLStateCache::IsEnabled");
+  return *enabled;
+}
+
+void
+GLStateCache::SetEnabled(const GLenum aCapability, const bool aEnabled) {
+  bool* enabled = Capability(sState, aCapability);
+  if (enabled) {
+    Load(CapabilityField(aCapability), "GLStateCache::SetEnabled");
+    if (*enabled == aEnabled) {
+      return;
+    }
+    *enabled = aEnabled;
+  }
+  if (aEnabled) {
+    VRB_GL_CHECK(glEnable(aCapability));
+  } else {
+    VRB_GL_CHECK(glDisable(aCapability));
+  }
+}
+
+void
+GLStateCache::DepthMask(const GLboolean aMask) {
+  Load(kDepthMask, "GLStateCache::DepthMask");
+  if (sState.depthMask == aMask) {
+    return;
+  }
+  sState.depthMask = aMask;
+  VRB_GL_CHECK(glDepthMask(aMask));
+}
+
+void
+GLStateCache::ColorMask(const GLboolean aRed, const GLboolean aGreen, const GLboolean aBlue, const GLboolean aAlpha) {
+  Load(kColorMask, "GLStateCache::ColorMask");
+  GLboolean* mask = sState.colorMask;
+  if (mask[0] == aRed && mask[1] == aGreen && mask[2] == aBlue && mask[3] == aAlpha) {
+    return;
+  }
+  mask[0] = aRed;
+  mask[1] = aGreen;
+  mask[2] = aBlue;
+  mask[3] = aAlpha;
+  VRB_GL_CHECK(glColorMask(aRed, aGreen, aBlue, aAlpha));
+}
+
+void
+GLStateCache::DepthFunc(const GLenum aFunc) {
+  Load(kDepthFunc, "GLStateCache::DepthFunc");
+  if (sState.depthFunc == aFunc) {
+    return;
+  }
+  sState.depthFunc = aFunc;
+  VRB_GL_CHECK(glDepthFunc(aFunc));
+}
+
+void
+GLStateCache::CullFace(const GLenum aMode) {
+  Load(kCullFaceMode, "GLStateCache::CullFace");
+  if (sState.cullFaceMode == aMode) {
+    return;
+  }
+  sState.cullFaceMode = aMode;
+  VRB_GL_CHECK(glCullFace(aMode));
+}
+
+void
+GLStateCache::FrontFace(const GLenum aMode) {
+  Load(kFrontFace, "GLStateCache::FrontFace");
+  if (sState.frontFace == aMode) {
+    return;
+  }
+  sState.frontFace = aMode;
+  VRB_GL_CHECK(glFrontFace(aMode));
+}
+
+void
+GLStateCache::BlendFunc(const GLenum aSource, const GLenum aDestination) {
+  BlendFuncSeparate(aSource, aDestination, aSource, aDestination);
+}
+
+void
+GLStateCache::BlendFuncSeparate(const GLenum aSourceRGB, const GLenum aDestinationRGB,
+                                const GLenum aSourceAlpha, const GLenum aDestinationAlpha) {
+  Load(kBlendFunc, "GLStateCache::BlendFuncSeparate");
+  if (sState.blendSrcRGB == aSourceRGB && sState.blendDstRGB == aDestinationRGB &&
+      sState.blendSrcAlpha == aSourceAlpha && sState.blendDstAlpha == aDestinationAlpha) {
+    return;
+  }
+  sState.blendSrcRGB = aSourceRGB;
+  sState.blendDstRGB = aDestinationRGB;
+  sState.blendSrcAlpha = aSourceAlpha;
+  sState.blendDstAlpha = aDestinationAlpha;
+  VRB_GL_CHECK(glBlendFuncSeparate(aSourceRGB, aDestinationRGB, aSourceAlpha, aDestinationAlpha));
+}
+
+void
+GLStateCache::PolygonOffset(const GLfloat aFactor, const GLfloat aUnits) {
+  Load(kPolygonOffset, "GLStateCache::PolygonOffset");
+  if (sState.polygonOffsetFactor == aFactor && sState.polygonOffsetUnits == aUnits) {
+    return;
+  }
+  sState.polygonOffsetFactor = aFactor;
+  sState.polygonOffsetUnits = aUnits;
+  VRB_GL_CHECK(glPolygonOffset(aFactor, aUnits));
+}
+
+int
+GLStateCache::Verify(const char* aLocation) {
+  return VerifyFields(sLoaded, aLocation);
+}
+
+} // namespace crow
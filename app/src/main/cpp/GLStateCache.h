@@ -0,0 +1,71 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_GL_STATE_CACHE_DOT_H
+#define VRBROWSER_GL_STATE_CACHE_DOT_H
+
+#include "vrb/gl.h"
+
+// When defined to 1, every read of the shadowed state is cross-checked against the driver and any
+// difference is logged. This brings back the queries the cache removes, so it is off by default.
+#ifndef WOLVIC_GL_STATE_CHECK
+#define WOLVIC_GL_STATE_CHECK 0
+#endif
+
+namespace crow {
+
+// Shadows the fixed function state that the render thread saves and restores around its draws, so
+// saving it does not query the driver. Each piece of state is read back from the driver once, the
+// first time it is needed after Invalidate(), and kept up to date by the setters below, which also
+// skip the GL calls that would not change anything. Code that changes this state directly, like the vrb draw
+// path, must either leave it as it found it or call Invalidate(). Must only be used from the render
+// thread.
+namespace GLStateCache {
+struct Snapshot {
+  bool blend = false;
+  bool cullFace = false;
+  bool depthTest = false;
+  bool polygonOffsetFill = false;
+  GLboolean depthMask = GL_TRUE;
+  GLboolean colorMask[4] = {GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE};
+  GLenum depthFunc = GL_LESS;
+  GLenum cullFaceMode = GL_BACK;
+  GLenum frontFace = GL_CCW;
+  GLenum blendSrcRGB = GL_ONE;
+  GLenum blendDstRGB = GL_ZERO;
+  GLenum blendSrcAlpha = GL_ONE;
+  GLenum blendDstAlpha = GL_ZERO;
+  GLfloat polygonOffsetFactor = 0.0f;
+  GLfloat polygonOffsetUnits = 0.0f;
+};
+
+// Forgets the shadowed state. Called at the start of every frame and when the context is lost.
+void Invalidate();
+// The current state, to be passed to Restore() once done. Reads back every piece of state that is
+// not known yet, so callers that only need the depth mask use GetDepthMask().
+const Snapshot& Get();
+GLboolean GetDepthMask();
+void Restore(const Snapshot& aState);
+// Capabilities other than GL_BLEND, GL_CULL_FACE, GL_DEPTH_TEST and GL_POLYGON_OFFSET_FILL are
+// passed through to the driver.
+bool IsEnabled(const GLenum aCapability);
+void SetEnabled(const GLenum aCapability, const bool aEnabled);
+void DepthMask(const GLboolean aMask);
+void ColorMask(const GLboolean aRed, const GLboolean aGreen, const GLboolean aBlue, const GLboolean aAlpha);
+void DepthFunc(const GLenum aFunc);
+void CullFace(const GLenum aMode);
+void FrontFace(const GLenum aMode);
+void BlendFunc(const GLenum aSource, const GLenum aDestination);
+void BlendFuncSeparate(const GLenum aSourceRGB, const GLenum aDestinationRGB,
+                       const GLenum aSourceAlpha, const GLenum aDestinationAlpha);
+void PolygonOffset(const GLfloat aFactor, const GLfloat aUnits);
+// Compares the shadowed state that is known with the driver, logs every difference and adopts the
+// driver state. Returns the number of differences. aLocation names the caller in the log.
+int Verify(const char* aLocation);
+} // namespace GLStateCache
+
+} // namespace crow
+
+#endif // VRBROWSER_GL_STATE_CACHE_DOT_H
@@ -0,0 +1,275 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "GPUProfiler.h"
+#include "DeviceUtils.h"
+#include "Profiler.h"
+#include "vrb/ConcreteClass.h"
+#include "vrb/gl.h"
+#include "vrb/GLError.h"
+#include "vrb/Logger.h"
+
+#include <EGL/egl.h>
+#include <algorithm>
+#include <array>
+
+namespace {
+
+// Frames in flight before their timestamps are read back.
+const uint32_t kFramesInFlight = 4;
+const uint64_t kPassStatsInterval = 1000; // frames
+const GLenum kGLTimestamp = 0x8E28; // GL_TIMESTAMP_EXT
+const GLenum kGLGPUDisjoint = 0x8FBB; // GL_GPU_DISJOINT_EXT
+const uint32_t kNoQuery = UINT32_MAX;
+
+typedef void (*QueryCounterProc)(GLuint aId, GLenum aTarget);
+typedef void (*GetQueryObjectui64vProc)(GLuint aId, GLenum aName, GLuint64* aParams);
+
+struct Pass {
+  const char* name;
+  uint32_t beginQuery;
+  uint32_t endQuery;
+};
+
+struct Sample {
+  const char* name;
+  GLuint64 begin;
+  GLuint64 end;
+};
+
+// Queries are pooled per frame and only grow, so steady state frames do not allocate.
+struct Frame {
+  std::vector<GLuint> queries;
+  uint32_t usedQueries = 0;
+  std::vector<Pass> passes;
+};
+
+} // namespace
+
+namespace crow {
+
+struct GPUProfiler::State {
+  QueryCounterProc queryCounter = nullptr;
+  GetQueryObjectui64vProc getQueryObjectui64v = nullptr;
+  std::array<Frame, kFramesInFlight> frames;
+  uint64_t frameIndex = 0;
+  std::vector<uint32_t> openPasses;
+  std::vector<PassStats> passStats;
+  uint64_t statsFrames = 0;
+  uint64_t droppedFrames = 0;
+  uint64_t frameMicroseconds = 0;
+  std::vector<Sample> samples;
+
+  Frame& CurrentFrame() {
+    return frames[frameIndex % kFramesInFlight];
+  }
+
+  uint32_t IssueTimestamp() {
+    Frame& frame = CurrentFrame();
+    if (frame.usedQueries == frame.queries.size()) {
+      GLuint query = 0;
+      VRB_GL_CHECK(glGenQueries(1, &query));
+      frame.queries.push_back(query);
+    }
+    const uint32_t index = frame.usedQueries++;
+    queryCounter(frame.queries[index], kGLTimestamp);
+    return index;
+  }
+
+  void AddSample(const char* aName, const uint64_t aMicroseconds) {
+    PassStats* stats = nullptr;
+    for (PassStats& candidate: passStats) {
+      if (candidate.name == aName) {
+        stats = &candidate;
+        break;
+      }
+    }
+    if (!stats) {
+      passStats.emplace_back();
+      stats = &passStats.back();
+      stats->name = aName;
+    }
+    stats->samples++;
+    stats->totalMicroseconds += aMicroseconds;
+    stats->maxMicroseconds = std::max(stats->maxMicroseconds, aMicroseconds);
+    stats->lastMicroseconds = aMicroseconds;
+  }
+
+  // GL_GPU_DISJOINT_EXT is reset when read, so it is only read here, once per collected frame.
+  // A disjoint event makes every timestamp still in flight unreliable, not just the ones of the
+  // frame being collected, so all of them are dropped.
+  bool CheckDisjoint() {
+    GLint disjoint = 0;
+    VRB_GL_CHECK(glGetIntegerv(kGLGPUDisjoint, &disjoint));
+    if (!disjoint) {
+      return false;
+    }
+    for (Frame& frame: frames) {
+      if (!frame.passes.empty()) {
+        droppedFrames++;
+        frame.passes.clear();
+      }
+    }
+    return true;
+  }
+
+  // Reads back a frame only if all of its queries are done, so the CPU never waits for the GPU.
+  // The results are only used if no disjoint event happened while they were in flight.
+  void Collect(Frame& aFrame) {
+    if (aFrame.passes.empty()) {
+      return;
+    }
+    GLuint available = GL_FALSE;
+    VRB_GL_CHECK(glGetQueryObjectuiv(aFrame.queries[aFrame.usedQueries - 1], GL_QUERY_RESULT_AVAILABLE, &available));
+    if (!available) {
+      droppedFrames++;
+      return;
+    }
+    samples.clear();
+    for (const Pass& pass: aFrame.passes) {
+      if (pass.endQuery == kNoQuery) {
+        continue;
+      }
+      GLuint64 begin = 0, end = 0;
+      getQueryObjectui64v(aFrame.queries[pass.beginQuery], GL_QUERY_RESULT, &begin);
+      getQueryObjectui64v(aFrame.queries[pass.endQuery], GL_QUERY_RESULT, &end);
+      if (end >= begin) {
+        samples.push_back({pass.name, begin, end});
+      }
+    }
+    if (CheckDisjoint()) {
+      return;
+    }
+    // Maps GPU timestamps to the Profiler clock so that both show up aligned in the trace.
+    GLint64 gpuNow = 0;
+    VRB_GL_CHECK(glGetInteger64v(kGLTimestamp, &gpuNow));
+    const int64_t offset = Profiler::Now() - gpuNow;
+    GLuint64 frameBegin = UINT64_MAX, frameEnd = 0;
+    for (const Sample& sample: samples) {
+      frameBegin = std::min(frameBegin, sample.begin);
+      frameEnd = std::max(frameEnd, sample.end);
+      AddSample(sample.name, (sample.end - sample.begin) / 1000);
+      if (Profiler::IsEnabled()) {
+        Profiler::RecordGPU(sample.name, (int64_t) sample.begin + offset, (int64_t) sample.end + offset);
+      }
+    }
+    if (frameEnd > frameBegin) {
+      frameMicroseconds = (frameEnd - frameBegin) / 1000;
+    }
+  }
+
+  void UpdatePassStats() {
+    statsFrames++;
+    if (statsFrames < kPassStatsInterval) {
+      return;
+    }
+    for (const PassStats& stats: passStats) {
+      VRB_DEBUG("GPU pass %s: %.3f ms avg, %.3f ms max (%llu samples)", stats.name,
+                stats.totalMicroseconds / 1000.0 / stats.samples, stats.maxMicroseconds / 1000.0,
+                (unsigned long long) stats.samples);
+    }
+    if (droppedFrames > 0) {
+      VRB_DEBUG("GPU passes of %llu frames were not ready and were dropped", (unsigned long long) droppedFrames);
+    }
+    passStats.clear();
+    statsFrames = 0;
+    droppedFrames = 0;
+  }
+};
+
+GPUProfilerPtr
+GPUProfiler::Create() {
+  return std::make_shared<vrb::ConcreteClass<GPUProfiler, GPUProfiler::State> >();
+}
+
+void
+GPUProfiler::InitializeGL() {
+#if defined(NOAPI)
+  return;
+#else
+  if (m.queryCounter) {
+    return;
+  }
+  if (!DeviceUtils::HasGLExtension("GL_EXT_disjoint_timer_query")) {
+    VRB_LOG("GPU profiler disabled, GL_EXT_disjoint_timer_query is not supported");
+    return;
+  }
+  m.queryCounter = (QueryCounterProc)eglGetProcAddress("glQueryCounterEXT");
+  m.getQueryObjectui64v = (GetQueryObjectui64vProc)eglGetProcAddress("glGetQueryObjectui64vEXT");
+  if (!m.queryCounter || !m.getQueryObjectui64v) {
+    m.queryCounter = nullptr;
+    m.getQueryObjectui64v = nullptr;
+  }
+#endif
+}
+
+void
+GPUProfiler::ShutdownGL() {
+  for (Frame& frame: m.frames) {
+    if (!frame.queries.empty()) {
+      VRB_GL_CHECK(glDeleteQueries((GLsizei) frame.queries.size(), frame.queries.data()));
+    }
+    frame = Frame();
+  }
+  m.openPasses.clear();
+  m.frameMicroseconds = 0;
+  m.queryCounter = nullptr;
+  m.getQueryObjectui64v = nullptr;
+}
+
+bool
+GPUProfiler::IsSupported() const {
+  return m.queryCounter != nullptr;
+}
+
+void
+GPUProfiler::BeginFrame() {
+  if (!m.queryCounter) {
+    return;
+  }
+  // Passes left open by the previous frame are not reported.
+  m.openPasses.clear();
+  m.frameIndex++;
+  Frame& frame = m.CurrentFrame();
+  m.Collect(frame);
+  frame.usedQueries = 0;
+  frame.passes.clear();
+  m.UpdatePassStats();
+}
+
+void
+GPUProfiler::BeginPass(const char* aName) {
+  if (!m.queryCounter) {
+    return;
+  }
+  Frame& frame = m.CurrentFrame();
+  m.openPasses.push_back((uint32_t) frame.passes.size());
+  frame.passes.push_back({aName, m.IssueTimestamp(), kNoQuery});
+}
+
+void
+GPUProfiler::EndPass() {
+  if (!m.queryCounter || m.openPasses.empty()) {
+    return;
+  }
+  const uint32_t pass = m.openPasses.back();
+  m.openPasses.pop_back();
+  m.CurrentFrame().passes[pass].endQuery = m.IssueTimestamp();
+}
+
+const std::vector<GPUProfiler::PassStats>&
+GPUProfiler::GetPassStats() const {
+  return m.passStats;
+}
+
+uint64_t
+GPUProfiler::GetFrameMicroseconds() const {
+  return m.frameMicroseconds;
+}
+
+GPUProfiler::GPUProfiler(State& aState) : m(aState) {
+}
+
+} // namespace crow
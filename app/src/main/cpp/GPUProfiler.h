@@ -0,0 +1,79 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_GPU_PROFILER_DOT_H
+#define VRBROWSER_GPU_PROFILER_DOT_H
+
+#include "vrb/MacroUtils.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace crow {
+
+class GPUProfiler;
+typedef std::shared_ptr<GPUProfiler> GPUProfilerPtr;
+
+// Measures the GPU time of render passes with EXT_disjoint_timer_query timestamps. Results are read
+// back a few frames later without stalling, added to the Profiler trace on a "GPU" track and
+// accumulated per pass. Every call is a no-op when the extension is not available. GPUProfiler is
+// the only reader of GL_GPU_DISJOINT_EXT: the flag is reset when read, so any other reader would hide
+// disjoint events from it.
+class GPUProfiler {
+public:
+  static GPUProfilerPtr Create();
+  // Must be called with a current GL context.
+  void InitializeGL();
+  void ShutdownGL();
+  bool IsSupported() const;
+  // Starts a new frame and collects the passes of the oldest frame still in flight.
+  void BeginFrame();
+  // Passes may be nested. aName must outlive the profiler, string literals are expected.
+  void BeginPass(const char* aName);
+  void EndPass();
+  struct PassStats {
+    const char* name = nullptr;
+    uint64_t samples = 0;
+    uint64_t totalMicroseconds = 0;
+    uint64_t maxMicroseconds = 0;
+    uint64_t lastMicroseconds = 0;
+  };
+  // Accumulated since the last time the stats were logged.
+  const std::vector<PassStats>& GetPassStats() const;
+  // GPU time from the first to the last timestamp of the newest frame read back, which is a few
+  // frames older than the current one. Zero until a frame has been read back.
+  uint64_t GetFrameMicroseconds() const;
+protected:
+  struct State;
+  GPUProfiler(State& aState);
+  ~GPUProfiler() = default;
+private:
+  State& m;
+  GPUProfiler() = delete;
+  VRB_NO_DEFAULTS(GPUProfiler)
+};
+
+class GPUProfilerScope {
+public:
+  GPUProfilerScope(const GPUProfilerPtr& aProfiler, const char* aName) : mProfiler(aProfiler.get()) {
+    if (mProfiler) {
+      mProfiler->BeginPass(aName);
+    }
+  }
+  ~GPUProfilerScope() {
+    if (mProfiler) {
+      mProfiler->EndPass();
+    }
+  }
+private:
+  GPUProfiler* mProfiler;
+  GPUProfilerScope(const GPUProfilerScope&) = delete;
+  GPUProfilerScope& operator=(const GPUProfilerScope&) = delete;
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_GPU_PROFILER_DOT_H
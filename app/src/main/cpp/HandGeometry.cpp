@@ -3,6 +3,7 @@
 //
 
 #include "HandGeometry.h"
+#include "GLStateCache.h"
 #include "vrb/ConcreteClass.h"
 #include "vrb/RenderBuffer.h"
 #include "vrb/Geometry.h"
@@ -34,94 +35,39 @@ HandGeometry::Create(vrb::CreationContextPtr& aContext) {
 void HandGeometry::Draw(const vrb::Camera &aCamera, const vrb::Matrix &aModelTransform) {
 
   //Christ: enhance hand model, write depth buffer to cull overlay fragments.
-  //cache depth and alpha setting.
-  GLboolean oldDepth, oldAlpha;
-  GLboolean depthMask = GL_TRUE;
-  GLboolean colorMaskes[4] = {GL_TRUE};
-
-  GLboolean oldCullingFace;
-  GLboolean lastPolygonOffsetFill;
-  GLfloat lastFactor, lastUnits;
-  oldDepth = VRB_GL_CHECK(glIsEnabled(GL_DEPTH_TEST));
-  VRB_GL_CHECK(glGetBooleanv(GL_DEPTH_WRITEMASK, &depthMask));
-  VRB_GL_CHECK(glGetBooleanv(GL_COLOR_WRITEMASK, colorMaskes));
-
-  oldAlpha = VRB_GL_CHECK(glIsEnabled(GL_BLEND));
-  lastPolygonOffsetFill = VRB_GL_CHECK(glIsEnabled(GL_POLYGON_OFFSET_FILL));
-  oldCullingFace = VRB_GL_CHECK(glIsEnabled(GL_CULL_FACE));
-  VRB_GL_CHECK(glGetFloatv(GL_POLYGON_OFFSET_FACTOR, &lastFactor));
-  VRB_GL_CHECK(glGetFloatv(GL_POLYGON_OFFSET_UNITS, &lastUnits));
+  //cache the GL state, which is restored once the hand is drawn.
+  const GLStateCache::Snapshot savedState = GLStateCache::Get();
 
   //-------------------- step 1 --------------------
   //update depth buffer only
-  VRB_GL_CHECK(glCullFace(GL_BACK));
-  VRB_GL_CHECK(glEnable(GL_DEPTH_TEST));
-  VRB_GL_CHECK(glDepthMask(GL_TRUE));
-  VRB_GL_CHECK(glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE));
+  GLStateCache::CullFace(GL_BACK);
+  GLStateCache::SetEnabled(GL_DEPTH_TEST, true);
+  GLStateCache::DepthMask(GL_TRUE);
+  GLStateCache::ColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
   m.renderState->SetProgram(m.fillingProgram);
   DrawImplement(m.renderState ,aCamera, aModelTransform, 0, mFillingOpacity);
-  VRB_GL_CHECK(glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE));
+  GLStateCache::ColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
 
   //-------------------- step 2 --------------------
-  //cache depthFunc state
-  GLint depthFunc= -1;
-  VRB_GL_CHECK(glGetIntegerv(GL_DEPTH_FUNC, &depthFunc));
-  VRB_GL_CHECK(glDepthFunc(GL_LEQUAL));
-  VRB_GL_CHECK(glEnable(GL_CULL_FACE));
-  VRB_GL_CHECK(glEnable(GL_BLEND));
-  VRB_GL_CHECK(glBlendFuncSeparate(
+  GLStateCache::DepthFunc(GL_LEQUAL);
+  GLStateCache::SetEnabled(GL_CULL_FACE, true);
+  GLStateCache::SetEnabled(GL_BLEND, true);
+  GLStateCache::BlendFuncSeparate(
           GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA,
-          GL_ONE, GL_ONE));
-  VRB_GL_CHECK(glFrontFace(GL_CCW));
-  VRB_GL_CHECK(glCullFace(GL_FRONT));
+          GL_ONE, GL_ONE);
+  GLStateCache::FrontFace(GL_CCW);
+  GLStateCache::CullFace(GL_FRONT);
   m.renderState->SetProgram(m.contouringProgram);
   DrawImplement(m.renderState ,aCamera, aModelTransform, mThickness, mContouringOpacity);
 
   //-------------------- step 3 --------------------
-  VRB_GL_CHECK(glBlendFuncSeparate(
-          GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA,
-          GL_ONE, GL_ONE));
-  VRB_GL_CHECK(glCullFace(GL_BACK));
+  GLStateCache::CullFace(GL_BACK);
 
   m.renderState->SetProgram(m.fillingProgram);
   DrawImplement(m.renderState ,aCamera, aModelTransform, 0, mFillingOpacity);
 
-  //restore depthFunc state
-  if(depthFunc > 0)
-  VRB_GL_CHECK(glDepthFunc(depthFunc));
-
-  VRB_GL_CHECK(glBlendFuncSeparate(
-          GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA,
-          GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
-
-
   //status recovering.
-  if (lastPolygonOffsetFill == GL_TRUE) {
-    VRB_GL_CHECK(glEnable(GL_POLYGON_OFFSET_FILL));
-  } else {
-    VRB_GL_CHECK(glDisable(GL_POLYGON_OFFSET_FILL));
-  }
-  VRB_GL_CHECK(glPolygonOffset(lastFactor, lastUnits));
-
-  if (oldDepth == GL_TRUE) {
-    VRB_GL_CHECK(glEnable(GL_DEPTH_TEST));
-  } else {
-    VRB_GL_CHECK(glDisable(GL_DEPTH_TEST));
-  }
-  VRB_GL_CHECK(glDepthMask(depthMask));
-
-  if (oldCullingFace == GL_TRUE) {
-    VRB_GL_CHECK(glEnable(GL_CULL_FACE));
-  } else {
-    VRB_GL_CHECK(glDisable(GL_CULL_FACE));
-  }
-  if (oldAlpha == GL_TRUE) {
-    VRB_GL_CHECK(glEnable(GL_BLEND));
-  } else {
-    VRB_GL_CHECK(glDisable(GL_BLEND));
-  }
-
-  VRB_GL_CHECK(glColorMask(colorMaskes[0], colorMaskes[1], colorMaskes[2], colorMaskes[3]));
+  GLStateCache::Restore(savedState);
 }
 
 void
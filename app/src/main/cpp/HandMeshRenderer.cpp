@@ -4,7 +4,10 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 
 #include "DeviceUtils.h"
+#include "GLStateCache.h"
 #include "HandMeshRenderer.h"
+#include "Profiler.h"
+#include "ProgramCache.h"
 #include "tiny_gltf.h"
 
 #include "vrb/Camera.h"
@@ -12,6 +15,7 @@
 #include "vrb/ConcreteClass.h"
 #include "vrb/GeometryDrawable.h"
 #include "vrb/GLError.h"
+#include "vrb/Logger.h"
 #include "vrb/Matrix.h"
 #include "vrb/ProgramFactory.h"
 #include "vrb/Quaternion.h"
@@ -22,10 +26,78 @@
 #include "vrb/Transform.h"
 #include "vrb/gl.h"
 
+#include <algorithm>
+#include <string>
+
 #define XR_EXT_HAND_TRACKING_NUM_JOINTS 26
 
 namespace crow {
 
+namespace {
+// Shared by the hand mesh programs, expects u_view to be declared.
+const char* sLightingShader = R"SHADER(
+struct Light {
+  vec3 direction;
+  vec4 ambient;
+  vec4 diffuse;
+  vec4 specular;
+};
+
+struct Material {
+  vec4 ambient;
+  vec4 diffuse;
+  vec4 specular;
+  float specularExponent;
+};
+
+const Light u_lights = Light(
+  vec3(1.0, -1.0, 0.0),
+  vec4(0.25, 0.25, 0.25, 1.0),
+  vec4(0.25, 0.25, 0.25, 1.0),
+  vec4(0.4, 0.4, 0.4, 1.0)
+);
+
+const Material u_material = Material(
+  vec4(0.5, 0.5, 0.5, 1.0),
+  vec4(0.5, 0.5, 0.5, 1.0),
+  vec4(0.5, 0.5, 0.5, 1.0),
+  0.75
+);
+
+vec4 calculate_light(vec4 norm, Light light, Material material) {
+  vec4 result = vec4(0.0, 0.0, 0.0, 0.0);
+  vec4 direction = -normalize(u_view * vec4(light.direction.xyz, 0.0));
+  vec4 hvec;
+  float ndotl;
+  float ndoth;
+  result += light.ambient * material.ambient;
+  ndotl = max(0.0, dot(norm, direction));
+  result += (ndotl * light.diffuse * material.diffuse);
+  hvec = normalize(direction + vec4(0.0, 0.0, 1.0, 0.0));
+  ndoth = dot(norm, hvec);
+  if (ndoth > 0.0) {
+    result += (pow(ndoth, material.specularExponent) * material.specular * light.specular);
+  }
+  return result;
+}
+
+)SHADER";
+
+const char* sFragmentShader = R"SHADER(
+precision mediump float;
+
+varying vec4 v_color;
+
+void main() {
+  gl_FragColor = vec4(v_color.xyz, 1.0);
+}
+)SHADER";
+
+std::string VertexShaderSource(const char* aDeclarations, const char* aMain) {
+    return std::string(aDeclarations) + sLightingShader + aMain;
+}
+}
+
 vrb::RenderStatePtr GetHandMeshDefaultRenderState(vrb::CreationContextPtr create) {
     auto program = create->GetProgramFactory()->CreateProgram(create, 0);
     auto state = vrb::RenderState::Create(create);
@@ -109,13 +181,38 @@ void HandMeshRendererSpheres::Update(const uint32_t aControllerIndex, const std:
 
 // HandMeshRendererGeometry
 
+namespace {
+// Buffer uploads of the geometry renderer, logged every kUpdateStatsInterval updates.
+struct HandMeshUpdateStats {
+    uint64_t updates = 0;
+    uint64_t indexUploads = 0;
+    uint64_t vertexUploads = 0;
+    uint64_t vertexUploadsSkipped = 0;
+    uint64_t bytesUploaded = 0;
+};
+
+const uint64_t kUpdateStatsInterval = 1000; // updates
+}
+
 struct HandMeshGeometry {
     vrb::TogglePtr toggle;
     vrb::GeometryDrawablePtr geometry;
+    // Buffers handed to the render buffer of the geometry. They live as long as the renderer, so
+    // that each update only rewrites their contents.
+    GLuint ibo { 0 };
+    GLuint vbo { 0 };
+    // Sizes of the GL buffer stores, in elements.
+    uint32_t indexCapacity { 0 };
+    uint32_t vertexCapacity { 0 };
+    uint32_t indexCount { 0 };
+    uint32_t vertexCount { 0 };
+    uint32_t indexBufferKey { 0 };
+    std::vector<uint16_t> indices16;
 };
 
 struct HandMeshRendererGeometry::State {
     std::vector<HandMeshGeometry> handMeshState;
+    HandMeshUpdateStats stats;
 };
 
 HandMeshRendererPtr HandMeshRendererGeometry::Create(vrb::CreationContextPtr& aContext) {
@@ -127,6 +224,15 @@ HandMeshRendererGeometry::HandMeshRendererGeometry(State& aState, vrb::CreationC
     context = aContext;
 }
 
+HandMeshRendererGeometry::~HandMeshRendererGeometry() {
+    for (HandMeshGeometry& handMesh: m.handMeshState) {
+        if (handMesh.ibo)
+            VRB_GL_CHECK(glDeleteBuffers(1, &handMesh.ibo));
+        if (handMesh.vbo)
+            VRB_GL_CHECK(glDeleteBuffers(1, &handMesh.vbo));
+    }
+}
+
 void HandMeshRendererGeometry::Initialize(HandMeshGeometry& handMesh, const vrb::GroupPtr& aRoot) {
     vrb::CreationContextPtr create = context.lock();
     handMesh.toggle = vrb::Toggle::Create(create);
@@ -144,6 +250,60 @@ void HandMeshRendererGeometry::Initialize(HandMeshGeometry& handMesh, const vrb:
     handMesh.geometry->SetRenderState(state);
 }
 
+void HandMeshRendererGeometry::UploadBuffers(HandMeshGeometry& handMesh, const HandMeshBufferMSFT& buffer) {
+    if (handMesh.ibo == 0) {
+        VRB_GL_CHECK(glGenBuffers(1, &handMesh.ibo));
+        VRB_GL_CHECK(glGenBuffers(1, &handMesh.vbo));
+    }
+
+    // Indices only change along with the topology of the mesh, which the runtime identifies by
+    // the index buffer key.
+    const bool uploadIndices = buffer.indicesChanged &&
+        (handMesh.indexCount == 0 || buffer.indexBufferKey != handMesh.indexBufferKey);
+    if (uploadIndices) {
+        handMesh.indexCount = buffer.indexCount;
+        handMesh.indexBufferKey = buffer.indexBufferKey;
+    }
+    if (buffer.verticesChanged)
+        handMesh.vertexCount = buffer.vertexCount;
+
+    auto& renderBuffer = handMesh.geometry->GetRenderBuffer();
+    renderBuffer->SetIndexObject(handMesh.ibo, handMesh.indexCount);
+    renderBuffer->SetVertexObject(handMesh.vbo, handMesh.vertexCount);
+    renderBuffer->Bind();
+
+    if (uploadIndices) {
+        // @FIXME: VRB's GeometryDrawable assumes unsigned shorts (16 bits) for the indices, but we got
+        //         32 bits indices from XR_MSFT_hand_tracking_mesh; so we need to manually convert them.
+        handMesh.indices16.resize(handMesh.indexCount);
+        for (uint32_t i = 0; i < handMesh.indexCount; i++)
+            handMesh.indices16[i] = (uint16_t) buffer.indices[i];
+        const GLsizeiptr size = handMesh.indexCount * sizeof(uint16_t);
+        if (handMesh.indexCount > handMesh.indexCapacity) {
+            VRB_GL_CHECK(glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, handMesh.indices16.data(), GL_STATIC_DRAW));
+            handMesh.indexCapacity = handMesh.indexCount;
+        } else {
+            VRB_GL_CHECK(glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, size, handMesh.indices16.data()));
+        }
+        m.stats.indexUploads++;
+        m.stats.bytesUploaded += size;
+    }
+
+    if (buffer.verticesChanged) {
+        // Vertices are streamed every frame. Orphaning the store lets the driver hand us fresh memory
+        // instead of stalling until the draw calls of the previous frame have consumed the old one.
+        const GLsizeiptr size = handMesh.vertexCount * sizeof(HandMeshVertexMSFT);
+        handMesh.vertexCapacity = std::max(handMesh.vertexCapacity, handMesh.vertexCount);
+        VRB_GL_CHECK(glBufferData(GL_ARRAY_BUFFER, handMesh.vertexCapacity * sizeof(HandMeshVertexMSFT), nullptr, GL_STREAM_DRAW));
+        VRB_GL_CHECK(glBufferSubData(GL_ARRAY_BUFFER, 0, size, buffer.vertices.data()));
+        m.stats.vertexUploads++;
+        m.stats.bytesUploaded += size;
+    } else {
+        m.stats.vertexUploadsSkipped++;
+    }
+    renderBuffer->Unbind();
+}
+
 void HandMeshRendererGeometry::Update(const uint32_t aControllerIndex, const std::vector<vrb::Matrix>& handJointTransforms,
                                       const vrb::GroupPtr& aRoot, HandMeshBufferPtr& aBuffer, const bool aEnabled, const bool leftHanded) {
     if (aControllerIndex >= m.handMeshState.size())
@@ -165,34 +325,27 @@ void HandMeshRendererGeometry::Update(const uint32_t aControllerIndex, const std
     if (!aBuffer)
         return;
 
+    PROFILE_SCOPE("HandMeshUpload");
     assert(handMesh.geometry);
-    auto& renderBuffer = handMesh.geometry->GetRenderBuffer();
-
-    HandMeshBufferMSFTPtr buffer = std::dynamic_pointer_cast<HandMeshBufferMSFT>(aBuffer);
-
-    // @FIXME: VRB's GeometryDrawable assumes unsigned shorts (16 bits) for the indices, but we got
-    //         32 bits indices from XR_MSFT_hand_tracking_mesh; so we need to manually convert them.
-    std::vector<uint16_t> indices16;
-    indices16.resize(buffer->indices.size());
-    for (uint32_t i = 0; i < buffer->indices.size(); i++)
-        indices16[i] = (uint16_t) buffer->indices[i];
-
-    // Upload the new geometry to the render buffers
-    renderBuffer->SetIndexObject(buffer->ibo, buffer->indices.size());
-    renderBuffer->SetVertexObject(buffer->vbo, buffer->vertices.size());
-    renderBuffer->Bind();
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, buffer->indices.size() * sizeof(uint16_t),
-                 indices16.data(), GL_STATIC_DRAW);
-    glBufferData(GL_ARRAY_BUFFER, buffer->vertices.size() * sizeof(HandMeshVertexMSFT),
-                 buffer->vertices.data(), GL_STATIC_DRAW);
-    renderBuffer->Unbind();
+    const HandMeshBufferMSFT* buffer = dynamic_cast<const HandMeshBufferMSFT*>(aBuffer.get());
+    assert(buffer);
+    UploadBuffers(handMesh, *buffer);
+
+    m.stats.updates++;
+    if (m.stats.updates >= kUpdateStatsInterval) {
+        VRB_DEBUG("Hand mesh: %llu index uploads, %llu vertex uploads, %llu skipped, %.1f KB/update (%llu updates)",
+                  (unsigned long long) m.stats.indexUploads, (unsigned long long) m.stats.vertexUploads,
+                  (unsigned long long) m.stats.vertexUploadsSkipped,
+                  m.stats.bytesUploaded / 1024.0 / m.stats.updates, (unsigned long long) m.stats.updates);
+        m.stats = HandMeshUpdateStats();
+    }
 }
 
 
 // HandMeshRendererSkinned
 
 namespace {
-const char* sVertexShader = R"SHADER(
+const char* sSkinnedVertexDeclarations = R"SHADER(
 precision highp float;
 
 #define MAX_JOINTS 26
@@ -208,52 +361,9 @@ attribute vec4 a_jointIndices;
 attribute vec4 a_jointWeights;
 
 varying vec4 v_color;
+)SHADER";
 
-struct Light {
-  vec3 direction;
-  vec4 ambient;
-  vec4 diffuse;
-  vec4 specular;
-};
-
-struct Material {
-  vec4 ambient;
-  vec4 diffuse;
-  vec4 specular;
-  float specularExponent;
-};
-
-const Light u_lights = Light(
-  vec3(1.0, -1.0, 0.0),
-  vec4(0.25, 0.25, 0.25, 1.0),
-  vec4(0.25, 0.25, 0.25, 1.0),
-  vec4(0.4, 0.4, 0.4, 1.0)
-);
-
-const Material u_material = Material(
-  vec4(0.5, 0.5, 0.5, 1.0),
-  vec4(0.5, 0.5, 0.5, 1.0),
-  vec4(0.5, 0.5, 0.5, 1.0),
-  0.75
-);
-
-vec4 calculate_light(vec4 norm, Light light, Material material) {
-  vec4 result = vec4(0.0, 0.0, 0.0, 0.0);
-  vec4 direction = -normalize(u_view * vec4(light.direction.xyz, 0.0));
-  vec4 hvec;
-  float ndotl;
-  float ndoth;
-  result += light.ambient * material.ambient;
-  ndotl = max(0.0, dot(norm, direction));
-  result += (ndotl * light.diffuse * material.diffuse);
-  hvec = normalize(direction + vec4(0.0, 0.0, 1.0, 0.0));
-  ndoth = dot(norm, hvec);
-  if (ndoth > 0.0) {
-    result += (pow(ndoth, material.specularExponent) * material.specular * light.specular);
-  }
-  return result;
-}
-
+const char* sSkinnedVertexMain = R"SHADER(
 void main(void) {
   vec4 pos = vec4(a_position, 1.0);
   vec4 localPos1 = u_jointMatrices[int(a_jointIndices.x)] * pos;
@@ -280,17 +390,6 @@ void main(void) {
   v_color = calculate_light(normal, u_lights, u_material);
 }
 )SHADER";
-
-        const char* sFragmentShader = R"SHADER(
-precision mediump float;
-
-varying vec4 v_color;
-
-void main() {
-  gl_FragColor = vec4(v_color.xyz, 1.0);
-}
-)SHADER";
-
 }
 
 struct Vector4s1 {
@@ -348,10 +447,8 @@ struct HandMeshRendererSkinned::State {
 
 HandMeshRendererSkinned::HandMeshRendererSkinned(State& aState, vrb::CreationContextPtr& aContext)
     : m(aState) {
-    m.vertexShader = vrb::LoadShader(GL_VERTEX_SHADER, sVertexShader);
-    m.fragmentShader = vrb::LoadShader(GL_FRAGMENT_SHADER, sFragmentShader);
-    if (m.vertexShader && m.fragmentShader)
-        m.program = vrb::CreateProgram(m.vertexShader, m.fragmentShader);
+    m.program = ProgramCache::CreateProgram(VertexShaderSource(sSkinnedVertexDeclarations, sSkinnedVertexMain),
+                                            sFragmentShader, m.vertexShader, m.fragmentShader);
 
     assert(m.program);
 
@@ -550,12 +647,11 @@ void HandMeshRendererSkinned::Draw(const uint32_t aControllerIndex, const vrb::C
     assert(m.program);
     VRB_GL_CHECK(glUseProgram(m.program));
 
-    const GLboolean enabled = glIsEnabled(GL_DEPTH_TEST);
-    if (!enabled)
-    VRB_GL_CHECK(glEnable(GL_DEPTH_TEST));
+    const bool depthTest = GLStateCache::IsEnabled(GL_DEPTH_TEST);
+    GLStateCache::SetEnabled(GL_DEPTH_TEST, true);
 
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glEnable(GL_BLEND);
+    GLStateCache::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GLStateCache::SetEnabled(GL_BLEND, true);
 
     VRB_GL_CHECK(glUniformMatrix4fv(m.uPerspective, 1, GL_FALSE, aCamera.GetPerspective().Data()));
     VRB_GL_CHECK(glUniformMatrix4fv(m.uView, 1, GL_FALSE, aCamera.GetView().Data()));
@@ -608,8 +704,7 @@ void HandMeshRendererSkinned::Draw(const uint32_t aControllerIndex, const vrb::C
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-    if (!enabled)
-    VRB_GL_CHECK(glDisable(GL_DEPTH_TEST));
+    GLStateCache::SetEnabled(GL_DEPTH_TEST, depthTest);
 }
 
 void
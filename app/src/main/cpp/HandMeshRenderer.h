@@ -80,16 +80,13 @@ struct HandMeshVertexMSFT {
 struct HandMeshBufferMSFT: public HandMeshBuffer {
     std::vector<uint32_t> indices;
     std::vector<HandMeshVertexMSFT> vertices;
-    uint32_t ibo;
-    uint32_t vbo;
-    HandMeshBufferMSFT() {
-        glGenBuffers(1, &this->ibo);
-        glGenBuffers(1, &this->vbo);
-    }
-    ~HandMeshBufferMSFT() {
-        glDeleteBuffers(1, &this->ibo);
-        glDeleteBuffers(1, &this->vbo);
-    }
+    // Counts and change flags reported by xrUpdateHandMeshMSFT. The runtime only writes the
+    // indices (resp. vertices) of this buffer when they changed, so they must be ignored otherwise.
+    uint32_t indexCount = 0;
+    uint32_t vertexCount = 0;
+    uint32_t indexBufferKey = 0;
+    bool indicesChanged = false;
+    bool verticesChanged = false;
 };
 
 struct HandMeshBufferMSFT;
@@ -102,12 +99,14 @@ protected:
     struct State;
     State& m;
     HandMeshRendererGeometry(State&, vrb::CreationContextPtr&);
+    ~HandMeshRendererGeometry();
 public:
     static HandMeshRendererPtr Create(vrb::CreationContextPtr&);
 private:
     void Initialize(HandMeshGeometry& state, const vrb::GroupPtr& aRoot);
     void Update(const uint32_t aControllerIndex, const std::vector<vrb::Matrix>& handJointTransforms,
                 const vrb::GroupPtr& aRoot, HandMeshBufferPtr&, const bool aEnabled, const bool leftHanded) override;
+    void UploadBuffers(HandMeshGeometry& handMesh, const HandMeshBufferMSFT& buffer);
 };
 
 };
@@ -0,0 +1,1122 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "InputTrace.h"
+#include "vrb/ConcreteClass.h"
+#include "vrb/Logger.h"
+#include "vrb/Matrix.h"
+#include "vrb/Quaternion.h"
+#include "vrb/Vector.h"
+
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Traces are written in the native byte order, they are meant to be replayed on the same kind of
+// device or on a little endian host.
+const uint32_t kTraceMagic = 0x52544957; // "WITR"
+const uint32_t kTraceVersion = 1;
+// Committed frames are handed to the writer thread once they add up to this many bytes.
+const size_t kFlushSize = 64 * 1024;
+
+enum class Record : uint8_t {
+  Frame = 1,
+  CreateController,
+  DestroyController,
+  SetEnabled,
+  SetCapabilityFlags,
+  SetControllerType,
+  SetTargetRayMode,
+  SetModelVisible,
+  SetTransform,
+  SetBeamTransform,
+  SetImmersiveBeamTransform,
+  SetButtonCount,
+  SetButtonState,
+  SetAxes,
+  SetInputState,
+  SetHapticCount,
+  SetSelectActionStart,
+  SetSelectActionStop,
+  SetSqueezeActionStart,
+  SetSqueezeActionStop,
+  SetLeftHanded,
+  SetTouchPosition,
+  EndTouch,
+  SetScrolledDelta,
+  SetBatteryLevel,
+  SetHandJointLocations,
+  SetAimEnabled,
+  SetHandActionEnabled,
+  SetMode,
+  SetSelectFactor,
+  SetFocused,
+  SetBeamColor,
+  SetVisible,
+  SetGazeModeIndex,
+};
+
+enum class PoseEncoding : uint8_t { Rigid, Matrix };
+
+enum InputStateFlags : uint8_t {
+  kHasSelectFactor = 1u << 0u,
+  kHasTouch = 1u << 1u,
+  kTouchEnded = 1u << 2u,
+  kHasScroll = 1u << 3u,
+};
+
+// Poses are rigid unless a device scales them, so a position and a quaternion are usually enough.
+bool
+IsRigid(const vrb::Matrix& aMatrix) {
+  const float* data = aMatrix.Data();
+  for (int axis = 0; axis < 3; axis++) {
+    const float* column = data + axis * 4;
+    const float length = column[0] * column[0] + column[1] * column[1] + column[2] * column[2];
+    if (fabsf(length - 1.0f) > 1e-4f || column[3] != 0.0f) {
+      return false;
+    }
+  }
+  return data[15] == 1.0f;
+}
+
+class Writer {
+public:
+  template<typename T>
+  void Write(const T& aValue) {
+    static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be written");
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&aValue);
+    mData.insert(mData.end(), bytes, bytes + sizeof(T));
+  }
+
+  void WriteRecord(const Record aRecord, const int32_t aControllerIndex) {
+    Write(aRecord);
+    Write((uint8_t) aControllerIndex);
+  }
+
+  void WriteString(const std::string& aValue) {
+    Write((uint16_t) aValue.size());
+    mData.insert(mData.end(), aValue.begin(), aValue.end());
+  }
+
+  void WritePose(const vrb::Matrix& aMatrix) {
+    if (IsRigid(aMatrix)) {
+      const vrb::Vector position = aMatrix.GetTranslation();
+      const vrb::Quaternion orientation(aMatrix);
+      Write(PoseEncoding::Rigid);
+      const float values[7] = {position.x(), position.y(), position.z(),
+                               orientation.x(), orientation.y(), orientation.z(), orientation.w()};
+      Write(values);
+    } else {
+      Write(PoseEncoding::Matrix);
+      const float* data = aMatrix.Data();
+      mData.insert(mData.end(), (const uint8_t*) data, (const uint8_t*) (data + 16));
+    }
+  }
+
+  const std::vector<uint8_t>& Data() const { return mData; }
+  void Clear() { mData.clear(); }
+private:
+  std::vector<uint8_t> mData;
+};
+
+class Reader {
+public:
+  Reader(const std::vector<uint8_t>& aData, const size_t aOffset) : mData(aData), mOffset(aOffset) {}
+
+  template<typename T>
+  T Read() {
+    static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be read");
+    T result;
+    memset(&result, 0, sizeof(T));
+    if (mOffset + sizeof(T) > mData.size()) {
+      mFailed = true;
+      mOffset = mData.size();
+      return result;
+    }
+    memcpy(&result, mData.data() + mOffset, sizeof(T));
+    mOffset += sizeof(T);
+    return result;
+  }
+
+  std::string ReadString() {
+    const uint16_t length = Read<uint16_t>();
+    if (mOffset + length > mData.size()) {
+      mFailed = true;
+      mOffset = mData.size();
+      return std::string();
+    }
+    std::string result((const char*) mData.data() + mOffset, length);
+    mOffset += length;
+    return result;
+  }
+
+  vrb::Matrix ReadPose() {
+    if (Read<PoseEncoding>() == PoseEncoding::Rigid) {
+      float values[7];
+      for (float& value: values) {
+        value = Read<float>();
+      }
+      vrb::Matrix result = vrb::Matrix::Rotation(vrb::Quaternion(values[3], values[4], values[5], values[6]));
+      result.TranslateInPlace(vrb::Vector(values[0], values[1], values[2]));
+      return result;
+    }
+    float values[16];
+    for (float& value: values) {
+      value = Read<float>();
+    }
+    return vrb::Matrix::FromColumnMajor(values);
+  }
+
+  bool AtEnd() const { return mOffset >= mData.size(); }
+  bool Failed() const { return mFailed; }
+  size_t Offset() const { return mOffset; }
+private:
+  const std::vector<uint8_t>& mData;
+  size_t mOffset;
+  bool mFailed = false;
+};
+
+// Setup calls seen for a controller, written at the start of every trace so that recording can
+// start at any point of a session.
+struct ControllerSetup {
+  bool created = false;
+  int32_t modelIndex = -1;
+  std::string immersiveName;
+  vrb::Matrix beamTransform = vrb::Matrix::Identity();
+  bool enabled = false;
+  crow::device::CapabilityFlags capabilityFlags = 0;
+  crow::device::DeviceType type = 0;
+  crow::device::TargetRayMode targetRayMode = crow::device::TargetRayMode::TrackedPointer;
+  uint32_t buttonCount = 0;
+  uint32_t hapticCount = 0;
+  crow::ControllerMode mode = crow::ControllerMode::None;
+  bool leftHanded = false;
+  // Defaults of a controller reset by ControllerContainer.
+  bool aimEnabled = true;
+  bool handActionEnabled = false;
+  bool modelVisible = true;
+  vrb::Matrix immersiveBeamTransform = vrb::Matrix::Identity();
+};
+
+} // namespace
+
+namespace crow {
+
+struct InputRecorder::State {
+  ControllerDelegatePtr target;
+  FILE* file = nullptr;
+  std::string path;
+  Writer writer;
+  // Bytes of |writer| that belong to committed frames.
+  size_t committed = 0;
+  uint32_t frames = 0;
+  // The file is only written by |thread|, so the render thread never waits on storage while
+  // recording. |pending| and |stopping| are guarded by |lock|.
+  std::thread thread;
+  std::mutex lock;
+  std::condition_variable condition;
+  std::vector<uint8_t> pending;
+  bool stopping = false;
+  std::atomic<bool> failed { false };
+  std::vector<ControllerSetup> setups;
+  int32_t gazeIndex = -1;
+  bool visible = true;
+
+  ControllerSetup& Setup(const int32_t aControllerIndex) {
+    if ((size_t) aControllerIndex >= setups.size()) {
+      setups.resize((size_t) aControllerIndex + 1);
+    }
+    return setups[aControllerIndex];
+  }
+
+  void WriteSetup() {
+    for (int32_t index = 0; index < (int32_t) setups.size(); index++) {
+      const ControllerSetup& setup = setups[index];
+      if (!setup.created) {
+        continue;
+      }
+      writer.WriteRecord(Record::CreateController, index);
+      writer.Write(setup.modelIndex);
+      writer.WriteString(setup.immersiveName);
+      writer.WritePose(setup.beamTransform);
+      writer.WriteRecord(Record::SetCapabilityFlags, index);
+      writer.Write(setup.capabilityFlags);
+      writer.WriteRecord(Record::SetControllerType, index);
+      writer.Write(setup.type);
+      writer.WriteRecord(Record::SetTargetRayMode, index);
+      writer.Write(setup.targetRayMode);
+      writer.WriteRecord(Record::SetButtonCount, index);
+      writer.Write(setup.buttonCount);
+      writer.WriteRecord(Record::SetHapticCount, index);
+      writer.Write(setup.hapticCount);
+      writer.WriteRecord(Record::SetMode, index);
+      writer.Write(setup.mode);
+      writer.WriteRecord(Record::SetLeftHanded, index);
+      writer.Write(setup.leftHanded);
+      writer.WriteRecord(Record::SetAimEnabled, index);
+      writer.Write(setup.aimEnabled);
+      writer.WriteRecord(Record::SetHandActionEnabled, index);
+      writer.Write(setup.handActionEnabled);
+      writer.WriteRecord(Record::SetModelVisible, index);
+      writer.Write(setup.modelVisible);
+      writer.WriteRecord(Record::SetImmersiveBeamTransform, index);
+      writer.WritePose(setup.immersiveBeamTransform);
+      writer.WriteRecord(Record::SetEnabled, index);
+      writer.Write(setup.enabled);
+    }
+    if (gazeIndex >= 0) {
+      writer.WriteRecord(Record::SetGazeModeIndex, gazeIndex);
+    }
+    writer.WriteRecord(Record::SetVisible, 0);
+    writer.Write(visible);
+  }
+
+  // Hands the committed frames to the writer thread. Updates made after the last committed frame
+  // are dropped, they would never be played.
+  void Flush() {
+    if (committed > 0) {
+      {
+        std::lock_guard<std::mutex> guard(lock);
+        pending.insert(pending.end(), writer.Data().begin(), writer.Data().begin() + committed);
+      }
+      condition.notify_one();
+    }
+    writer.Clear();
+    committed = 0;
+  }
+
+  void WriteLoop() {
+    std::vector<uint8_t> batch;
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+      condition.wait(guard, [this] { return stopping || !pending.empty(); });
+      if (pending.empty()) {
+        break;
+      }
+      batch.swap(pending);
+      guard.unlock();
+      if (!failed && fwrite(batch.data(), 1, batch.size(), file) != batch.size()) {
+        VRB_ERROR("Failed to write input trace %s, recording stopped", path.c_str());
+        failed = true;
+      }
+      batch.clear();
+      guard.lock();
+    }
+  }
+};
+
+InputRecorderPtr
+InputRecorder::Create(const ControllerDelegatePtr& aTarget) {
+  auto result = std::make_shared<vrb::ConcreteClass<InputRecorder, InputRecorder::State> >();
+  result->m.target = aTarget;
+  return result;
+}
+
+bool
+InputRecorder::Start(const std::string& aPath) {
+  Stop();
+  m.file = fopen(aPath.c_str(), "wb");
+  if (!m.file) {
+    VRB_ERROR("Unable to open input trace: %s", aPath.c_str());
+    return false;
+  }
+  m.path = aPath;
+  m.frames = 0;
+  m.writer.Clear();
+  m.writer.Write(kTraceMagic);
+  m.writer.Write(kTraceVersion);
+  m.WriteSetup();
+  m.committed = m.writer.Data().size();
+  m.pending.clear();
+  m.stopping = false;
+  m.failed = false;
+  m.thread = std::thread(&State::WriteLoop, &m);
+  VRB_LOG("Recording input trace to %s", aPath.c_str());
+  return true;
+}
+
+void
+InputRecorder::Stop() {
+  if (!m.file) {
+    return;
+  }
+  m.Flush();
+  {
+    std::lock_guard<std::mutex> guard(m.lock);
+    m.stopping = true;
+  }
+  m.condition.notify_one();
+  m.thread.join();
+  fclose(m.file);
+  m.file = nullptr;
+  VRB_LOG("Recorded %u frames of input to %s", m.frames, m.path.c_str());
+}
+
+bool
+InputRecorder::IsRecording() const {
+  return m.file != nullptr;
+}
+
+void
+InputRecorder::CommitFrame(const vrb::Matrix& aHeadTransform) {
+  if (!m.file) {
+    return;
+  }
+  if (m.failed) {
+    Stop();
+    return;
+  }
+  m.writer.Write(Record::Frame);
+  m.writer.WritePose(aHeadTransform);
+  m.frames++;
+  m.committed = m.writer.Data().size();
+  if (m.committed >= kFlushSize) {
+    m.Flush();
+  }
+}
+
+void
+InputRecorder::CreateController(const int32_t aControllerIndex, const int32_t aModelIndex, const std::string& aImmersiveName) {
+  CreateController(aControllerIndex, aModelIndex, aImmersiveName, vrb::Matrix::Identity());
+}
+
+void
+InputRecorder::CreateController(const int32_t aControllerIndex, const int32_t aModelIndex, const std::string& aImmersiveName, const vrb::Matrix& aBeamTransform) {
+  // Matches ControllerContainer, which resets the controller.
+  ControllerSetup& setup = m.Setup(aControllerIndex);
+  setup = ControllerSetup();
+  setup.created = true;
+  setup.modelIndex = aModelIndex;
+  setup.immersiveName = aImmersiveName;
+  setup.beamTransform = aBeamTransform;
+  setup.immersiveBeamTransform = aBeamTransform;
+  if (m.file) {
+    m.writer.WriteRecord(Record::CreateController, aControllerIndex);
+    m.writer.Write(aModelIndex);
+    m.writer.WriteString(aImmersiveName);
+    m.writer.WritePose(aBeamTransform);
+  }
+  m.target->CreateController(aControllerIndex, aModelIndex, aImmersiveName, aBeamTransform);
+}
+
+void
+InputRecorder::SetImmersiveBeamTransform(const int32_t aControllerIndex, const vrb::Matrix& aImmersiveBeamTransform) {
+  m.Setup(aControllerIndex).immersiveBeamTransform = aImmersiveBeamTransform;
+  if (m.file) {
+    m.writer.WriteRecord(Record::SetImmersiveBeamTransform, aControllerIndex);
+    m.writer.WritePose(aImmersiveBeamTransform);
+  }
+  m.target->SetImmersiveBeamTransform(aControllerIndex, aImmersiveBeamTransform);
+}
+
+void
+InputRecorder::SetBeamTransform(const int32_t aControllerIndex, const vrb::Matrix& aBeamTransform) {
+  if (m.file) {
+    m.writer.WriteRecord(Record::SetBeamTransform, aControllerIndex);
+    m.writer.WritePose(aBeamTransform);
+  }
+  m.target->SetBeamTransform(aControllerIndex, aBeamTransform);
+}
+
+void
+InputRecorder::SetBeamColor(const int32_t aControllerIndex, const BeamColor beamColor) {
+  if (m.file) {
+    m.writer.WriteRecord(Record::SetBeamColor, aControllerIndex);
+    m.writer.Write(beamColor);
+  }
+  m.target->SetBeamColor(aControllerIndex, beamColor);
+}
+
+void
+InputRecorder::SetFocused(const int32_t aControllerIndex) {
+  if (m.file) {
+    m.writer.WriteRecord(Record::SetFocused, aControllerIndex);
+  }
+  m.target->SetFocused(aControllerIndex);
+}
+
+void
+InputRecorder::DestroyController(const int32_t aControllerIndex) {
+  m.Setup(aControllerIndex).created = false;
+  if (m.file) {
+    m.writer.WriteRecord(Record::DestroyController, aControllerIndex);
+  }
+  m.target->DestroyController(aControllerIndex);
+}
+
+uint32_t
+InputRecorder::GetControllerCount() {
+  return m.target->GetControllerCount();
+}
+
+void
+InputRecorder::SetCapabilityFlags(const int32_t aControllerIndex, const device::CapabilityFlags aFlags) {
+  m.Setup(aControllerIndex).capabilityFlags = aFlags;
+  if (m.file) {
+    m.writer.WriteRecord(Record::SetCapabilityFlags, aControllerIndex);
+    m.writer.Write(aFlags);
+  }
+  m.target->SetCapabilityFlags(aControllerIndex, aFlags);
+}
+
+void
+InputRecorder::SetEnabled(const int32_t aControllerIndex, const bool aEnabled) {
+  m.Setup(aControllerIndex).enabled = aEnabled;
+  if (m.file) {
+    m.writer.WriteRecord(Record::SetEnabled, aControllerIndex);
+    m.writer.Write(aEnabled);
+  }
+  m.target->SetEnabled(aControllerIndex, aEnabled);
+}
+
+void
+InputRecorder::SetModelVisible(const int32_t aControllerIndex, const bool aVisible) {
+  m.Setup(aControllerIndex).modelVisible = aVisible;
+  if (m.file) {
+    m.writer.WriteRecord(Record::SetModelVisible, aControllerIndex);
+    m.writer.Write(aVisible);
+  }
+  m.target->SetModelVisible(aControllerIndex, aVisible);
+}
+
+void
+InputRecorder::SetControllerType(const int32_t aControllerIndex, device::DeviceType aType) {
+  m.Setup(aControllerIndex).type = aType;
+  if (m.file) {
+    m.writer.WriteRecord(Record::SetControllerType, aControllerIndex);
+    m.writer.Write(aType);
+  }
+  m.target->SetControllerType(aControllerIndex, aType);
+}
+
+void
+InputRecorder::SetTargetRayMode(const int32_t aControllerIndex, device::TargetRayMode aMode) {
+  m.Setup(aControllerIndex).targetRayMode = aMode;
+  if (m.file) {
+    m.writer.WriteRecord(Record::SetTargetRayMode, aControllerIndex);
+    m.writer.Write(aMode);
+  }
+  m.target->SetTargetRayMode(aControllerIndex, aMode);
+}
+
+void
+InputRecorder::SetTransform(const int32_t aControllerIndex, const vrb::Matrix& aTransform) {
+  if (m.file) {
+    m.writer.WriteRecord(Record::SetTransform, aControllerIndex);
+    m.writer.WritePose(aTransform);
+  }
+  m.target->SetTransform(aControllerIndex, aTransform);
+}
+
+void
+InputRecorder::SetButtonCount(const int32_t aControllerIndex, const uint32_t aNumButtons) {
+  m.Setup(aControllerIndex).buttonCount = aNumButtons;
+  if (m.file) {
+    m.writer.WriteRecord(Record::SetButtonCount, aControllerIndex);
+    m.writer.Write(aNumButtons);
+  }
+  m.target->SetButtonCount(aControllerIndex, aNumButtons);
+}
+
+void
+InputRecorder::SetButtonState(const int32_t aControllerIndex, const Button aWhichButton, const int32_t aImmersiveIndex, const bool aPressed, const bool aTouched, const float aImmersiveTrigger) {
+  if (m.file) {
+    m.writer.WriteRecord(Record::SetButtonState, aControllerIndex);
+    m.writer.Write((uint16_t) aWhichButton);
+    m.writer.Write((int8_t) aImmersiveIndex);
+    m.writer.Write((uint8_t) ((aPressed ? 1u : 0u) | (aTouched ? 2u : 0u)));
+    m.writer.Write(aImmersiveTrigger);
+  }
+  m.target->SetButtonState(aControllerIndex, aWhichButton, aImmersiveIndex, aPressed, aTouched, aImmersiveTrigger);
+}
+
+void
+InputRecorder::SetAxes(const int32_t aControllerIndex, const float* aData, const uint32_t aLength) {
+  if (m.file) {
+    m.writer.WriteRecord(Record::SetAxes, aControllerIndex);
+    m.writer.Write((uint8_t) aLength);
+    for (uint32_t index = 0; index < aLength; index++) {
+      m.writer.Write(aData[index]);
+    }
+  }
+  m.target->SetAxes(aControllerIndex, aData, aLength);
+}
+
+void
+InputRecorder::SetInputState(const int32_t aControllerIndex, const ControllerInputState& aState) {
+  if (m.file) {
+    m.writer.WriteRecord(Record::SetInputState, aControllerIndex);
+    m.writer.Write((uint8_t) aState.buttonStateCount);
+    for (uint32_t index = 0; index < aState.buttonStateCount; index++) {
+      const ControllerInputState::ButtonState& button = aState.buttons[index];
+      m.writer.Write((uint16_t) button.button);
+      m.writer.Write((int8_t) button.immersiveIndex);
+      m.writer.Write((uint8_t) ((button.pressed ? 1u : 0u) | (button.touched ? 2u : 0u)));
+      m.writer.Write(button.value);
+    }
+    m.writer.Write((uint8_t) aState.buttonCount);
+    m.writer.Write((uint8_t) aState.axisCount);
+    for (uint32_t index = 0; index < aState.axisCount; index++) {
+      m.writer.Write(aState.axes[index]);
+    }
+    const uint8_t flags = (aState.hasSelectFactor ? kHasSelectFactor : 0) | (aState.hasTouch ? kHasTouch : 0) |
+                          (aState.touchEnded ? kTouchEnded : 0) | (aState.hasScroll ? kHasScroll : 0);
+    m.writer.Write(flags);
+    if (aState.hasSelectFactor) {
+      m.writer.Write(aState.selectFactor);
+    }
+    if (aState.hasTouch) {
+      m.writer.Write(aState.touchX);
+      m.writer.Write(aState.touchY);
+    }
+    if (aState.hasScroll) {
+      m.writer.Write(aState.scrollDeltaX);
+      m.writer.Write(aState.scrollDeltaY);
+    }
+  }
+  m.target->SetInputState(aControllerIndex, aState);
+}
+
+void
+InputRecorder::SetHapticCount(const int32_t aControllerIndex, const uint32_t aNumHaptics) {
+  m.Setup(aControllerIndex).hapticCount = aNumHaptics;
+  if (m.file) {
+    m.writer.WriteRecord(Record::SetHapticCount, aControllerIndex);
+    m.writer.Write(aNumHaptics);
+  }
+  m.target->SetHapticCount(aControllerIndex, aNumHaptics);
+}
+
+uint32_t
+InputRecorder::GetHapticCount(const int32_t aControllerIndex) {
+  return m.target->GetHapticCount(aControllerIndex);
+}
+
+// Haptic feedback flows from the content to the device, so it is not part of the input.
+void
+InputRecorder::SetHapticFeedback(const int32_t aControllerIndex, const uint64_t aInputFrameID, const float aPulseDuration, const float aPulseIntensity) {
+  m.target->SetHapticFeedback(aControllerIndex, aInputFrameID, aPulseDuration, aPulseIntensity);
+}
+
+void
+InputRecorder::GetHapticFeedback(const int32_t aControllerIndex, uint64_t &aInputFrameID, float& aPulseDuration, float& aPulseIntensity) {
+  m.target->GetHapticFeedback(aControllerIndex, aInputFrameID, aPulseDuration, aPulseIntensity);
+}
+
+void
+InputRecorder::SetSelectActionStart(const int32_t aControllerIndex) {
+  if (m.file) {
+    m.writer.WriteRecord(Record::SetSelectActionStart, aControllerIndex);
+  }
+  m.target->SetSelectActionStart(aControllerIndex);
+}
+
+void
+InputRecorder::SetSelectActionStop(const int32_t aControllerIndex) {
+  if (m.file) {
+    m.writer.WriteRecord(Record::SetSelectActionStop, aControllerIndex);
+  }
+  m.target->SetSelectActionStop(aControllerIndex);
+}
+
+void
+InputRecorder::SetSqueezeActionStart(const int32_t aControllerIndex) {
+  if (m.file) {
+    m.writer.WriteRecord(Record::SetSqueezeActionStart, aControllerIndex);
+  }
+  m.target->SetSqueezeActionStart(aControllerIndex);
+}
+
+void
+InputRecorder::SetSqueezeActionStop(const int32_t aControllerIndex) {
+  if (m.file) {
+    m.writer.WriteRecord(Record::SetSqueezeActionStop, aControllerIndex);
+  }
+  m.target->SetSqueezeActionStop(aControllerIndex);
+}
+
+void
+InputRecorder::SetLeftHanded(const int32_t aControllerIndex, const bool aLeftHanded) {
+  m.Setup(aControllerIndex).leftHanded = aLeftHanded;
+  if (m.file) {
+    m.writer.WriteRecord(Record::SetLeftHanded, aControllerIndex);
+    m.writer.Write(aLeftHanded);
+  }
+  m.target->SetLeftHanded(aControllerIndex, aLeftHanded);
+}
+
+void
+InputRecorder::SetTouchPosition(const int32_t aControllerIndex, const float aTouchX, const float aTouchY) {
+  if (m.file) {
+    m.writer.WriteRecord(Record::SetTouchPosition, aControllerIndex);
+    m.writer.Write(aTouchX);
+    m.writer.Write(aTouchY);
+  }
+  m.target->SetTouchPosition(aControllerIndex, aTouchX, aTouchY);
+}
+
+void
+InputRecorder::EndTouch(const int32_t aControllerIndex) {
+  if (m.file) {
+    m.writer.WriteRecord(Record::EndTouch, aControllerIndex);
+  }
+  m.target->EndTouch(aControllerIndex);
+}
+
+void
+InputRecorder::SetScrolledDelta(const int32_t aControllerIndex, const float aScrollDeltaX, const float aScrollDeltaY) {
+  if (m.file) {
+    m.writer.WriteRecord(Record::SetScrolledDelta, aControllerIndex);
+    m.writer.Write(aScrollDeltaX);
+    m.writer.Write(aScrollDeltaY);
+  }
+  m.target->SetScrolledDelta(aControllerIndex, aScrollDeltaX, aScrollDeltaY);
+}
+
+void
+InputRecorder::SetBatteryLevel(const int32_t aControllerIndex, const int32_t aBatteryLevel) {
+  if (m.file) {
+    m.writer.WriteRecord(Record::SetBatteryLevel, aControllerIndex);
+    m.writer.Write((int8_t) aBatteryLevel);
+  }
+  m.target->SetBatteryLevel(aControllerIndex, aBatteryLevel);
+}
+
+bool
+InputRecorder::IsVisible() const {
+  return m.target->IsVisible();
+}
+
+void
+InputRecorder::SetVisible(const bool aVisible) {
+  m.visible = aVisible;
+  if (m.file) {
+    m.writer.WriteRecord(Record::SetVisible, 0);
+    m.writer.Write(aVisible);
+  }
+  m.target->SetVisible(aVisible);
+}
+
+void
+InputRecorder::SetGazeModeIndex(const int32_t aControllerIndex) {
+  m.gazeIndex = aControllerIndex;
+  if (m.file) {
+    m.writer.WriteRecord(Record::SetGazeModeIndex, aControllerIndex);
+  }
+  m.target->SetGazeModeIndex(aControllerIndex);
+}
+
+// Skinning matrices only affect how the hand model is drawn, so they are not recorded.
+void
+InputRecorder::SetJointsMatrices(const int32_t aControllerIndex, const std::string name, const float *matrices) {
+  m.target->SetJointsMatrices(aControllerIndex, name, matrices);
+}
+
+void
+InputRecorder::SetHandJointLocations(const int32_t aControllerIndex, std::vector<vrb::Matrix> jointTransforms, std::vector<float> jointRadii) {
+  if (m.file) {
+    m.writer.WriteRecord(Record::SetHandJointLocations, aControllerIndex);
+    m.writer.Write((uint8_t) jointTransforms.size());
+    for (const vrb::Matrix& transform: jointTransforms) {
+      m.writer.WritePose(transform);
+    }
+    m.writer.Write((uint8_t) jointRadii.size());
+    for (const float radius: jointRadii) {
+      m.writer.Write(radius);
+    }
+  }
+  m.target->SetHandJointLocations(aControllerIndex, std::move(jointTransforms), std::move(jointRadii));
+}
+
+void
+InputRecorder::SetAimEnabled(const int32_t aControllerIndex, bool aEnabled) {
+  m.Setup(aControllerIndex).aimEnabled = aEnabled;
+  if (m.file) {
+    m.writer.WriteRecord(Record::SetAimEnabled, aControllerIndex);
+    m.writer.Write(aEnabled);
+  }
+  m.target->SetAimEnabled(aControllerIndex, aEnabled);
+}
+
+void
+InputRecorder::SetHandActionEnabled(const int32_t aControllerIndex, bool aEnabled) {
+  m.Setup(aControllerIndex).handActionEnabled = aEnabled;
+  if (m.file) {
+    m.writer.WriteRecord(Record::SetHandActionEnabled, aControllerIndex);
+    m.writer.Write(aEnabled);
+  }
+  m.target->SetHandActionEnabled(aControllerIndex, aEnabled);
+}
+
+void
+InputRecorder::SetMode(const int32_t aControllerIndex, ControllerMode aMode) {
+  m.Setup(aControllerIndex).mode = aMode;
+  if (m.file) {
+    m.writer.WriteRecord(Record::SetMode, aControllerIndex);
+    m.writer.Write(aMode);
+  }
+  m.target->SetMode(aControllerIndex, aMode);
+}
+
+void
+InputRecorder::SetSelectFactor(const int32_t aControllerIndex, float aFactor) {
+  if (m.file) {
+    m.writer.WriteRecord(Record::SetSelectFactor, aControllerIndex);
+    m.writer.Write(aFactor);
+  }
+  m.target->SetSelectFactor(aControllerIndex, aFactor);
+}
+
+InputRecorder::InputRecorder(State& aState) : m(aState) {
+}
+
+InputRecorder::~InputRecorder() {
+  Stop();
+}
+
+struct InputTracePlayer::State {
+  std::vector<uint8_t> data;
+  size_t firstRecord = 0;
+  size_t offset = 0;
+  uint32_t frameCount = 0;
+  uint32_t playedFrames = 0;
+  bool loop = false;
+  vrb::Matrix head = vrb::Matrix::Identity();
+
+  // Returns false when the frame is incomplete or has an unknown record.
+  bool PlayRecords(Reader& aReader, ControllerDelegate* aDelegate) {
+    while (!aReader.AtEnd()) {
+      const Record record = aReader.Read<Record>();
+      if (record == Record::Frame) {
+        const vrb::Matrix frameHead = aReader.ReadPose();
+        if (aDelegate && !aReader.Failed()) {
+          head = frameHead;
+        }
+        return !aReader.Failed();
+      }
+      const int32_t index = aReader.Read<uint8_t>();
+      if (!PlayRecord(record, index, aReader, aDelegate) || aReader.Failed()) {
+        return false;
+      }
+    }
+    return false;
+  }
+
+  // A null aDelegate only parses the record, to count the frames of a trace.
+  bool PlayRecord(const Record aRecord, const int32_t aIndex, Reader& aReader, ControllerDelegate* aDelegate) {
+    switch (aRecord) {
+      case Record::CreateController: {
+        const int32_t modelIndex = aReader.Read<int32_t>();
+        const std::string name = aReader.ReadString();
+        const vrb::Matrix beam = aReader.ReadPose();
+        if (aDelegate) aDelegate->CreateController(aIndex, modelIndex, name, beam);
+        break;
+      }
+      case Record::DestroyController:
+        if (aDelegate) aDelegate->DestroyController(aIndex);
+        break;
+      case Record::SetEnabled: {
+        const bool enabled = aReader.Read<uint8_t>() != 0;
+        if (aDelegate) aDelegate->SetEnabled(aIndex, enabled);
+        break;
+      }
+      case Record::SetCapabilityFlags: {
+        const auto flags = aReader.Read<device::CapabilityFlags>();
+        if (aDelegate) aDelegate->SetCapabilityFlags(aIndex, flags);
+        break;
+      }
+      case Record::SetControllerType: {
+        const auto type = aReader.Read<device::DeviceType>();
+        if (aDelegate) aDelegate->SetControllerType(aIndex, type);
+        break;
+      }
+      case Record::SetTargetRayMode: {
+        const auto mode = aReader.Read<device::TargetRayMode>();
+        if (aDelegate) aDelegate->SetTargetRayMode(aIndex, mode);
+        break;
+      }
+      case Record::SetModelVisible: {
+        const bool visible = aReader.Read<uint8_t>() != 0;
+        if (aDelegate) aDelegate->SetModelVisible(aIndex, visible);
+        break;
+      }
+      case Record::SetTransform: {
+        const vrb::Matrix transform = aReader.ReadPose();
+        if (aDelegate) aDelegate->SetTransform(aIndex, transform);
+        break;
+      }
+      case Record::SetBeamTransform: {
+        const vrb::Matrix transform = aReader.ReadPose();
+        if (aDelegate) aDelegate->SetBeamTransform(aIndex, transform);
+        break;
+      }
+      case Record::SetImmersiveBeamTransform: {
+        const vrb::Matrix transform = aReader.ReadPose();
+        if (aDelegate) aDelegate->SetImmersiveBeamTransform(aIndex, transform);
+        break;
+      }
+      case Record::SetButtonCount: {
+        const uint32_t count = aReader.Read<uint32_t>();
+        if (aDelegate) aDelegate->SetButtonCount(aIndex, count);
+        break;
+      }
+      case Record::SetButtonState: {
+        const auto button = (ControllerDelegate::Button) aReader.Read<uint16_t>();
+        const int32_t immersiveIndex = aReader.Read<int8_t>();
+        const uint8_t state = aReader.Read<uint8_t>();
+        const float value = aReader.Read<float>();
+        if (aDelegate) aDelegate->SetButtonState(aIndex, button, immersiveIndex, (state & 1u) != 0, (state & 2u) != 0, value);
+        break;
+      }
+      case Record::SetAxes: {
+        float axes[ControllerInputState::kMaxAxes];
+        const uint32_t length = aReader.Read<uint8_t>();
+        if (length > ControllerInputState::kMaxAxes) {
+          return false;
+        }
+        for (uint32_t axis = 0; axis < length; axis++) {
+          axes[axis] = aReader.Read<float>();
+        }
+        if (aDelegate) aDelegate->SetAxes(aIndex, axes, length);
+        break;
+      }
+      case Record::SetInputState: {
+        ControllerInputState state;
+        state.buttonStateCount = aReader.Read<uint8_t>();
+        if (state.buttonStateCount > ControllerInputState::kMaxButtons) {
+          return false;
+        }
+        for (uint32_t button = 0; button < state.buttonStateCount; button++) {
+          ControllerInputState::ButtonState& buttonState = state.buttons[button];
+          buttonState.button = (ControllerDelegate::Button) aReader.Read<uint16_t>();
+          buttonState.immersiveIndex = aReader.Read<int8_t>();
+          const uint8_t pressed = aReader.Read<uint8_t>();
+          buttonState.pressed = (pressed & 1u) != 0;
+          buttonState.touched = (pressed & 2u) != 0;
+          buttonState.value = aReader.Read<float>();
+        }
+        state.buttonCount = aReader.Read<uint8_t>();
+        state.axisCount = aReader.Read<uint8_t>();
+        if (state.axisCount > ControllerInputState::kMaxAxes) {
+          return false;
+        }
+        for (uint32_t axis = 0; axis < state.axisCount; axis++) {
+          state.axes[axis] = aReader.Read<float>();
+        }
+        const uint8_t flags = aReader.Read<uint8_t>();
+        state.hasSelectFactor = (flags & kHasSelectFactor) != 0;
+        state.hasTouch = (flags & kHasTouch) != 0;
+        state.touchEnded = (flags & kTouchEnded) != 0;
+        state.hasScroll = (flags & kHasScroll) != 0;
+        if (state.hasSelectFactor) {
+          state.selectFactor = aReader.Read<float>();
+        }
+        if (state.hasTouch) {
+          state.touchX = aReader.Read<float>();
+          state.touchY = aReader.Read<float>();
+        }
+        if (state.hasScroll) {
+          state.scrollDeltaX = aReader.Read<float>();
+          state.scrollDeltaY = aReader.Read<float>();
+        }
+        if (aDelegate) aDelegate->SetInputState(aIndex, state);
+        break;
+      }
+      case Record::SetHapticCount: {
+        const uint32_t count = aReader.Read<uint32_t>();
+        if (aDelegate) aDelegate->SetHapticCount(aIndex, count);
+        break;
+      }
+      case Record::SetSelectActionStart:
+        if (aDelegate) aDelegate->SetSelectActionStart(aIndex);
+        break;
+      case Record::SetSelectActionStop:
+        if (aDelegate) aDelegate->SetSelectActionStop(aIndex);
+        break;
+      case Record::SetSqueezeActionStart:
+        if (aDelegate) aDelegate->SetSqueezeActionStart(aIndex);
+        break;
+      case Record::SetSqueezeActionStop:
+        if (aDelegate) aDelegate->SetSqueezeActionStop(aIndex);
+        break;
+      case Record::SetLeftHanded: {
+        const bool leftHanded = aReader.Read<uint8_t>() != 0;
+        if (aDelegate) aDelegate->SetLeftHanded(aIndex, leftHanded);
+        break;
+      }
+      case Record::SetTouchPosition: {
+        const float x = aReader.Read<float>();
+        const float y = aReader.Read<float>();
+        if (aDelegate) aDelegate->SetTouchPosition(aIndex, x, y);
+        break;
+      }
+      case Record::EndTouch:
+        if (aDelegate) aDelegate->EndTouch(aIndex);
+        break;
+      case Record::SetScrolledDelta: {
+        const float x = aReader.Read<float>();
+        const float y = aReader.Read<float>();
+        if (aDelegate) aDelegate->SetScrolledDelta(aIndex, x, y);
+        break;
+      }
+      case Record::SetBatteryLevel: {
+        const int32_t level = aReader.Read<int8_t>();
+        if (aDelegate) aDelegate->SetBatteryLevel(aIndex, level);
+        break;
+      }
+      case Record::SetHandJointLocations: {
+        std::vector<vrb::Matrix> transforms(aReader.Read<uint8_t>());
+        for (vrb::Matrix& transform: transforms) {
+          transform = aReader.ReadPose();
+        }
+        std::vector<float> radii(aReader.Read<uint8_t>());
+        for (float& radius: radii) {
+          radius = aReader.Read<float>();
+        }
+        if (aDelegate) aDelegate->SetHandJointLocations(aIndex, std::move(transforms), std::move(radii));
+        break;
+      }
+      case Record::SetAimEnabled: {
+        const bool enabled = aReader.Read<uint8_t>() != 0;
+        if (aDelegate) aDelegate->SetAimEnabled(aIndex, enabled);
+        break;
+      }
+      case Record::SetHandActionEnabled: {
+        const bool enabled = aReader.Read<uint8_t>() != 0;
+        if (aDelegate) aDelegate->SetHandActionEnabled(aIndex, enabled);
+        break;
+      }
+      case Record::SetMode: {
+        const auto mode = aReader.Read<ControllerMode>();
+        if (aDelegate) aDelegate->SetMode(aIndex, mode);
+        break;
+      }
+      case Record::SetSelectFactor: {
+        const float factor = aReader.Read<float>();
+        if (aDelegate) aDelegate->SetSelectFactor(aIndex, factor);
+        break;
+      }
+      case Record::SetFocused:
+        if (aDelegate) aDelegate->SetFocused(aIndex);
+        break;
+      case Record::SetBeamColor: {
+        const auto color = aReader.Read<BeamColor>();
+        if (aDelegate) aDelegate->SetBeamColor(aIndex, color);
+        break;
+      }
+      case Record::SetVisible: {
+        const bool visible = aReader.Read<uint8_t>() != 0;
+        if (aDelegate) aDelegate->SetVisible(visible);
+        break;
+      }
+      case Record::SetGazeModeIndex:
+        if (aDelegate) aDelegate->SetGazeModeIndex(aIndex);
+        break;
+      default:
+        VRB_ERROR("Unknown input trace record: %d", (int) aRecord);
+        return false;
+    }
+    return true;
+  }
+};
+
+InputTracePlayerPtr
+InputTracePlayer::Create() {
+  return std::make_shared<vrb::ConcreteClass<InputTracePlayer, InputTracePlayer::State> >();
+}
+
+bool
+InputTracePlayer::Load(const std::string& aPath) {
+  FILE* file = fopen(aPath.c_str(), "rb");
+  if (!file) {
+    VRB_ERROR("Unable to open input trace: %s", aPath.c_str());
+    return false;
+  }
+  std::vector<uint8_t> data;
+  uint8_t chunk[16384];
+  size_t read = 0;
+  while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+    data.insert(data.end(), chunk, chunk + read);
+  }
+  fclose(file);
+
+  Reader reader(data, 0);
+  if (reader.Read<uint32_t>() != kTraceMagic || reader.Read<uint32_t>() != kTraceVersion) {
+    VRB_ERROR("%s is not a supported input trace", aPath.c_str());
+    return false;
+  }
+  const size_t firstRecord = reader.Offset();
+  // Counts the complete frames. A trailing partial frame, left by a recording that was not
+  // stopped, is ignored.
+  uint32_t frameCount = 0;
+  size_t end = firstRecord;
+  while (m.PlayRecords(reader, nullptr)) {
+    frameCount++;
+    end = reader.Offset();
+  }
+  data.resize(end);
+  m.data = std::move(data);
+  m.firstRecord = firstRecord;
+  m.offset = firstRecord;
+  m.frameCount = frameCount;
+  m.playedFrames = 0;
+  m.head = vrb::Matrix::Identity();
+  VRB_LOG("Loaded %u frames of input from %s", frameCount, aPath.c_str());
+  return frameCount > 0;
+}
+
+void
+InputTracePlayer::SetLoop(const bool aLoop) {
+  m.loop = aLoop;
+}
+
+bool
+InputTracePlayer::PlayFrame(ControllerDelegate& aDelegate) {
+  if (m.frameCount == 0) {
+    return false;
+  }
+  if (m.offset >= m.data.size()) {
+    if (!m.loop) {
+      return false;
+    }
+    m.offset = m.firstRecord;
+  }
+  Reader reader(m.data, m.offset);
+  const bool played = m.PlayRecords(reader, &aDelegate);
+  m.offset = reader.Offset();
+  if (played) {
+    m.playedFrames++;
+  }
+  return played;
+}
+
+const vrb::Matrix&
+InputTracePlayer::GetHeadTransform() const {
+  return m.head;
+}
+
+uint32_t
+InputTracePlayer::GetFrameCount() const {
+  return m.frameCount;
+}
+
+uint32_t
+InputTracePlayer::GetPlayedFrames() const {
+  return m.playedFrames;
+}
+
+InputTracePlayer::InputTracePlayer(State& aState) : m(aState) {
+}
+
+} // namespace crow
@@ -0,0 +1,121 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_INPUT_TRACE_DOT_H
+#define VRBROWSER_INPUT_TRACE_DOT_H
+
+#include "ControllerDelegate.h"
+
+#include "vrb/Forward.h"
+#include "vrb/MacroUtils.h"
+
+#include <memory>
+#include <string>
+
+namespace crow {
+
+class InputRecorder;
+typedef std::shared_ptr<InputRecorder> InputRecorderPtr;
+
+class InputTracePlayer;
+typedef std::shared_ptr<InputTracePlayer> InputTracePlayerPtr;
+
+// Forwards every call to the ControllerDelegate it wraps and, while recording, also writes the
+// controller updates made by the device to an input trace file. The trace is split in frames by
+// CommitFrame(), which also stores the head transform. Poses are stored as a position and an
+// orientation unless they are scaled, so that hand tracking sessions stay small. Committed frames
+// are buffered and written to the file by a worker thread.
+class InputRecorder : public ControllerDelegate {
+public:
+  static InputRecorderPtr Create(const ControllerDelegatePtr& aTarget);
+  // Replaces the previous trace at aPath. The controllers that already exist are written first so
+  // that the trace can be replayed from its first frame.
+  bool Start(const std::string& aPath);
+  // Waits for the buffered frames to be written and closes the trace.
+  void Stop();
+  bool IsRecording() const;
+  // Ends the frame with the updates made since the last call. Must be called once per frame,
+  // after the device has processed its events.
+  void CommitFrame(const vrb::Matrix& aHeadTransform);
+  // crow::ControllerDelegate interface
+  void CreateController(const int32_t aControllerIndex, const int32_t aModelIndex, const std::string& aImmersiveName) override;
+  void CreateController(const int32_t aControllerIndex, const int32_t aModelIndex, const std::string& aImmersiveName, const vrb::Matrix& aBeamTransform) override;
+  void SetImmersiveBeamTransform(const int32_t aControllerIndex, const vrb::Matrix& aImmersiveBeamTransform) override;
+  void SetBeamTransform(const int32_t aControllerIndex, const vrb::Matrix& aBeamTransform) override;
+  void SetBeamColor(const int32_t aControllerIndex, const BeamColor beamColor) override;
+  void SetFocused(const int32_t aControllerIndex) override;
+  void DestroyController(const int32_t aControllerIndex) override;
+  uint32_t GetControllerCount() override;
+  void SetCapabilityFlags(const int32_t aControllerIndex, const device::CapabilityFlags aFlags) override;
+  void SetEnabled(const int32_t aControllerIndex, const bool aEnabled) override;
+  void SetModelVisible(const int32_t aControllerIndex, const bool aVisible) override;
+  void SetControllerType(const int32_t aControllerIndex, device::DeviceType aType) override;
+  void SetTargetRayMode(const int32_t aControllerIndex, device::TargetRayMode aMode) override;
+  void SetTransform(const int32_t aControllerIndex, const vrb::Matrix& aTransform) override;
+  void SetButtonCount(const int32_t aControllerIndex, const uint32_t aNumButtons) override;
+  void SetButtonState(const int32_t aControllerIndex, const Button aWhichButton, const int32_t aImmersiveIndex, const bool aPressed, const bool aTouched, const float aImmersiveTrigger = -1.0f) override;
+  void SetAxes(const int32_t aControllerIndex, const float* aData, const uint32_t aLength) override;
+  void SetInputState(const int32_t aControllerIndex, const ControllerInputState& aState) override;
+  void SetHapticCount(const int32_t aControllerIndex, const uint32_t aNumHaptics) override;
+  uint32_t GetHapticCount(const int32_t aControllerIndex) override;
+  void SetHapticFeedback(const int32_t aControllerIndex, const uint64_t aInputFrameID, const float aPulseDuration, const float aPulseIntensity) override;
+  void GetHapticFeedback(const int32_t aControllerIndex, uint64_t &aInputFrameID, float& aPulseDuration, float& aPulseIntensity) override;
+  void SetSelectActionStart(const int32_t aControllerIndex) override;
+  void SetSelectActionStop(const int32_t aControllerIndex) override;
+  void SetSqueezeActionStart(const int32_t aControllerIndex) override;
+  void SetSqueezeActionStop(const int32_t aControllerIndex) override;
+  void SetLeftHanded(const int32_t aControllerIndex, const bool aLeftHanded) override;
+  void SetTouchPosition(const int32_t aControllerIndex, const float aTouchX, const float aTouchY) override;
+  void EndTouch(const int32_t aControllerIndex) override;
+  void SetScrolledDelta(const int32_t aControllerIndex, const float aScrollDeltaX, const float aScrollDeltaY) override;
+  void SetBatteryLevel(const int32_t aControllerIndex, const int32_t aBatteryLevel) override;
+  bool IsVisible() const override;
+  void SetVisible(const bool aVisible) override;
+  void SetGazeModeIndex(const int32_t aControllerIndex) override;
+  void SetJointsMatrices(const int32_t aControllerIndex, const std::string name, const float *matrices) override;
+  void SetHandJointLocations(const int32_t aControllerIndex, std::vector<vrb::Matrix> jointTransforms, std::vector<float> jointRadii) override;
+  void SetAimEnabled(const int32_t aControllerIndex, bool aEnabled = true) override;
+  void SetHandActionEnabled(const int32_t aControllerIndex, bool aEnabled = false) override;
+  void SetMode(const int32_t aControllerIndex, ControllerMode aMode = ControllerMode::None) override;
+  void SetSelectFactor(const int32_t aControllerIndex, float aFactor = 1.0f) override;
+protected:
+  struct State;
+  InputRecorder(State& aState);
+  ~InputRecorder();
+private:
+  State& m;
+  InputRecorder() = delete;
+  VRB_NO_DEFAULTS(InputRecorder)
+};
+
+// Plays an input trace written by InputRecorder back into a ControllerDelegate, one recorded frame
+// at a time.
+class InputTracePlayer {
+public:
+  static InputTracePlayerPtr Create();
+  // Reads the whole trace in memory so that playing it back does not touch the file system.
+  bool Load(const std::string& aPath);
+  // Starts again from the first frame once the trace ends.
+  void SetLoop(const bool aLoop);
+  // Applies the controller updates of the next frame to aDelegate. Returns false once the trace
+  // ended and it is not looping.
+  bool PlayFrame(ControllerDelegate& aDelegate);
+  // Head transform of the last played frame.
+  const vrb::Matrix& GetHeadTransform() const;
+  uint32_t GetFrameCount() const;
+  uint32_t GetPlayedFrames() const;
+protected:
+  struct State;
+  InputTracePlayer(State& aState);
+  ~InputTracePlayer() = default;
+private:
+  State& m;
+  InputTracePlayer() = delete;
+  VRB_NO_DEFAULTS(InputTracePlayer)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_INPUT_TRACE_DOT_H
@@ -0,0 +1,28 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_MATRIX_UTILS_DOT_H
+#define VRBROWSER_MATRIX_UTILS_DOT_H
+
+#include "vrb/Matrix.h"
+#include "vrb/Vector.h"
+
+#include <algorithm>
+
+namespace crow {
+
+// Largest scale the matrix applies along one of its axes. A sphere transformed by the matrix fits
+// in a sphere whose radius is scaled by this factor.
+inline float
+MaxAxisScale(const vrb::Matrix& aMatrix) {
+  const float x = aMatrix.MultiplyDirection(vrb::Vector(1.0f, 0.0f, 0.0f)).Magnitude();
+  const float y = aMatrix.MultiplyDirection(vrb::Vector(0.0f, 1.0f, 0.0f)).Magnitude();
+  const float z = aMatrix.MultiplyDirection(vrb::Vector(0.0f, 0.0f, 1.0f)).Magnitude();
+  return std::max(x, std::max(y, z));
+}
+
+} // namespace crow
+
+#endif // VRBROWSER_MATRIX_UTILS_DOT_H
@@ -0,0 +1,229 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "Profiler.h"
+#include "vrb/Logger.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+const uint64_t kSamplesPerThread = 8192;
+
+struct Sample {
+  const char* name;
+  int64_t start;
+  int64_t end;
+};
+
+// Each slot is a seqlock: the owning thread, the only writer, makes |sequence| odd while it stores
+// the fields and then sets it to 2 * (index + 1) for the sample at |index|. Readers keep a copy only
+// if they saw that same even value before and after reading the fields, so a slot that is being
+// overwritten is skipped instead of being read torn.
+struct Slot {
+  std::atomic<uint64_t> sequence { 0 };
+  std::atomic<const char*> name { nullptr };
+  std::atomic<int64_t> start { 0 };
+  std::atomic<int64_t> end { 0 };
+};
+
+struct ThreadBuffer {
+  int32_t tid = 0;
+  std::atomic<const char*> name { nullptr };
+  std::atomic<uint64_t> writeIndex { 0 };
+  std::array<Slot, kSamplesPerThread> slots;
+};
+
+// Samples of one thread copied out of its buffer, so that they can be written from another thread.
+struct TraceTrack {
+  int32_t tid;
+  const char* name;
+  std::vector<Sample> samples;
+};
+
+std::mutex sBuffersLock;
+std::vector<std::unique_ptr<ThreadBuffer>> sBuffers;
+std::string sTracePath;
+thread_local ThreadBuffer* tBuffer = nullptr;
+
+// Serializes the trace writers.
+std::mutex sWriterLock;
+
+ThreadBuffer*
+CreateBuffer(const int32_t aTid) {
+  auto buffer = std::make_unique<ThreadBuffer>();
+  buffer->tid = aTid;
+  ThreadBuffer* result = buffer.get();
+  std::lock_guard<std::mutex> lock(sBuffersLock);
+  // Buffers outlive their threads so that their last samples can still be exported.
+  sBuffers.push_back(std::move(buffer));
+  return result;
+}
+
+ThreadBuffer&
+CurrentThreadBuffer() {
+  if (!tBuffer) {
+    tBuffer = CreateBuffer((int32_t) gettid());
+  }
+  return *tBuffer;
+}
+
+ThreadBuffer&
+GPUBuffer() {
+  // Thread ids are positive, so the GPU track can not clash with a real thread.
+  static ThreadBuffer* sGPUBuffer = [] {
+    ThreadBuffer* buffer = CreateBuffer(-1);
+    buffer->name.store("GPU", std::memory_order_relaxed);
+    return buffer;
+  }();
+  return *sGPUBuffer;
+}
+
+void
+Append(ThreadBuffer& aBuffer, const char* aName, const int64_t aStart, const int64_t aEnd) {
+  const uint64_t index = aBuffer.writeIndex.load(std::memory_order_relaxed);
+  Slot& slot = aBuffer.slots[index % kSamplesPerThread];
+  slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.name.store(aName, std::memory_order_relaxed);
+  slot.start.store(aStart, std::memory_order_relaxed);
+  slot.end.store(aEnd, std::memory_order_relaxed);
+  slot.sequence.store(2 * (index + 1), std::memory_order_release);
+  aBuffer.writeIndex.store(index + 1, std::memory_order_release);
+}
+
+void
+CopySamples(const ThreadBuffer& aBuffer, std::vector<Sample>& aResult) {
+  aResult.clear();
+  const uint64_t end = aBuffer.writeIndex.load(std::memory_order_acquire);
+  uint64_t begin = end > kSamplesPerThread ? end - kSamplesPerThread : 0;
+  for (uint64_t index = begin; index < end; ++index) {
+    const Slot& slot = aBuffer.slots[index % kSamplesPerThread];
+    const uint64_t expected = 2 * (index + 1);
+    if (slot.sequence.load(std::memory_order_acquire) != expected) {
+      continue;
+    }
+    Sample sample;
+    sample.name = slot.name.load(std::memory_order_relaxed);
+    sample.start = slot.start.load(std::memory_order_relaxed);
+    sample.end = slot.end.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.sequence.load(std::memory_order_relaxed) == expected) {
+      aResult.push_back(sample);
+    }
+  }
+}
+
+void
+WriteTraceFile(const std::string& aFileName, const std::string& aReason, const std::vector<TraceTrack>& aTracks) {
+  FILE* file = fopen(aFileName.c_str(), "w");
+  if (!file) {
+    VRB_ERROR("Unable to open trace file: %s", aFileName.c_str());
+    return;
+  }
+
+  const int pid = (int) getpid();
+  size_t sampleCount = 0;
+  fprintf(file, "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"reason\":\"%s\"},\"traceEvents\":[", aReason.c_str());
+  const char* separator = "";
+  for (const TraceTrack& track: aTracks) {
+    if (track.name) {
+      fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+              separator, pid, track.tid, track.name);
+      separator = ",";
+    }
+    for (const Sample& sample: track.samples) {
+      fprintf(file, "%s\n{\"name\":\"%s\",\"cat\":\"wolvic\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+              separator, sample.name, pid, track.tid, sample.start / 1000.0, (sample.end - sample.start) / 1000.0);
+      separator = ",";
+    }
+    sampleCount += track.samples.size();
+  }
+  fprintf(file, "\n]}\n");
+  const bool written = ferror(file) == 0;
+  fclose(file);
+  if (written) {
+    VRB_LOG("Wrote %zu profiler samples to %s", sampleCount, aFileName.c_str());
+  } else {
+    VRB_ERROR("Failed to write trace file: %s", aFileName.c_str());
+  }
+}
+
+} // namespace
+
+namespace crow {
+
+std::atomic<bool> Profiler::sEnabled { false };
+
+void
+Profiler::SetEnabled(const bool aEnabled) {
+  sEnabled.store(aEnabled, std::memory_order_relaxed);
+}
+
+int64_t
+Profiler::Now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void
+Profiler::SetThreadName(const char* aName) {
+  CurrentThreadBuffer().name.store(aName, std::memory_order_relaxed);
+}
+
+void
+Profiler::Record(const char* aName, const int64_t aStart, const int64_t aEnd) {
+  Append(CurrentThreadBuffer(), aName, aStart, aEnd);
+}
+
+void
+Profiler::RecordGPU(const char* aName, const int64_t aStart, const int64_t aEnd) {
+  Append(GPUBuffer(), aName, aStart, aEnd);
+}
+
+void
+Profiler::SetTracePath(const std::string& aPath) {
+  std::lock_guard<std::mutex> lock(sBuffersLock);
+  sTracePath = aPath;
+}
+
+bool
+Profiler::WriteTrace(const char* aReason) {
+  if (!IsEnabled()) {
+    return false;
+  }
+  std::string fileName;
+  std::vector<TraceTrack> tracks;
+  {
+    std::lock_guard<std::mutex> lock(sBuffersLock);
+    if (sTracePath.empty()) {
+      VRB_WARN("Unable to write %s trace, no trace path set", aReason);
+      return false;
+    }
+    fileName = sTracePath + "/wolvic-trace-" + aReason + ".json";
+    tracks.reserve(sBuffers.size());
+    for (const std::unique_ptr<ThreadBuffer>& buffer: sBuffers) {
+      tracks.push_back({buffer->tid, buffer->name.load(std::memory_order_relaxed), {}});
+      CopySamples(*buffer, tracks.back().samples);
+    }
+  }
+
+  std::string reason(aReason);
+  std::thread([fileName, reason, tracks]() {
+    std::lock_guard<std::mutex> lock(sWriterLock);
+    WriteTraceFile(fileName, reason, tracks);
+  }).detach();
+  return true;
+}
+
+} // namespace crow
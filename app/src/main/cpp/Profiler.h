@@ -0,0 +1,77 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_PROFILER_DOT_H
+#define VRBROWSER_PROFILER_DOT_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Scoped timers are compiled in unless WOLVIC_PROFILER is defined to 0.
+#ifndef WOLVIC_PROFILER
+#define WOLVIC_PROFILER 1
+#endif
+
+namespace crow {
+
+// Records the duration of named phases into a ring buffer owned by each thread, so recording never
+// takes a lock. The most recent samples of every thread can be written as a Chrome trace JSON file,
+// which can be opened in chrome://tracing or https://ui.perfetto.dev. Nothing is recorded until
+// SetEnabled(true) is called, which the developer options do.
+namespace Profiler {
+extern std::atomic<bool> sEnabled;
+
+inline bool IsEnabled() {
+  return sEnabled.load(std::memory_order_relaxed);
+}
+void SetEnabled(const bool aEnabled);
+// Steady clock time in nanoseconds.
+int64_t Now();
+// Names the calling thread in the exported traces.
+void SetThreadName(const char* aName);
+// aName must outlive the profiler, string literals are expected.
+void Record(const char* aName, const int64_t aStart, const int64_t aEnd);
+// Samples measured on the GPU, already converted to the Now() time base. They are shown on their
+// own track. Must only be called from the render thread.
+void RecordGPU(const char* aName, const int64_t aStart, const int64_t aEnd);
+// Directory where traces are written, usually the app temporary path.
+void SetTracePath(const std::string& aPath);
+// Copies the samples of all threads and writes them to <trace path>/wolvic-trace-<aReason>.json on a
+// background thread, replacing the previous trace written for the same reason. Returns false if the
+// profiler is disabled or no trace path is set, otherwise the trace is queued and failures to write
+// it are logged.
+bool WriteTrace(const char* aReason);
+} // namespace Profiler
+
+class ProfilerScope {
+public:
+  explicit ProfilerScope(const char* aName)
+      : mName(aName)
+      , mStart(Profiler::IsEnabled() ? Profiler::Now() : 0)
+  {}
+  ~ProfilerScope() {
+    if (mStart) {
+      Profiler::Record(mName, mStart, Profiler::Now());
+    }
+  }
+private:
+  const char* mName;
+  const int64_t mStart;
+  ProfilerScope(const ProfilerScope&) = delete;
+  ProfilerScope& operator=(const ProfilerScope&) = delete;
+};
+
+} // namespace crow
+
+#if WOLVIC_PROFILER
+#define PROFILER_CONCAT_INNER(aA, aB) aA##aB
+#define PROFILER_CONCAT(aA, aB) PROFILER_CONCAT_INNER(aA, aB)
+#define PROFILE_SCOPE(aName) crow::ProfilerScope PROFILER_CONCAT(profilerScope, __LINE__)(aName)
+#else
+#define PROFILE_SCOPE(aName)
+#endif
+
+#endif // VRBROWSER_PROFILER_DOT_H
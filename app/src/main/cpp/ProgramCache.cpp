@@ -0,0 +1,279 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "ProgramCache.h"
+
+#include "vrb/GLError.h"
+#include "vrb/Logger.h"
+#include "vrb/ShaderUtil.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <vector>
+
+namespace {
+
+const uint32_t kMagic = 0x43425057; // "WPBC"
+const uint32_t kVersion = 2;
+const uint64_t kHashOffset = 0xcbf29ce484222325ull;
+const uint64_t kHashPrime = 0x100000001b3ull;
+// Larger binaries are assumed to be corrupt.
+const uint32_t kMaxBinaryLength = 16 * 1024 * 1024;
+
+struct Header {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t device;
+  uint64_t key;
+  uint32_t format;
+  uint32_t length;
+};
+
+std::string sPath;
+bool sPathCreated = false;
+bool sPathPruned = false;
+uint64_t sDeviceKey = 0;
+
+// FNV-1a, each string includes its terminator so that the key does not depend on where one string
+// ends and the next one starts.
+void
+Hash(uint64_t& aHash, const char* aString) {
+  const char* current = aString ? aString : "";
+  do {
+    aHash = (aHash ^ (uint8_t) *current) * kHashPrime;
+  } while (*current++);
+}
+
+uint64_t
+DeviceKey() {
+  uint64_t result = kHashOffset;
+  Hash(result, (const char*) glGetString(GL_RENDERER));
+  Hash(result, (const char*) glGetString(GL_VERSION));
+  return result;
+}
+
+uint64_t
+ProgramKey(const std::string& aVertexSource, const std::string& aFragmentSource) {
+  uint64_t result = sDeviceKey;
+  Hash(result, aVertexSource.c_str());
+  Hash(result, aFragmentSource.c_str());
+  return result;
+}
+
+std::string
+BinaryPath(const uint64_t aKey) {
+  char name[32];
+  snprintf(name, sizeof(name), "/%016" PRIx64 ".bin", aKey);
+  return sPath + name;
+}
+
+bool
+SupportsBinaries() {
+  GLint formats = 0;
+  VRB_GL_CHECK(glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats));
+  return formats > 0;
+}
+
+bool
+CreateDirectory() {
+  if (!sPathCreated) {
+    sPathCreated = mkdir(sPath.c_str(), 0700) == 0 || errno == EEXIST;
+    if (!sPathCreated) {
+      VRB_WARN("Unable to create the program cache directory %s", sPath.c_str());
+    }
+  }
+  return sPathCreated;
+}
+
+bool
+HasSuffix(const char* aName, const char* aSuffix) {
+  const size_t length = strlen(aName);
+  const size_t suffixLength = strlen(aSuffix);
+  return length >= suffixLength && strcmp(aName + length - suffixLength, aSuffix) == 0;
+}
+
+// Binaries written by another driver or by an older cache version can never be loaded again, so
+// they are removed instead of piling up. Also removes the temporary files of interrupted writes.
+void
+PruneBinaries() {
+  DIR* directory = opendir(sPath.c_str());
+  if (!directory) {
+    return;
+  }
+  uint32_t removed = 0;
+  while (struct dirent* entry = readdir(directory)) {
+    const bool binary = HasSuffix(entry->d_name, ".bin");
+    if (!binary && !HasSuffix(entry->d_name, ".tmp")) {
+      continue;
+    }
+    const std::string path = sPath + "/" + entry->d_name;
+    bool current = false;
+    if (binary) {
+      FILE* file = fopen(path.c_str(), "rb");
+      if (file) {
+        Header header = {};
+        current = fread(&header, sizeof(header), 1, file) == 1 && header.magic == kMagic &&
+                  header.version == kVersion && header.device == sDeviceKey;
+        fclose(file);
+      }
+    }
+    if (!current && remove(path.c_str()) == 0) {
+      removed++;
+    }
+  }
+  closedir(directory);
+  if (removed > 0) {
+    VRB_LOG("Removed %u stale program binaries from %s", removed, sPath.c_str());
+  }
+}
+
+// Returns 0 if there is no binary for aKey or if the driver rejects it, in which case it is removed.
+GLuint
+LoadProgram(const uint64_t aKey) {
+  const std::string path = BinaryPath(aKey);
+  FILE* file = fopen(path.c_str(), "rb");
+  if (!file) {
+    return 0;
+  }
+  Header header = {};
+  std::vector<uint8_t> binary;
+  bool valid = fread(&header, sizeof(header), 1, file) == 1 && header.magic == kMagic &&
+               header.version == kVersion && header.device == sDeviceKey && header.key == aKey && header.length > 0 &&
+               header.length <= kMaxBinaryLength;
+  if (valid) {
+    binary.resize(header.length);
+    valid = fread(binary.data(), binary.size(), 1, file) == 1;
+  }
+  fclose(file);
+
+  GLuint program = 0;
+  GLint linked = 0;
+  if (valid) {
+    program = glCreateProgram();
+    glProgramBinary(program, header.format, binary.data(), (GLsizei) binary.size());
+    // A binary format the driver no longer supports raises GL_INVALID_ENUM. It is read here so that
+    // it is reported with the binary instead of by the next checked GL call.
+    const GLenum error = glGetError();
+    if (error != GL_NO_ERROR) {
+      VRB_WARN("glProgramBinary rejected %s with GL error 0x%04x", path.c_str(), error);
+    }
+    VRB_GL_CHECK(glGetProgramiv(program, GL_LINK_STATUS, &linked));
+  }
+  if (!linked) {
+    VRB_WARN("Discarding the cached program binary %s", path.c_str());
+    if (program) {
+      VRB_GL_CHECK(glDeleteProgram(program));
+    }
+    remove(path.c_str());
+    return 0;
+  }
+  return program;
+}
+
+void
+StoreProgram(const uint64_t aKey, const GLuint aProgram) {
+  GLint length = 0;
+  VRB_GL_CHECK(glGetProgramiv(aProgram, GL_PROGRAM_BINARY_LENGTH, &length));
+  if (length <= 0 || (uint32_t) length > kMaxBinaryLength || !CreateDirectory()) {
+    return;
+  }
+  std::vector<uint8_t> binary((size_t) length);
+  GLenum format = 0;
+  GLsizei written = 0;
+  VRB_GL_CHECK(glGetProgramBinary(aProgram, length, &written, &format, binary.data()));
+  if (written <= 0) {
+    return;
+  }
+  Header header = {kMagic, kVersion, sDeviceKey, aKey, format, (uint32_t) written};
+  // Written under a temporary name so that an interrupted write never leaves a truncated binary.
+  const std::string path = BinaryPath(aKey);
+  const std::string temporaryPath = path + ".tmp";
+  FILE* file = fopen(temporaryPath.c_str(), "wb");
+  if (!file) {
+    VRB_WARN("Unable to write the program binary %s", temporaryPath.c_str());
+    return;
+  }
+  const bool stored = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                      fwrite(binary.data(), (size_t) written, 1, file) == 1;
+  if (fclose(file) != 0 || !stored || rename(temporaryPath.c_str(), path.c_str()) != 0) {
+    VRB_WARN("Unable to write the program binary %s", path.c_str());
+    remove(temporaryPath.c_str());
+  }
+}
+
+GLuint
+LinkProgram(const GLuint aVertexShader, const GLuint aFragmentShader, const bool aRetrievable) {
+  GLuint program = glCreateProgram();
+  VRB_GL_CHECK(glAttachShader(program, aVertexShader));
+  VRB_GL_CHECK(glAttachShader(program, aFragmentShader));
+  if (aRetrievable) {
+    // Some drivers only keep the binary of the programs that asked for it before linking.
+    VRB_GL_CHECK(glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+  }
+  VRB_GL_CHECK(glLinkProgram(program));
+  GLint linked = 0;
+  VRB_GL_CHECK(glGetProgramiv(program, GL_LINK_STATUS, &linked));
+  if (!linked) {
+    GLint length = 0;
+    VRB_GL_CHECK(glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length));
+    std::vector<char> log((size_t) std::max(length, 1), '\0');
+    VRB_GL_CHECK(glGetProgramInfoLog(program, (GLsizei) log.size(), nullptr, log.data()));
+    VRB_ERROR("Failed to link program: %s", log.data());
+    VRB_GL_CHECK(glDeleteProgram(program));
+    return 0;
+  }
+  return program;
+}
+
+} // namespace
+
+namespace crow {
+
+void
+ProgramCache::SetPath(const std::string& aPath) {
+  sPath = aPath;
+  sPathCreated = false;
+  sPathPruned = false;
+}
+
+GLuint
+ProgramCache::CreateProgram(const std::string& aVertexSource, const std::string& aFragmentSource,
+                            GLuint& aVertexShader, GLuint& aFragmentShader) {
+  aVertexShader = 0;
+  aFragmentShader = 0;
+  const bool enabled = !sPath.empty() && SupportsBinaries();
+  uint64_t key = 0;
+  if (enabled) {
+    if (!sPathPruned) {
+      sDeviceKey = DeviceKey();
+      PruneBinaries();
+      sPathPruned = true;
+    }
+    key = ProgramKey(aVertexSource, aFragmentSource);
+    const GLuint program = LoadProgram(key);
+    if (program) {
+      VRB_DEBUG("Loaded program %016" PRIx64 " from the cache", key);
+      return program;
+    }
+  }
+
+  aVertexShader = vrb::LoadShader(GL_VERTEX_SHADER, aVertexSource.c_str());
+  aFragmentShader = vrb::LoadShader(GL_FRAGMENT_SHADER, aFragmentSource.c_str());
+  if (!aVertexShader || !aFragmentShader) {
+    return 0;
+  }
+  const GLuint program = LinkProgram(aVertexShader, aFragmentShader, enabled);
+  if (program && enabled) {
+    StoreProgram(key, program);
+  }
+  return program;
+}
+
+} // namespace crow
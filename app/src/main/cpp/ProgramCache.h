@@ -0,0 +1,31 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_PROGRAM_CACHE_DOT_H
+#define VRBROWSER_PROGRAM_CACHE_DOT_H
+
+#include "vrb/gl.h"
+
+#include <string>
+
+namespace crow {
+
+// Stores the binaries of linked GL programs on disk so that later runs skip compiling and linking
+// them. Binaries are keyed by their shader sources and by the GL renderer and version strings, so a
+// driver update invalidates them. Binaries of other drivers are removed the first time a program
+// is created after the path is set. Must only be used from the render thread.
+namespace ProgramCache {
+// Directory where the binaries are stored, created if needed. Nothing is cached until it is set.
+void SetPath(const std::string& aPath);
+// Returns the linked program for the given sources, or 0 if it fails to build. When the program is
+// built from source, aVertexShader and aFragmentShader are set to the compiled shaders, which the
+// caller owns. They are left at 0 when the program is loaded from the cache.
+GLuint CreateProgram(const std::string& aVertexSource, const std::string& aFragmentSource,
+                     GLuint& aVertexShader, GLuint& aFragmentShader);
+} // namespace ProgramCache
+
+} // namespace crow
+
+#endif // VRBROWSER_PROGRAM_CACHE_DOT_H
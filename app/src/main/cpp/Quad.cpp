@@ -6,6 +6,7 @@
 #include "Quad.h"
 #include "VRLayer.h"
 #include "VRLayerNode.h"
+#include "WorldInverseCache.h"
 #include "vrb/ConcreteClass.h"
 
 #include "vrb/Color.h"
@@ -39,6 +40,7 @@ struct Quad::State {
   vrb::TransformPtr backgroundTransform;
   vrb::GeometryPtr backgroundGeometry;
   vrb::Color backgroundColor;
+  WorldInverseCache worldInverse;
 
   State()
       : textureWidth(0)
@@ -446,7 +448,7 @@ Quad::TestIntersection(const vrb::Vector& aStartPoint, const vrb::Vector& aDirec
     return false;
   }
   vrb::Matrix worldTransform = m.transform->GetWorldTransform();
-  vrb::Matrix modelView = worldTransform.AfineInverse();
+  const vrb::Matrix& modelView = m.worldInverse.Get(worldTransform);
   vrb::Vector point = modelView.MultiplyPosition(aStartPoint);
   vrb::Vector direction = modelView.MultiplyDirection(aDirection);
   vrb::Vector normal = GetNormal();
@@ -491,7 +493,7 @@ Quad::TestIntersection(const vrb::Vector& aStartPoint, const vrb::Vector& aDirec
 
 void
 Quad::ConvertToQuadCoordinates(const vrb::Vector& point, float& aX, float& aY, bool aClamp) const {
-  vrb::Vector value = m.transform->GetWorldTransform().AfineInverse().MultiplyPosition(point);
+  vrb::Vector value = m.worldInverse.Get(m.transform->GetWorldTransform()).MultiplyPosition(point);
   // Clamp value to quad bounds.
   if (aClamp) {
     if (value.x() > m.worldMax.x()) { value.x() = m.worldMax.x(); }
@@ -9,26 +9,19 @@
 #include "JNIUtil.h"
 #include "wvr/wvr.h"
 
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <utility>
+
 namespace {
 
 const char* const kDispatchCreateWidgetName = "dispatchCreateWidget";
 const char* const kDispatchCreateWidgetSignature = "(ILandroid/graphics/SurfaceTexture;II)V";
 const char* const kDispatchCreateWidgetLayerName = "dispatchCreateWidgetLayer";
 const char* const kDispatchCreateWidgetLayerSignature = "(ILandroid/view/Surface;IIJ)V";
-const char* const kHandleMotionEventName = "handleMotionEvent";
-const char* const kHandleMotionEventSignature = "(IIZZFF)V";
-const char* const kHandleScrollEventName = "handleScrollEvent";
-const char* const kHandleScrollEventSignature = "(IIFF)V";
-const char* const kHandleAudioPoseName = "handleAudioPose";
-const char* const kHandleAudioPoseSignature = "(FFFFFFF)V";
-const char* const kHandleGestureName = "handleGesture";
-const char* const kHandleGestureSignature = "(I)V";
-const char* const kHandleResizeName = "handleResize";
-const char* const kHandleResizeSignature = "(IFF)V";
-const char* const kHandleMoveEndName = "handleMoveEnd";
-const char* const kHandleMoveEndSignature = "(IFFFF)V";
-const char* const kHandleBackEventName = "handleBack";
-const char* const kHandleBackEventSignature = "()V";
+const char* const kHandleEventBatchName = "handleEventBatch";
+const char* const kHandleEventBatchSignature = "(Ljava/nio/ByteBuffer;I)V";
 const char* const kHandleAppExitEventName = "handleAppExit";
 const char* const kHandleAppExitEventSignature = "()V";
 const char* const kRegisterExternalContextName = "registerExternalContext";
@@ -45,6 +38,8 @@ const char* const kRenderPointerLayerName = "renderPointerLayer";
 const char* const kRenderPointerLayerSignature = "(Landroid/view/Surface;IJ)V";
 const char* const kGetStorageAbsolutePathName = "getStorageAbsolutePath";
 const char* const kGetStorageAbsolutePathSignature = "()Ljava/lang/String;";
+const char* const kGetCacheAbsolutePathName = "getCacheAbsolutePath";
+const char* const kGetCacheAbsolutePathSignature = "()Ljava/lang/String;";
 const char* const kIsOverrideEnvPathEnabledName = "isOverrideEnvPathEnabled";
 const char* const kIsOverrideEnvPathEnabledSignature = "()Z";
 const char* const kCheckTogglePassthrough = "checkTogglePassthrough";
@@ -81,13 +76,7 @@ jclass sBrowserClass = nullptr;
 jobject sActivity = nullptr;
 jmethodID sDispatchCreateWidget = nullptr;
 jmethodID sDispatchCreateWidgetLayer = nullptr;
-jmethodID sHandleMotionEvent = nullptr;
-jmethodID sHandleScrollEvent = nullptr;
-jmethodID sHandleAudioPose = nullptr;
-jmethodID sHandleGesture = nullptr;
-jmethodID sHandleResize = nullptr;
-jmethodID sHandleMoveEnd = nullptr;
-jmethodID sHandleBack = nullptr;
+jmethodID sHandleEventBatch = nullptr;
 jmethodID sHandleAppExit = nullptr;
 jmethodID sRegisterExternalContext = nullptr;
 jmethodID sOnEnterWebXR = nullptr;
@@ -96,6 +85,7 @@ jmethodID sOnDismissWebXRInterstitial = nullptr;
 jmethodID sOnWebXRRenderStateChange = nullptr;
 jmethodID sRenderPointerLayer = nullptr;
 jmethodID sGetStorageAbsolutePath = nullptr;
+jmethodID sGetCacheAbsolutePath = nullptr;
 jmethodID sIsOverrideEnvPathEnabled = nullptr;
 jmethodID sCheckTogglePassthrough = nullptr;
 jmethodID sResetWindowsPosition = nullptr;
@@ -111,6 +101,88 @@ jmethodID sAppendAppNotesToCrashReport = nullptr;
 jmethodID sUpdateControllerBatteryLevels = nullptr;
 jmethodID sOnAppFocusChanged = nullptr;
 jmethodID sSetIsPassthroughSupported = nullptr;
+
+// Must match the EVENT_* constants in VRBrowserActivity.java.
+enum class EventType : int32_t {
+  Motion = 1,
+  Scroll = 2,
+  Gesture = 3,
+  AudioPose = 4,
+  Resize = 5,
+  MoveEnd = 6,
+  Back = 7
+};
+const int32_t kEventFocused = 1;
+const int32_t kEventPressed = 1 << 1;
+const int32_t kNoController = -1;
+
+// Packed as-is into the direct ByteBuffer shared with Java.
+struct Event {
+  EventType type;
+  int32_t handle;
+  int32_t controller;
+  int32_t flags;
+  float values[8];
+};
+static_assert(sizeof(Event) == 48, "Event layout is shared with Java");
+
+const uint32_t kMaxEvents = 128;
+std::array<Event, kMaxEvents> sEvents;
+uint32_t sEventCount = 0;
+jobject sEventBuffer = nullptr;
+crow::VRBrowser::EventStats sEventStats;
+uint32_t sFrameEvents = 0;
+uint32_t sFrameCoalescedEvents = 0;
+uint32_t sFrameJNICalls = 0;
+
+void
+SendEvents() {
+  if (sEventCount == 0) {
+    return;
+  }
+  const uint32_t count = sEventCount;
+  sEventCount = 0;
+  if (!sEventBuffer || !crow::ValidateMethodID(sEnv, sActivity, sHandleEventBatch, __FUNCTION__)) { return; }
+  sEnv->CallVoidMethod(sActivity, sHandleEventBatch, sEventBuffer, (jint) count);
+  crow::CheckJNIException(sEnv, __FUNCTION__);
+  sFrameEvents += count;
+  sFrameJNICalls++;
+}
+
+Event&
+QueueEvent(const EventType aType, const int32_t aHandle, const int32_t aController, const int32_t aFlags) {
+  if (sEventCount == kMaxEvents) {
+    SendEvents();
+  }
+  Event& event = sEvents[sEventCount++];
+  event.type = aType;
+  event.handle = aHandle;
+  event.controller = aController;
+  event.flags = aFlags;
+  return event;
+}
+
+// Returns the last queued event of the controller if a new event with the same target can
+// replace it without changing what Java sees. Presses and releases are never merged, and neither
+// are events queued before a gesture, resize, move or back event, which can change the widgets the
+// controller events apply to. The audio pose only updates the listener and does not stop the search.
+Event*
+FindCoalescableEvent(const EventType aType, const int32_t aHandle, const int32_t aController, const int32_t aFlags) {
+  for (uint32_t i = sEventCount; i > 0; --i) {
+    Event& event = sEvents[i - 1];
+    if (event.controller == kNoController && event.type != EventType::AudioPose) {
+      return nullptr;
+    }
+    if (event.controller != aController) {
+      continue;
+    }
+    if (event.type != aType || event.handle != aHandle || event.flags != aFlags) {
+      return nullptr;
+    }
+    return &event;
+  }
+  return nullptr;
+}
 }
 
 namespace crow {
@@ -132,13 +204,7 @@ VRBrowser::InitializeJava(JNIEnv* aEnv, jobject aActivity) {
 
   sDispatchCreateWidget = FindJNIMethodID(sEnv, sBrowserClass, kDispatchCreateWidgetName, kDispatchCreateWidgetSignature);
   sDispatchCreateWidgetLayer = FindJNIMethodID(sEnv, sBrowserClass, kDispatchCreateWidgetLayerName, kDispatchCreateWidgetLayerSignature);
-  sHandleMotionEvent = FindJNIMethodID(sEnv, sBrowserClass, kHandleMotionEventName, kHandleMotionEventSignature);
-  sHandleScrollEvent = FindJNIMethodID(sEnv, sBrowserClass, kHandleScrollEventName, kHandleScrollEventSignature);
-  sHandleAudioPose = FindJNIMethodID(sEnv, sBrowserClass, kHandleAudioPoseName, kHandleAudioPoseSignature);
-  sHandleGesture = FindJNIMethodID(sEnv, sBrowserClass, kHandleGestureName, kHandleGestureSignature);
-  sHandleResize = FindJNIMethodID(sEnv, sBrowserClass, kHandleResizeName, kHandleResizeSignature);
-  sHandleMoveEnd = FindJNIMethodID(sEnv, sBrowserClass, kHandleMoveEndName, kHandleMoveEndSignature);
-  sHandleBack = FindJNIMethodID(sEnv, sBrowserClass, kHandleBackEventName, kHandleBackEventSignature);
+  sHandleEventBatch = FindJNIMethodID(sEnv, sBrowserClass, kHandleEventBatchName, kHandleEventBatchSignature);
   sHandleAppExit = FindJNIMethodID(sEnv, sBrowserClass, kHandleAppExitEventName, kHandleAppExitEventSignature);
   sRegisterExternalContext = FindJNIMethodID(sEnv, sBrowserClass, kRegisterExternalContextName, kRegisterExternalContextSignature);
   sOnEnterWebXR = FindJNIMethodID(sEnv, sBrowserClass, kOnEnterWebXRName, kOnEnterWebXRSignature);
@@ -147,6 +213,7 @@ VRBrowser::InitializeJava(JNIEnv* aEnv, jobject aActivity) {
   sOnWebXRRenderStateChange = FindJNIMethodID(sEnv, sBrowserClass, kOnWebXRRenderStateChangeName, kOnWebXRRenderStateChangeSignature);
   sRenderPointerLayer = FindJNIMethodID(sEnv, sBrowserClass, kRenderPointerLayerName, kRenderPointerLayerSignature);
   sGetStorageAbsolutePath = FindJNIMethodID(sEnv, sBrowserClass, kGetStorageAbsolutePathName, kGetStorageAbsolutePathSignature);
+  sGetCacheAbsolutePath = FindJNIMethodID(sEnv, sBrowserClass, kGetCacheAbsolutePathName, kGetCacheAbsolutePathSignature);
   sIsOverrideEnvPathEnabled = FindJNIMethodID(sEnv, sBrowserClass, kIsOverrideEnvPathEnabledName, kIsOverrideEnvPathEnabledSignature);
   sCheckTogglePassthrough = FindJNIMethodID(sEnv, sBrowserClass, kCheckTogglePassthrough, kCheckTogglePassthroughSignature);
   sResetWindowsPosition = FindJNIMethodID(sEnv, sBrowserClass, kResetWindowsPosition, kResetWindowsPositionSignature);
@@ -162,6 +229,13 @@ VRBrowser::InitializeJava(JNIEnv* aEnv, jobject aActivity) {
   sUpdateControllerBatteryLevels = FindJNIMethodID(sEnv, sBrowserClass, kUpdateControllerBatteryLevelsName, kUpdateControllerBatteryLevelsSignature);
   sOnAppFocusChanged = FindJNIMethodID(sEnv, sBrowserClass, kOnAppFocusChangedName, kOnAppFocusChangedSignature);
   sSetIsPassthroughSupported = FindJNIMethodID(sEnv, sBrowserClass, kSetIsPassthroughSupportedName, kSetIsPassthroughSupportedSignature);
+
+  jobject eventBuffer = sEnv->NewDirectByteBuffer(sEvents.data(), sizeof(sEvents));
+  if (eventBuffer) {
+    sEventBuffer = sEnv->NewGlobalRef(eventBuffer);
+    sEnv->DeleteLocalRef(eventBuffer);
+  }
+  sEventCount = 0;
 }
 
 JNIEnv * VRBrowser::Env()
@@ -178,18 +252,17 @@ VRBrowser::ShutdownJava() {
     sEnv->DeleteGlobalRef(sActivity);
     sActivity = nullptr;
   }
+  if (sEventBuffer) {
+    sEnv->DeleteGlobalRef(sEventBuffer);
+    sEventBuffer = nullptr;
+  }
+  sEventCount = 0;
 
   sBrowserClass = nullptr;
 
   sDispatchCreateWidget = nullptr;
   sDispatchCreateWidgetLayer = nullptr;
-  sHandleMotionEvent = nullptr;
-  sHandleScrollEvent = nullptr;
-  sHandleAudioPose = nullptr;
-  sHandleGesture = nullptr;
-  sHandleResize = nullptr;
-  sHandleMoveEnd = nullptr;
-  sHandleBack = nullptr;
+  sHandleEventBatch = nullptr;
   sHandleAppExit = nullptr;
   sRegisterExternalContext = nullptr;
   sOnAppFocusChanged = nullptr;
@@ -199,6 +272,7 @@ VRBrowser::ShutdownJava() {
   sOnWebXRRenderStateChange = nullptr;
   sRenderPointerLayer = nullptr;
   sGetStorageAbsolutePath = nullptr;
+  sGetCacheAbsolutePath = nullptr;
   sIsOverrideEnvPathEnabled = nullptr;
   sCheckTogglePassthrough = nullptr;
   sResetWindowsPosition = nullptr;
@@ -215,6 +289,7 @@ VRBrowser::ShutdownJava() {
 
 void
 VRBrowser::DispatchCreateWidget(jint aWidgetHandle, jobject aSurface, jint aWidth, jint aHeight) {
+  SendEvents();
   if (!ValidateMethodID(sEnv, sActivity, sDispatchCreateWidget, __FUNCTION__)) { return; }
   sEnv->CallVoidMethod(sActivity, sDispatchCreateWidget, aWidgetHandle, aSurface, aWidth, aHeight);
   CheckJNIException(sEnv, __FUNCTION__);
@@ -223,6 +298,7 @@ VRBrowser::DispatchCreateWidget(jint aWidgetHandle, jobject aSurface, jint aWidt
 
 void
 VRBrowser::DispatchCreateWidgetLayer(jint aWidgetHandle, jobject aSurface, jint aWidth, jint aHeight, const std::function<void()>& aFirstCompositeCallback) {
+  SendEvents();
   if (!ValidateMethodID(sEnv, sActivity, sDispatchCreateWidgetLayer, __FUNCTION__)) { return; }
   jlong callback = 0;
   if (aFirstCompositeCallback) {
@@ -235,55 +311,100 @@ VRBrowser::DispatchCreateWidgetLayer(jint aWidgetHandle, jobject aSurface, jint
 
 void
 VRBrowser::HandleMotionEvent(jint aWidgetHandle, jint aController, jboolean aFocused, jboolean aPressed, jfloat aX, jfloat aY) {
-  if (!ValidateMethodID(sEnv, sActivity, sHandleMotionEvent, __FUNCTION__)) { return; }
-  sEnv->CallVoidMethod(sActivity, sHandleMotionEvent, aWidgetHandle, aController, aFocused, aPressed, aX, aY);
-  CheckJNIException(sEnv, __FUNCTION__);
+  const int32_t flags = (aFocused ? kEventFocused : 0) | (aPressed ? kEventPressed : 0);
+  // Only the last position of a hover over the same widget matters.
+  Event* event = aPressed ? nullptr : FindCoalescableEvent(EventType::Motion, aWidgetHandle, aController, flags);
+  if (event) {
+    sFrameCoalescedEvents++;
+  } else {
+    event = &QueueEvent(EventType::Motion, aWidgetHandle, aController, flags);
+  }
+  event->values[0] = aX;
+  event->values[1] = aY;
 }
 
 void
 VRBrowser::HandleScrollEvent(jint aWidgetHandle, jint aController, jfloat aX, jfloat aY) {
-  if (!ValidateMethodID(sEnv, sActivity, sHandleScrollEvent, __FUNCTION__)) { return; }
-  sEnv->CallVoidMethod(sActivity, sHandleScrollEvent, aWidgetHandle, aController, aX, aY);
-  CheckJNIException(sEnv, __FUNCTION__);
+  Event* event = FindCoalescableEvent(EventType::Scroll, aWidgetHandle, aController, 0);
+  if (event) {
+    sFrameCoalescedEvents++;
+    event->values[0] += aX;
+    event->values[1] += aY;
+    return;
+  }
+  event = &QueueEvent(EventType::Scroll, aWidgetHandle, aController, 0);
+  event->values[0] = aX;
+  event->values[1] = aY;
 }
 
 void
 VRBrowser::HandleAudioPose(jfloat qx, jfloat qy, jfloat qz, jfloat qw, jfloat px, jfloat py, jfloat pz) {
-  if (!ValidateMethodID(sEnv, sActivity, sHandleAudioPose, __FUNCTION__)) { return; }
-  sEnv->CallVoidMethod(sActivity, sHandleAudioPose, qx, qy, qz, qw, px, py, pz);
-  CheckJNIException(sEnv, __FUNCTION__);
+  Event* event = nullptr;
+  for (uint32_t i = 0; i < sEventCount && !event; ++i) {
+    if (sEvents[i].type == EventType::AudioPose) {
+      event = &sEvents[i];
+    }
+  }
+  if (event) {
+    sFrameCoalescedEvents++;
+  } else {
+    event = &QueueEvent(EventType::AudioPose, 0, kNoController, 0);
+  }
+  const float values[] = {qx, qy, qz, qw, px, py, pz};
+  std::copy(std::begin(values), std::end(values), event->values);
 }
 
 void
 VRBrowser::HandleGesture(jint aType) {
-  if (!ValidateMethodID(sEnv, sActivity, sHandleGesture, __FUNCTION__)) { return; }
-  sEnv->CallVoidMethod(sActivity, sHandleGesture, aType);
-  CheckJNIException(sEnv, __FUNCTION__);
+  QueueEvent(EventType::Gesture, aType, kNoController, 0);
+}
+
+void
+VRBrowser::FlushEvents() {
+  SendEvents();
+  sEventStats.events = std::exchange(sFrameEvents, 0);
+  sEventStats.coalescedEvents = std::exchange(sFrameCoalescedEvents, 0);
+  sEventStats.jniCalls = std::exchange(sFrameJNICalls, 0);
+  sEventStats.frames++;
+  sEventStats.totalEvents += sEventStats.events;
+  sEventStats.totalCoalescedEvents += sEventStats.coalescedEvents;
+  sEventStats.totalJNICalls += sEventStats.jniCalls;
+}
+
+const VRBrowser::EventStats&
+VRBrowser::GetEventStats() {
+  return sEventStats;
+}
+
+void
+VRBrowser::ResetEventStats() {
+  sEventStats = EventStats();
 }
 
 void
 VRBrowser::HandleResize(jint aWidgetHandle, jfloat aWorldWidth, jfloat aWorldHeight) {
-  if (!ValidateMethodID(sEnv, sActivity, sHandleResize, __FUNCTION__)) { return; }
-  sEnv->CallVoidMethod(sActivity, sHandleResize, aWidgetHandle, aWorldWidth, aWorldHeight);
-  CheckJNIException(sEnv, __FUNCTION__);
+  Event& event = QueueEvent(EventType::Resize, aWidgetHandle, kNoController, 0);
+  event.values[0] = aWorldWidth;
+  event.values[1] = aWorldHeight;
 }
 
 void
 VRBrowser::HandleMoveEnd(jint aWidgetHandle, jfloat aX, jfloat aY, jfloat aZ, jfloat aRotation) {
-  if (!ValidateMethodID(sEnv, sActivity, sHandleMoveEnd, __FUNCTION__)) { return; }
-  sEnv->CallVoidMethod(sActivity, sHandleMoveEnd, aWidgetHandle, aX, aY, aZ, aRotation);
-  CheckJNIException(sEnv, __FUNCTION__);
+  Event& event = QueueEvent(EventType::MoveEnd, aWidgetHandle, kNoController, 0);
+  event.values[0] = aX;
+  event.values[1] = aY;
+  event.values[2] = aZ;
+  event.values[3] = aRotation;
 }
 
 void
 VRBrowser::HandleBack() {
-  if (!ValidateMethodID(sEnv, sActivity, sHandleBack, __FUNCTION__)) { return; }
-  sEnv->CallVoidMethod(sActivity, sHandleBack);
-  CheckJNIException(sEnv, __FUNCTION__);
+  QueueEvent(EventType::Back, 0, kNoController, 0);
 }
 
 void
 VRBrowser::HandleAppExit() {
+  SendEvents();
   if (!ValidateMethodID(sEnv, sActivity, sHandleAppExit, __FUNCTION__)) { return; }
   sEnv->CallVoidMethod(sActivity, sHandleAppExit);
   CheckJNIException(sEnv, __FUNCTION__);
@@ -291,6 +412,7 @@ VRBrowser::HandleAppExit() {
 
 void
 VRBrowser::RegisterExternalContext(jlong aContext) {
+  SendEvents();
   if (!ValidateMethodID(sEnv, sActivity, sRegisterExternalContext, __FUNCTION__)) { return; }
   sEnv->CallVoidMethod(sActivity, sRegisterExternalContext, aContext);
   CheckJNIException(sEnv, __FUNCTION__);
@@ -298,6 +420,7 @@ VRBrowser::RegisterExternalContext(jlong aContext) {
 
 void
 VRBrowser::OnEnterWebXR() {
+  SendEvents();
   if (!ValidateMethodID(sEnv, sActivity, sOnEnterWebXR, __FUNCTION__)) { return; }
   sEnv->CallVoidMethod(sActivity, sOnEnterWebXR);
   CheckJNIException(sEnv, __FUNCTION__);
@@ -305,6 +428,7 @@ VRBrowser::OnEnterWebXR() {
 
 void
 VRBrowser::OnExitWebXR(const std::function<void()>& aCallback) {
+  SendEvents();
   if (!ValidateMethodID(sEnv, sActivity, sOnExitWebXR, __FUNCTION__)) { return; }
   jlong callback = 0;
   if (aCallback) {
@@ -315,12 +439,14 @@ VRBrowser::OnExitWebXR(const std::function<void()>& aCallback) {
 }
 
 void VRBrowser::OnDismissWebXRInterstitial() {
+  SendEvents();
   if (!ValidateMethodID(sEnv, sActivity, sOnDismissWebXRInterstitial, __FUNCTION__)) { return; }
   sEnv->CallVoidMethod(sActivity, sOnDismissWebXRInterstitial);
   CheckJNIException(sEnv, __FUNCTION__);
 }
 
 void VRBrowser::OnWebXRRenderStateChange(const bool aRendering) {
+  SendEvents();
   if (!ValidateMethodID(sEnv, sActivity, sOnWebXRRenderStateChange, __FUNCTION__)) { return; }
   sEnv->CallVoidMethod(sActivity, sOnWebXRRenderStateChange, (jboolean) aRendering);
   CheckJNIException(sEnv, __FUNCTION__);
@@ -328,6 +454,7 @@ void VRBrowser::OnWebXRRenderStateChange(const bool aRendering) {
 
 void
 VRBrowser::RenderPointerLayer(jobject aSurface, const int32_t color, const std::function<void()>& aFirstCompositeCallback) {
+  SendEvents();
   if (!ValidateMethodID(sEnv, sActivity, sRenderPointerLayer, __FUNCTION__)) { return; }
   jlong callback = 0;
   if (aFirstCompositeCallback) {
@@ -357,6 +484,22 @@ VRBrowser::GetStorageAbsolutePath(const std::string& aRelativePath) {
   }
 }
 
+std::string
+VRBrowser::GetCacheAbsolutePath() {
+  if (!ValidateMethodID(sEnv, sActivity, sGetCacheAbsolutePath, __FUNCTION__)) { return ""; }
+  jstring jStr = (jstring) sEnv->CallObjectMethod(sActivity, sGetCacheAbsolutePath);
+  CheckJNIException(sEnv, __FUNCTION__);
+  if (!jStr) {
+    return "";
+  }
+
+  const char *cstr = sEnv->GetStringUTFChars(jStr, nullptr);
+  std::string str = std::string(cstr);
+  sEnv->ReleaseStringUTFChars(jStr, cstr);
+  sEnv->DeleteLocalRef(jStr);
+  return str;
+}
+
 bool
 VRBrowser::isOverrideEnvPathEnabled() {
   if (!ValidateMethodID(sEnv, sActivity, sIsOverrideEnvPathEnabled, __FUNCTION__)) { return false; }
@@ -368,6 +511,7 @@ VRBrowser::isOverrideEnvPathEnabled() {
 
 void
 VRBrowser::CheckTogglePassthrough() {
+  SendEvents();
   if (!ValidateMethodID(sEnv, sActivity, sCheckTogglePassthrough, __FUNCTION__)) { return; }
   sEnv->CallVoidMethod(sActivity, sCheckTogglePassthrough);
   CheckJNIException(sEnv, __FUNCTION__);
@@ -375,6 +519,7 @@ VRBrowser::CheckTogglePassthrough() {
 
 void
 VRBrowser::ResetWindowsPosition() {
+  SendEvents();
   if (!ValidateMethodID(sEnv, sActivity, sResetWindowsPosition, __FUNCTION__)) { return; }
   sEnv->CallVoidMethod(sActivity, sResetWindowsPosition);
   CheckJNIException(sEnv, __FUNCTION__);
@@ -416,6 +561,7 @@ VRBrowser::AreLayersEnabled() {
 
 void
 VRBrowser::SetDeviceType(const jint aType) {
+  SendEvents();
   if (!ValidateMethodID(sEnv, sActivity, sSetDeviceType, __FUNCTION__)) { return; }
   sEnv->CallVoidMethod(sActivity, sSetDeviceType, aType);
   CheckJNIException(sEnv, __FUNCTION__);
@@ -423,6 +569,7 @@ VRBrowser::SetDeviceType(const jint aType) {
 
 void
 VRBrowser::HaltActivity(const jint aReason) {
+  SendEvents();
   if (!ValidateMethodID(sEnv, sActivity, sHaltActivity, __FUNCTION__)) { return; }
   sEnv->CallVoidMethod(sActivity, sHaltActivity, aReason);
   CheckJNIException(sEnv, __FUNCTION__);
@@ -430,6 +577,7 @@ VRBrowser::HaltActivity(const jint aReason) {
 
 void
 VRBrowser::HandlePoorPerformance() {
+  SendEvents();
   if (!ValidateMethodID(sEnv, sActivity, sHandlePoorPerformance, __FUNCTION__)) { return; }
   sEnv->CallVoidMethod(sActivity, sHandlePoorPerformance);
   CheckJNIException(sEnv, __FUNCTION__);
@@ -437,6 +585,7 @@ VRBrowser::HandlePoorPerformance() {
 
 void
 VRBrowser::OnAppLink(const std::string& aJSON) {
+  SendEvents();
   if (!ValidateMethodID(sEnv, sActivity, sOnAppLink, __FUNCTION__)) { return; }
   jstring json = sEnv->NewStringUTF(aJSON.c_str());
   sEnv->CallVoidMethod(sActivity, sOnAppLink, json);
@@ -446,6 +595,7 @@ VRBrowser::OnAppLink(const std::string& aJSON) {
 
 void
 VRBrowser::DisableLayers() {
+  SendEvents();
   if (!ValidateMethodID(sEnv, sActivity, sDisableLayers, __FUNCTION__)) { return; }
   sEnv->CallVoidMethod(sActivity, sDisableLayers);
   CheckJNIException(sEnv, __FUNCTION__);
@@ -462,6 +612,7 @@ VRBrowser::AppendAppNotesToCrashLog(const std::string& aNotes) {
 
 void
 VRBrowser::UpdateControllerBatteryLevels(const jint aLeftBatteryLevel, const jint aRightBatteryLevel) {
+  SendEvents();
   if (!ValidateMethodID(sEnv, sActivity, sUpdateControllerBatteryLevels, __FUNCTION__)) { return; }
   sEnv->CallVoidMethod(sActivity, sUpdateControllerBatteryLevels, aLeftBatteryLevel, aRightBatteryLevel);
   CheckJNIException(sEnv, __FUNCTION__);
@@ -469,6 +620,7 @@ VRBrowser::UpdateControllerBatteryLevels(const jint aLeftBatteryLevel, const jin
 
 void
 VRBrowser::OnAppFocusChanged(const bool aIsFocused) {
+  SendEvents();
   if (!ValidateMethodID(sEnv, sActivity, sOnAppFocusChanged, __FUNCTION__)) { return; }
   sEnv->CallVoidMethod(sActivity, sOnAppFocusChanged, (jboolean) aIsFocused);
   CheckJNIException(sEnv, __FUNCTION__);
@@ -8,6 +8,7 @@
 
 #include "vrb/MacroUtils.h"
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <jni.h>
@@ -21,6 +22,9 @@ JNIEnv * Env();
 void ShutdownJava();
 void DispatchCreateWidget(jint aWidgetHandle, jobject aSurfaceTexture, jint aWidth, jint aHeight);
 void DispatchCreateWidgetLayer(jint aWidgetHandle, jobject aSurface, jint aWidth, jint aHeight, const std::function<void()>& aFirstCompositeCallback);
+// Motion, scroll, gesture, audio pose, resize, move and back events are queued and sent to Java in
+// a single batch by FlushEvents, which the render thread calls once per frame. Every other call
+// to Java sends the queued events first, so Java sees all of them in the order they were made.
 void HandleMotionEvent(jint aWidgetHandle, jint aController, jboolean aFocused, jboolean aPressed, jfloat aX, jfloat aY);
 void HandleScrollEvent(jint aWidgetHandle, jint aController, jfloat aX, jfloat aY);
 void HandleAudioPose(jfloat qx, jfloat qy, jfloat qz, jfloat qw, jfloat px, jfloat py, jfloat pz);
@@ -28,6 +32,19 @@ void HandleGesture(jint aType);
 void HandleResize(jint aWidgetHandle, jfloat aWorldWidth, jfloat aWorldHeight);
 void HandleMoveEnd(jint aWidgetHandle, jfloat aX, jfloat aY, jfloat aZ, jfloat aRotation);
 void HandleBack();
+void FlushEvents();
+struct EventStats {
+  // Events sent, events merged into a queued one and JNI calls made by the last FlushEvents.
+  uint32_t events = 0;
+  uint32_t coalescedEvents = 0;
+  uint32_t jniCalls = 0;
+  uint64_t frames = 0;
+  uint64_t totalEvents = 0;
+  uint64_t totalCoalescedEvents = 0;
+  uint64_t totalJNICalls = 0;
+};
+const EventStats& GetEventStats();
+void ResetEventStats();
 void HandleAppExit();
 void RegisterExternalContext(jlong aContext);
 void OnEnterWebXR();
@@ -36,6 +53,8 @@ void OnDismissWebXRInterstitial();
 void OnWebXRRenderStateChange(const bool aRendering);
 void RenderPointerLayer(jobject aSurface, const int32_t color, const std::function<void()>& aFirstCompositeCallback);
 std::string GetStorageAbsolutePath(const std::string& aRelativePath);
+// App cache directory, which the system may clear at any time.
+std::string GetCacheAbsolutePath();
 bool isOverrideEnvPathEnabled();
 void CheckTogglePassthrough();
 void ResetWindowsPosition();
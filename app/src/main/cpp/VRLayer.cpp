@@ -9,10 +9,22 @@
 #include "vrb/Matrix.h"
 #include "VRBrowser.h"
 
+#include <cstring>
+
 namespace crow {
 
 static uint64_t sIndex = 0;
 
+static bool
+SameMatrix(const vrb::Matrix& aA, const vrb::Matrix& aB) {
+  return memcmp(aA.Data(), aB.Data(), sizeof(float) * 16) == 0;
+}
+
+static bool
+SameColor(const vrb::Color& aA, const vrb::Color& aB) {
+  return aA.Red() == aB.Red() && aA.Green() == aB.Green() && aA.Blue() == aB.Blue() && aA.Alpha() == aB.Alpha();
+}
+
 struct VRLayer::State {
   bool initialized;
   int32_t priority;
@@ -31,6 +43,7 @@ struct VRLayer::State {
   std::string name;
   bool composited;
   bool useSameLayerForBothEyes;
+  uint32_t revision;
   State():
       initialized(false),
       priority(0),
@@ -41,7 +54,8 @@ struct VRLayer::State {
       currentEye(device::Eye::Left),
       clearColor(0),
       tintColor(1.0f, 1.0f, 1.0f, 1.0f),
-      useSameLayerForBothEyes(true)
+      useSameLayerForBothEyes(true),
+      revision(0)
   {
     for (int i = 0; i < 2; ++i) {
       modelTransform[i] = vrb::Matrix::Identity();
@@ -66,6 +80,11 @@ VRLayer::IsDrawRequested() const {
   return m.drawRequested;
 }
 
+uint32_t
+VRLayer::GetRevision() const {
+  return m.revision;
+}
+
 const vrb::Matrix&
 VRLayer::GetModelTransform(device::Eye aEye) const {
   return m.modelTransform[device::EyeIndex(aEye)];
@@ -158,7 +177,12 @@ VRLayer::ClearRequestDraw() {
 
 void
 VRLayer::SetModelTransform(device::Eye aEye, const vrb::Matrix& aModelTransform) {
-  m.modelTransform[device::EyeIndex(aEye)] = aModelTransform;
+  vrb::Matrix& transform = m.modelTransform[device::EyeIndex(aEye)];
+  if (SameMatrix(transform, aModelTransform)) {
+    return;
+  }
+  transform = aModelTransform;
+  m.revision++;
 }
 
 void
@@ -183,17 +207,31 @@ VRLayer::VRLayer(State& aState, LayerType aLayerType): m(aState) {
 
 void
 VRLayer::SetClearColor(const vrb::Color& aClearColor) {
+  if (SameColor(m.clearColor, aClearColor)) {
+    return;
+  }
   m.clearColor = aClearColor;
+  m.revision++;
 }
 
 void
 VRLayer::SetTintColor(const vrb::Color& aTintColor) {
+  if (SameColor(m.tintColor, aTintColor)) {
+    return;
+  }
   m.tintColor = aTintColor;
+  m.revision++;
 }
 
 void
 VRLayer::SetTextureRect(device::Eye aEye, const crow::device::EyeRect &aTextureRect) {
-  m.textureRect[device::EyeIndex(aEye)] = aTextureRect;
+  device::EyeRect& rect = m.textureRect[device::EyeIndex(aEye)];
+  if (rect.mX == aTextureRect.mX && rect.mY == aTextureRect.mY &&
+      rect.mWidth == aTextureRect.mWidth && rect.mHeight == aTextureRect.mHeight) {
+    return;
+  }
+  rect = aTextureRect;
+  m.revision++;
 }
 
 void
@@ -217,12 +255,18 @@ VRLayer::SetName(const std::string &aName) {
 
 void
 VRLayer::SetComposited(bool aComposited) {
-  m.composited = aComposited;
+  if (m.composited != aComposited) {
+    m.composited = aComposited;
+    m.revision++;
+  }
 }
 
 void
 VRLayer::SetUseSameLayerForBothEyes(bool aUseSame) {
-  m.useSameLayerForBothEyes = aUseSame;
+  if (m.useSameLayerForBothEyes != aUseSame) {
+    m.useSameLayerForBothEyes = aUseSame;
+    m.revision++;
+  }
 }
 
 void VRLayer::NotifySurfaceChanged(SurfaceChange aChange, const std::function<void()>& aFirstCompositeCallback) {
@@ -307,8 +351,11 @@ VRLayerSurface::Unbind(){
 
 void
 VRLayerSurface::SetWorldSize(const float aWidth, const float aHeight) {
-  m.worldWidth = aWidth;
-  m.worldHeight = aHeight;
+  if (m.worldWidth != aWidth || m.worldHeight != aHeight) {
+    m.worldWidth = aWidth;
+    m.worldHeight = aHeight;
+    m.revision++;
+  }
 }
 
 void
@@ -318,6 +365,7 @@ VRLayerSurface::Resize(const int32_t aWidth, const int32_t aHeight, bool force)
   }
   m.width = aWidth;
   m.height = aHeight;
+  m.revision++;
   if (m.resizeDelegate) {
     m.resizeDelegate();
   }
@@ -340,6 +388,7 @@ VRLayerSurface::SetSurface(jobject aSurface) {
   if (oldSurface) {
     VRBrowser::Env()->DeleteGlobalRef(oldSurface);
   }
+  m.revision++;
 }
 
 VRLayerSurface::VRLayerSurface(State& aState, LayerType aLayerType): VRLayer(aState, aLayerType), m(aState) {
@@ -409,12 +458,19 @@ VRLayerCylinder::GetUVTransform(device::Eye aEye) const {
 
 void
 VRLayerCylinder::SetUVTransform(device::Eye aEye, const vrb::Matrix& aTransform) {
-  m.uvTransform[device::EyeIndex(aEye)] = aTransform;
+  vrb::Matrix& transform = m.uvTransform[device::EyeIndex(aEye)];
+  if (!SameMatrix(transform, aTransform)) {
+    transform = aTransform;
+    m.revision++;
+  }
 }
 
 void
 VRLayerCylinder::SetRotation(const vrb::Matrix& aTransform) {
-  m.rotation = aTransform;
+  if (!SameMatrix(m.rotation, aTransform)) {
+    m.rotation = aTransform;
+    m.revision++;
+  }
 }
 
 vrb::Matrix&
@@ -424,7 +480,10 @@ VRLayerCylinder::GetRotation() {
 
 void
 VRLayerCylinder::SetRadius(const float aRadius) {
-  m.radius = aRadius;
+  if (m.radius != aRadius) {
+    m.radius = aRadius;
+    m.revision++;
+  }
 }
 
 VRLayerCylinder::VRLayerCylinder(State& aState): VRLayerSurface(aState, LayerType::QUAD), m(aState) {
@@ -504,6 +563,7 @@ VRLayerCube::GetTextureHandle() const {
 void
 VRLayerCube::SetTextureHandle(uint32_t aTextureHandle){
   m.textureHandle = aTextureHandle;
+  m.revision++;
 }
 
 GLuint
@@ -514,6 +574,7 @@ VRLayerCube::GetFormat() const {
 void
 VRLayerCube::SetLoaded(bool aLoaded) {
   m.loaded = aLoaded;
+  m.revision++;
 }
 
 VRLayerCube::VRLayerCube(State& aState): VRLayer(aState, LayerType::CUBEMAP), m(aState) {
@@ -548,7 +609,11 @@ VRLayerEquirect::GetUVTransform(device::Eye aEye) const {
 
 void
 VRLayerEquirect::SetUVTransform(device::Eye aEye, const vrb::Matrix& aTransform) {
-  m.uvTransform[device::EyeIndex(aEye)] = aTransform;
+  vrb::Matrix& transform = m.uvTransform[device::EyeIndex(aEye)];
+  if (!SameMatrix(transform, aTransform)) {
+    transform = aTransform;
+    m.revision++;
+  }
 }
 
 
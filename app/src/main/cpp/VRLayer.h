@@ -54,6 +54,8 @@ public:
   std::string GetName() const;
   bool IsComposited() const;
   bool GetUseSameLayerForBothEyes() const;
+  // Incremented whenever a property that affects how the layer is composited changes.
+  uint32_t GetRevision() const;
 
   bool ShouldDrawBefore(const VRLayer& aLayer);
   void SetInitialized(bool aInitialized);
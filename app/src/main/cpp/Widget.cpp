@@ -5,6 +5,8 @@
 
 #include "Widget.h"
 #include "Cylinder.h"
+#include "GLStateCache.h"
+#include "MatrixUtils.h"
 #include "Quad.h"
 #include "VRLayer.h"
 #include "VRBrowser.h"
@@ -29,6 +31,8 @@
 #include "vrb/Vector.h"
 #include "vrb/VertexArray.h"
 
+#include <algorithm>
+
 namespace crow {
 
 static const float kFrameSize = 0.02f;
@@ -59,12 +63,14 @@ struct Widget::State {
   vrb::TogglePtr bordersContainer;
   std::vector<WidgetBorderPtr> borders;
   vrb::TogglePtr layerProxy;
+  uint32_t boundsRevision;
 
   State()
       : handle(0)
       , resizing(false)
       , toggleState(false)
       , cylinderDensity(4680.0f)
+      , boundsRevision(0)
   {}
 
   void Initialize(const int aHandle, const WidgetPlacementPtr& aPlacement, const int32_t aTextureWidth, const int32_t aTextureHeight,
@@ -152,6 +158,10 @@ struct Widget::State {
     return max.y() - min.y();
   }
 
+  void InvalidateBounds() {
+    boundsRevision++;
+  }
+
   void UpdateCylinderMatrix() {
     float w = WorldWidth();
     float h = WorldHeight();
@@ -175,6 +185,7 @@ struct Widget::State {
     cylinder->SetTransform(translation.PostMultiply(scaleMatrix));
     AdjustCylinderRotation(radius * scale);
     UpdateResizerTransform();
+    InvalidateBounds();
   }
 
   void AdjustCylinderRotation(const float radius, const vrb::Matrix* uiYaw = nullptr) {
@@ -205,6 +216,7 @@ struct Widget::State {
     }
     if (hasCylinderLayer)
       cylinder->GetLayer()->SetRadius(radius);
+    InvalidateBounds();
   }
 
   void RemoveResizer() {
@@ -341,6 +353,7 @@ Widget::SetWorldWidth(float aWorldWidth) const {
   if ((oldWidth != aWorldWidth) || (oldHeight != worldHeight)) {
     m.RemoveBorder();
   }
+  m.InvalidateBounds();
 }
 
 void
@@ -371,6 +384,41 @@ Widget::TestControllerIntersection(const vrb::Vector& aStartPoint, const vrb::Ve
   return result;
 }
 
+uint32_t
+Widget::GetBoundsRevision() const {
+  return m.boundsRevision;
+}
+
+void
+Widget::GetBoundingSphere(vrb::Vector& aCenter, float& aRadius) const {
+  // Transform from the widget surface to the scene root the widget was added to.
+  const vrb::Matrix widgetTransform = m.transformContainer->GetTransform().PostMultiply(m.transform->GetTransform());
+  vrb::Vector center;
+  float radius;
+  vrb::Matrix surfaceTransform;
+  if (m.quad) {
+    surfaceTransform = widgetTransform.PostMultiply(m.quad->GetTransformNode()->GetTransform());
+    const vrb::Vector& min = m.quad->GetWorldMin();
+    const vrb::Vector& max = m.quad->GetWorldMax();
+    center = (min + max) * 0.5f;
+    // Quad::TestIntersection accepts hits up to 0.1 units off the quad plane.
+    const vrb::Vector extent = (max - min) * 0.5f + vrb::Vector(0.0f, 0.0f, 0.1f);
+    radius = extent.Magnitude();
+  } else {
+    surfaceTransform = widgetTransform.PostMultiply(m.cylinder->GetTransformNode()->GetTransform());
+    // In cylinder space the visible arc is centered at (0, 0, -radius). Any point of the arc is
+    // closer to that center than its distance measured along the surface.
+    const float cylinderRadius = m.cylinder->GetCylinderRadius();
+    const float halfArc = cylinderRadius * m.cylinder->GetCylinderTheta() * 0.5f;
+    const float halfHeight = std::max(m.cylinder->GetCylinderHeight() * 0.5f, cylinderRadius);
+    center = vrb::Vector(0.0f, 0.0f, -cylinderRadius);
+    radius = sqrtf(halfArc * halfArc + halfHeight * halfHeight);
+  }
+
+  aCenter = surfaceTransform.MultiplyPosition(center);
+  aRadius = radius * MaxAxisScale(surfaceTransform);
+}
+
 void
 Widget::ConvertToWidgetCoordinates(const vrb::Vector& point, float& aX, float& aY, bool aClamp) const {
   bool clamp = !m.resizing;
@@ -398,6 +446,7 @@ Widget::SetTransform(const vrb::Matrix& aTransform) {
     m.UpdateCylinderMatrix();
   }
   m.UpdateResizerTransform();
+  m.InvalidateBounds();
 }
 
 void
@@ -446,6 +495,7 @@ Widget::SetQuad(const QuadPtr& aQuad) {
   m.RemoveResizer();
   m.RemoveBorder();
   m.UpdateSurface(textureWidth, textureHeight);
+  m.InvalidateBounds();
 }
 
 void
@@ -466,6 +516,7 @@ Widget::SetCylinder(const CylinderPtr& aCylinder) {
   m.RemoveResizer();
   m.RemoveBorder();
   m.UpdateSurface(textureWidth, textureHeight);
+  m.InvalidateBounds();
 }
 
 VRLayerSurfacePtr
@@ -508,6 +559,7 @@ Widget::SetPlacement(const WidgetPlacementPtr& aPlacement) {
   } else if (m.cylinder && aPlacement->composited) {
     m.cylinder->SetTintColor(aPlacement->GetTintColor());
   }
+  m.InvalidateBounds();
 }
 
 WidgetResizerPtr
@@ -575,6 +627,7 @@ Widget::HandleResize(const vrb::Vector& aPoint, bool aPressed, bool& aResized, b
       m.UpdateCylinderMatrix();
     }
     m.RemoveBorder();
+    m.InvalidateBounds();
   }
 }
 
@@ -639,10 +692,10 @@ Widget::SetProxifyLayer(const bool aValue) {
     m.layerProxy = vrb::Toggle::Create(create);
     // Proxy objects must clear the existing surface, so set a proper blend function.
     m.layerProxy->SetPreRenderLambda(create, []() {
-      VRB_GL_CHECK(glBlendFunc(GL_ZERO, GL_ONE_MINUS_SRC_ALPHA));
+      GLStateCache::BlendFunc(GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
     });
     m.layerProxy->SetPostRenderLambda(create, []() {
-      VRB_GL_CHECK(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+      GLStateCache::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     });
     m.transform->AddNode(m.layerProxy);
     int32_t textureWidth, textureHeight;
@@ -677,6 +730,7 @@ void Widget::LayoutQuadWithCylinderParent(const WidgetPtr& aParent) {
   if (!aParent) {
     // No parent, reset the container transform.
     m.transformContainer->SetTransform(vrb::Matrix::Identity());
+    m.InvalidateBounds();
     return;
   }
   CylinderPtr cylinder = aParent->GetCylinder();
@@ -694,6 +748,7 @@ void Widget::LayoutQuadWithCylinderParent(const WidgetPtr& aParent) {
     m.transformContainer->SetTransform(aParent->m.transformContainer->GetTransform());
   }
   m.UpdateResizerTransform();
+  m.InvalidateBounds();
 }
 
 void Widget::RecenterYawInCylinderLayer(const vrb::Matrix& reorientMatrix) {
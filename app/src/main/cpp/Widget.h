@@ -54,6 +54,10 @@ public:
   void GetWorldSize(float& aWidth, float& aHeight) const;
   bool TestControllerIntersection(const vrb::Vector& aStartPoint, const vrb::Vector& aDirection, vrb::Vector& aResult, vrb::Vector& aNormal,
                                   const bool aClamp, bool& aIsInWidget, float& aDistance) const;
+  // Incremented every time the widget transform or size changes, so callers can cache bounds.
+  uint32_t GetBoundsRevision() const;
+  // Sphere enclosing the hittable surface, in the space of the scene root the widget was added to.
+  void GetBoundingSphere(vrb::Vector& aCenter, float& aRadius) const;
   void ConvertToWidgetCoordinates(const vrb::Vector& aPoint, float& aX, float& aY, bool aClamp = true) const;
   vrb::Vector ConvertToWorldCoordinates(const vrb::Vector& aLocalPoint) const;
   vrb::Vector ConvertToWorldCoordinates(const float aWidgetX, const float aWidgetY) const;
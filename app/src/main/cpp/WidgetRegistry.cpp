@@ -0,0 +1,203 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "WidgetRegistry.h"
+#include "Widget.h"
+#include "WidgetPlacement.h"
+#include "vrb/ConcreteClass.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace crow {
+
+namespace {
+
+struct Entry {
+  WidgetPtr widget;
+  uint64_t sequence = 0;
+  int32_t parent = 0;
+};
+
+const std::vector<WidgetPtr> kNoChildren;
+
+} // namespace
+
+struct WidgetRegistry::State {
+  std::vector<WidgetPtr> widgets;
+  std::unordered_map<uint32_t, Entry> entries;
+  // Keyed by parent handle. A child is listed even if its parent is not registered yet.
+  std::unordered_map<uint32_t, std::vector<WidgetPtr>> children;
+  uint64_t nextSequence;
+  mutable std::vector<WidgetPtr> order;
+  mutable std::vector<std::pair<int32_t, uint64_t>> orderKeys;
+  mutable bool orderDirty;
+
+  State()
+      : nextSequence(0)
+      , orderDirty(true)
+  {}
+
+  static int32_t ParentHandle(const WidgetPtr& aWidget) {
+    return aWidget->GetPlacement() ? aWidget->GetPlacement()->parentHandle : 0;
+  }
+
+  const Entry* Find(const uint32_t aHandle) const {
+    auto it = entries.find(aHandle);
+    return it != entries.end() ? &it->second : nullptr;
+  }
+
+  void AddChild(const Entry& aEntry) {
+    if (aEntry.parent <= 0) {
+      return;
+    }
+    std::vector<WidgetPtr>& list = children[(uint32_t) aEntry.parent];
+    auto it = std::lower_bound(list.begin(), list.end(), aEntry.sequence, [this](const WidgetPtr& aWidget, const uint64_t aSequence) {
+      return Find(aWidget->GetHandle())->sequence < aSequence;
+    });
+    list.insert(it, aEntry.widget);
+  }
+
+  void RemoveChild(const Entry& aEntry) {
+    if (aEntry.parent <= 0) {
+      return;
+    }
+    auto it = children.find((uint32_t) aEntry.parent);
+    if (it == children.end()) {
+      return;
+    }
+    std::vector<WidgetPtr>& list = it->second;
+    list.erase(std::remove(list.begin(), list.end(), aEntry.widget), list.end());
+    if (list.empty()) {
+      children.erase(it);
+    }
+  }
+
+  int32_t Depth(const uint32_t aHandle) const {
+    int32_t result = 0;
+    const Entry* current = Find(aHandle);
+    // Bounded by the widget count so that a placement cycle can not hang the render thread.
+    while (current && current->parent > 0 && result < (int32_t) widgets.size()) {
+      current = Find((uint32_t) current->parent);
+      if (current) {
+        result++;
+      }
+    }
+    return result;
+  }
+};
+
+WidgetRegistryPtr
+WidgetRegistry::Create() {
+  return std::make_shared<vrb::ConcreteClass<WidgetRegistry, WidgetRegistry::State> >();
+}
+
+void
+WidgetRegistry::AddWidget(const WidgetPtr& aWidget) {
+  if (!aWidget || m.Find(aWidget->GetHandle())) {
+    return;
+  }
+  Entry entry;
+  entry.widget = aWidget;
+  entry.sequence = m.nextSequence++;
+  entry.parent = State::ParentHandle(aWidget);
+  m.entries.emplace(aWidget->GetHandle(), entry);
+  m.widgets.push_back(aWidget);
+  m.AddChild(entry);
+  m.orderDirty = true;
+}
+
+void
+WidgetRegistry::RemoveWidget(const WidgetPtr& aWidget) {
+  if (!aWidget) {
+    return;
+  }
+  auto it = m.entries.find(aWidget->GetHandle());
+  if (it == m.entries.end() || it->second.widget != aWidget) {
+    return;
+  }
+  m.RemoveChild(it->second);
+  m.entries.erase(it);
+  m.widgets.erase(std::remove(m.widgets.begin(), m.widgets.end(), aWidget), m.widgets.end());
+  m.orderDirty = true;
+}
+
+void
+WidgetRegistry::SyncParent(const WidgetPtr& aWidget) {
+  auto it = m.entries.find(aWidget->GetHandle());
+  if (it == m.entries.end()) {
+    return;
+  }
+  Entry& entry = it->second;
+  const int32_t parent = State::ParentHandle(aWidget);
+  if (parent == entry.parent) {
+    return;
+  }
+  m.RemoveChild(entry);
+  entry.parent = parent;
+  m.AddChild(entry);
+  m.orderDirty = true;
+}
+
+WidgetPtr
+WidgetRegistry::GetWidget(const uint32_t aHandle) const {
+  const Entry* entry = m.Find(aHandle);
+  return entry ? entry->widget : nullptr;
+}
+
+const std::vector<WidgetPtr>&
+WidgetRegistry::GetWidgets() const {
+  return m.widgets;
+}
+
+const std::vector<WidgetPtr>&
+WidgetRegistry::GetChildren(const uint32_t aHandle) const {
+  auto it = m.children.find(aHandle);
+  return it != m.children.end() ? it->second : kNoChildren;
+}
+
+const std::vector<WidgetPtr>&
+WidgetRegistry::GetTopologicalOrder() const {
+  if (!m.orderDirty) {
+    return m.order;
+  }
+  // Sorting by the number of ancestors keeps every parent ahead of its children.
+  m.orderKeys.clear();
+  for (const WidgetPtr& widget: m.widgets) {
+    const uint32_t handle = widget->GetHandle();
+    m.orderKeys.emplace_back(m.Depth(handle), m.Find(handle)->sequence);
+  }
+  std::vector<size_t> indices(m.widgets.size());
+  for (size_t i = 0; i < indices.size(); ++i) {
+    indices[i] = i;
+  }
+  std::sort(indices.begin(), indices.end(), [this](const size_t a, const size_t b) {
+    return m.orderKeys[a] < m.orderKeys[b];
+  });
+  m.order.clear();
+  for (const size_t index: indices) {
+    m.order.push_back(m.widgets[index]);
+  }
+  m.orderDirty = false;
+  return m.order;
+}
+
+bool
+WidgetRegistry::IsAncestor(const uint32_t aHandle, const uint32_t aAncestorHandle) const {
+  const Entry* current = m.Find(aHandle);
+  int32_t steps = 0;
+  while (current && current->parent > 0 && steps++ <= (int32_t) m.widgets.size()) {
+    if ((uint32_t) current->parent == aAncestorHandle) {
+      return true;
+    }
+    current = m.Find((uint32_t) current->parent);
+  }
+  return false;
+}
+
+WidgetRegistry::WidgetRegistry(State& aState) : m(aState) {
+}
+
+} // namespace crow
@@ -0,0 +1,52 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_WIDGET_REGISTRY_DOT_H
+#define VRBROWSER_WIDGET_REGISTRY_DOT_H
+
+#include "vrb/MacroUtils.h"
+
+#include <memory>
+#include <vector>
+
+namespace crow {
+
+class Widget;
+typedef std::shared_ptr<Widget> WidgetPtr;
+
+class WidgetRegistry;
+typedef std::shared_ptr<WidgetRegistry> WidgetRegistryPtr;
+
+// Owns the widgets of the BrowserWorld indexed by handle, along with the parent/child relations
+// described by their placements.
+class WidgetRegistry {
+public:
+  static WidgetRegistryPtr Create();
+  void AddWidget(const WidgetPtr& aWidget);
+  void RemoveWidget(const WidgetPtr& aWidget);
+  // Must be called whenever the placement of a registered widget is replaced, as its parent may change.
+  void SyncParent(const WidgetPtr& aWidget);
+  WidgetPtr GetWidget(const uint32_t aHandle) const;
+  // Widgets in insertion order.
+  const std::vector<WidgetPtr>& GetWidgets() const;
+  // Registered children of the widget, in insertion order.
+  const std::vector<WidgetPtr>& GetChildren(const uint32_t aHandle) const;
+  // Widgets sorted so that every parent comes before its children.
+  const std::vector<WidgetPtr>& GetTopologicalOrder() const;
+  // Whether aAncestorHandle is found walking up the registered parents of aHandle.
+  bool IsAncestor(const uint32_t aHandle, const uint32_t aAncestorHandle) const;
+protected:
+  struct State;
+  WidgetRegistry(State& aState);
+  ~WidgetRegistry() = default;
+private:
+  State& m;
+  WidgetRegistry() = delete;
+  VRB_NO_DEFAULTS(WidgetRegistry)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_WIDGET_REGISTRY_DOT_H
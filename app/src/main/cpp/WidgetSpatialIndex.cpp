@@ -0,0 +1,312 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "WidgetSpatialIndex.h"
+#include "MatrixUtils.h"
+#include "Widget.h"
+#include "vrb/ConcreteClass.h"
+
+#include "vrb/Matrix.h"
+#include "vrb/Transform.h"
+#include "vrb/Vector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace crow {
+
+namespace {
+
+const int32_t kMaxLeafSize = 4;
+const int32_t kMaxTraversalDepth = 64;
+const float kEpsilon = 0.000001f;
+
+struct Bounds {
+  float min[3];
+  float max[3];
+
+  void Reset() {
+    for (int i = 0; i < 3; ++i) {
+      min[i] = std::numeric_limits<float>::max();
+      max[i] = -std::numeric_limits<float>::max();
+    }
+  }
+
+  void Extend(const Bounds& aOther) {
+    for (int i = 0; i < 3; ++i) {
+      min[i] = std::min(min[i], aOther.min[i]);
+      max[i] = std::max(max[i], aOther.max[i]);
+    }
+  }
+
+  // Slab test against the infinite line. Quad and Cylinder intersection tests do not reject hits
+  // behind the ray origin, so the broad phase must not either.
+  bool IntersectsLine(const float* aStart, const float* aDirection) const {
+    float tMin = -std::numeric_limits<float>::max();
+    float tMax = std::numeric_limits<float>::max();
+    for (int i = 0; i < 3; ++i) {
+      if (fabsf(aDirection[i]) < kEpsilon) {
+        if (aStart[i] < min[i] || aStart[i] > max[i]) {
+          return false;
+        }
+        continue;
+      }
+      const float inverse = 1.0f / aDirection[i];
+      float t0 = (min[i] - aStart[i]) * inverse;
+      float t1 = (max[i] - aStart[i]) * inverse;
+      if (t0 > t1) {
+        std::swap(t0, t1);
+      }
+      tMin = std::max(tMin, t0);
+      tMax = std::min(tMax, t1);
+      if (tMin > tMax) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+struct Entry {
+  WidgetPtr widget;
+  int32_t root;
+  uint32_t revision;
+  bool valid;
+  Bounds bounds;
+  float center[3];
+};
+
+struct BVHNode {
+  Bounds bounds;
+  int32_t left;
+  int32_t right;
+  int32_t first;
+  int32_t count;
+};
+
+struct SceneRoot {
+  vrb::TransformPtr node;
+  vrb::Matrix worldTransform;
+  float scale;
+  bool changed;
+};
+
+} // namespace
+
+struct WidgetSpatialIndex::State {
+  std::vector<Entry> entries;
+  std::vector<SceneRoot> roots;
+  std::vector<BVHNode> nodes;
+  std::vector<int32_t> leaves;
+  std::vector<int32_t> resizing;
+  mutable std::vector<int32_t> candidates;
+  bool dirty;
+
+  State()
+      : dirty(true)
+  {}
+
+  int32_t FindOrAddRoot(const vrb::TransformPtr& aRoot) {
+    for (size_t i = 0; i < roots.size(); ++i) {
+      if (roots[i].node == aRoot) {
+        return (int32_t) i;
+      }
+    }
+    SceneRoot root;
+    root.node = aRoot;
+    root.worldTransform = aRoot->GetWorldTransform();
+    root.scale = MaxAxisScale(root.worldTransform);
+    root.changed = true;
+    roots.push_back(root);
+    return (int32_t) roots.size() - 1;
+  }
+
+  void UpdateRoots() {
+    for (SceneRoot& root: roots) {
+      const vrb::Matrix world = root.node->GetWorldTransform();
+      root.changed = memcmp(world.Data(), root.worldTransform.Data(), sizeof(float) * 16) != 0;
+      if (root.changed) {
+        root.worldTransform = world;
+        root.scale = MaxAxisScale(world);
+      }
+    }
+  }
+
+  void UpdateEntry(Entry& aEntry) {
+    const SceneRoot& root = roots[aEntry.root];
+    vrb::Vector center;
+    float radius = 0.0f;
+    aEntry.widget->GetBoundingSphere(center, radius);
+    center = root.worldTransform.MultiplyPosition(center);
+    // Leave some slack for floating point error in the narrow phase.
+    radius = radius * root.scale * 1.01f + kEpsilon;
+    aEntry.center[0] = center.x();
+    aEntry.center[1] = center.y();
+    aEntry.center[2] = center.z();
+    for (int i = 0; i < 3; ++i) {
+      aEntry.bounds.min[i] = aEntry.center[i] - radius;
+      aEntry.bounds.max[i] = aEntry.center[i] + radius;
+    }
+    aEntry.revision = aEntry.widget->GetBoundsRevision();
+    aEntry.valid = true;
+  }
+
+  int32_t Build(const int32_t aFirst, const int32_t aCount) {
+    BVHNode node;
+    node.bounds.Reset();
+    node.left = node.right = -1;
+    node.first = aFirst;
+    node.count = aCount;
+    for (int32_t i = aFirst; i < aFirst + aCount; ++i) {
+      node.bounds.Extend(entries[leaves[i]].bounds);
+    }
+    const int32_t index = (int32_t) nodes.size();
+    nodes.push_back(node);
+    if (aCount <= kMaxLeafSize) {
+      return index;
+    }
+
+    // Median split along the longest axis of the node.
+    int axis = 0;
+    float longest = -1.0f;
+    for (int i = 0; i < 3; ++i) {
+      const float length = node.bounds.max[i] - node.bounds.min[i];
+      if (length > longest) {
+        longest = length;
+        axis = i;
+      }
+    }
+    const int32_t half = aCount / 2;
+    std::nth_element(leaves.begin() + aFirst, leaves.begin() + aFirst + half, leaves.begin() + aFirst + aCount,
+                     [&](const int32_t a, const int32_t b) {
+      return entries[a].center[axis] < entries[b].center[axis];
+    });
+    const int32_t left = Build(aFirst, half);
+    const int32_t right = Build(aFirst + half, aCount - half);
+    nodes[index].left = left;
+    nodes[index].right = right;
+    nodes[index].count = 0;
+    return index;
+  }
+
+  void Rebuild() {
+    nodes.clear();
+    leaves.clear();
+    for (size_t i = 0; i < entries.size(); ++i) {
+      if (entries[i].valid) {
+        leaves.push_back((int32_t) i);
+      }
+    }
+    if (!leaves.empty()) {
+      Build(0, (int32_t) leaves.size());
+    }
+    dirty = false;
+  }
+};
+
+WidgetSpatialIndexPtr
+WidgetSpatialIndex::Create() {
+  return std::make_shared<vrb::ConcreteClass<WidgetSpatialIndex, WidgetSpatialIndex::State> >();
+}
+
+void
+WidgetSpatialIndex::AddWidget(const WidgetPtr& aWidget, const vrb::TransformPtr& aSceneRoot) {
+  if (!aWidget || !aSceneRoot) {
+    return;
+  }
+  RemoveWidget(aWidget);
+  Entry entry;
+  entry.widget = aWidget;
+  entry.root = m.FindOrAddRoot(aSceneRoot);
+  entry.revision = 0;
+  entry.valid = false;
+  m.entries.push_back(entry);
+  m.dirty = true;
+}
+
+void
+WidgetSpatialIndex::RemoveWidget(const WidgetPtr& aWidget) {
+  auto it = std::find_if(m.entries.begin(), m.entries.end(), [&](const Entry& aEntry) {
+    return aEntry.widget == aWidget;
+  });
+  if (it != m.entries.end()) {
+    m.entries.erase(it);
+    // Entry indices have shifted, drop the BVH until the next Update().
+    m.nodes.clear();
+    m.leaves.clear();
+    m.resizing.clear();
+    m.dirty = true;
+  }
+}
+
+void
+WidgetSpatialIndex::Update() {
+  m.UpdateRoots();
+  m.resizing.clear();
+  for (size_t i = 0; i < m.entries.size(); ++i) {
+    Entry& entry = m.entries[i];
+    if (!entry.valid || m.roots[entry.root].changed || entry.revision != entry.widget->GetBoundsRevision()) {
+      m.UpdateEntry(entry);
+      m.dirty = true;
+    }
+    if (entry.widget->IsResizing()) {
+      m.resizing.push_back((int32_t) i);
+    }
+  }
+  if (m.dirty) {
+    m.Rebuild();
+  }
+}
+
+void
+WidgetSpatialIndex::Query(const vrb::Vector& aStart, const vrb::Vector& aDirection, std::vector<WidgetPtr>& aResult) const {
+  aResult.clear();
+  m.candidates.clear();
+  m.candidates.insert(m.candidates.end(), m.resizing.begin(), m.resizing.end());
+
+  if (!m.nodes.empty()) {
+    const float start[3] = {aStart.x(), aStart.y(), aStart.z()};
+    const float direction[3] = {aDirection.x(), aDirection.y(), aDirection.z()};
+    int32_t stack[kMaxTraversalDepth];
+    int32_t top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+      const BVHNode& node = m.nodes[stack[--top]];
+      if (!node.bounds.IntersectsLine(start, direction)) {
+        continue;
+      }
+      if (node.left < 0) {
+        for (int32_t i = node.first; i < node.first + node.count; ++i) {
+          const int32_t entry = m.leaves[i];
+          if (m.entries[entry].bounds.IntersectsLine(start, direction)) {
+            m.candidates.push_back(entry);
+          }
+        }
+      } else if (top + 2 <= kMaxTraversalDepth) {
+        stack[top++] = node.left;
+        stack[top++] = node.right;
+      }
+    }
+  }
+
+  // Keep the same order as a linear scan so that ties are resolved the same way.
+  std::sort(m.candidates.begin(), m.candidates.end());
+  m.candidates.erase(std::unique(m.candidates.begin(), m.candidates.end()), m.candidates.end());
+  for (const int32_t index: m.candidates) {
+    aResult.push_back(m.entries[index].widget);
+  }
+}
+
+int32_t
+WidgetSpatialIndex::GetWidgetCount() const {
+  return (int32_t) m.entries.size();
+}
+
+WidgetSpatialIndex::WidgetSpatialIndex(State& aState) : m(aState) {
+}
+
+} // namespace crow
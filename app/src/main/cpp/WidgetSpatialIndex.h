@@ -0,0 +1,49 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_WIDGET_SPATIAL_INDEX_DOT_H
+#define VRBROWSER_WIDGET_SPATIAL_INDEX_DOT_H
+
+#include "vrb/Forward.h"
+#include "vrb/MacroUtils.h"
+
+#include <memory>
+#include <vector>
+
+namespace crow {
+
+class Widget;
+typedef std::shared_ptr<Widget> WidgetPtr;
+
+class WidgetSpatialIndex;
+typedef std::shared_ptr<WidgetSpatialIndex> WidgetSpatialIndexPtr;
+
+// Broad phase for controller ray hit testing. Keeps a world space bounding sphere per widget,
+// refreshed only when the widget or its scene root moves, and a small BVH built over them.
+class WidgetSpatialIndex {
+public:
+  static WidgetSpatialIndexPtr Create();
+  void AddWidget(const WidgetPtr& aWidget, const vrb::TransformPtr& aSceneRoot);
+  void RemoveWidget(const WidgetPtr& aWidget);
+  // Refreshes the bounds of the widgets that moved and rebuilds the BVH if needed.
+  void Update();
+  // Returns the widgets whose bounds are crossed by the line defined by the ray, in insertion order.
+  // Widgets being resized are always returned because the resize handles extend past their bounds.
+  // Must be called after Update().
+  void Query(const vrb::Vector& aStart, const vrb::Vector& aDirection, std::vector<WidgetPtr>& aResult) const;
+  int32_t GetWidgetCount() const;
+protected:
+  struct State;
+  WidgetSpatialIndex(State& aState);
+  ~WidgetSpatialIndex() = default;
+private:
+  State& m;
+  WidgetSpatialIndex() = delete;
+  VRB_NO_DEFAULTS(WidgetSpatialIndex)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_WIDGET_SPATIAL_INDEX_DOT_H
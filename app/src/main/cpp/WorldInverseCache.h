@@ -0,0 +1,36 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_WORLD_INVERSE_CACHE_DOT_H
+#define VRBROWSER_WORLD_INVERSE_CACHE_DOT_H
+
+#include "vrb/Matrix.h"
+
+#include <cstring>
+
+namespace crow {
+
+// Keeps the inverse of the last world transform it was given. Widget surfaces are hit tested several
+// times per frame against transforms that rarely change, so the inverse is only recomputed when the
+// transform differs.
+class WorldInverseCache {
+public:
+  const vrb::Matrix& Get(const vrb::Matrix& aWorldTransform) {
+    if (!mValid || memcmp(mWorldTransform.Data(), aWorldTransform.Data(), sizeof(float) * 16) != 0) {
+      mWorldTransform = aWorldTransform;
+      mWorldInverse = aWorldTransform.AfineInverse();
+      mValid = true;
+    }
+    return mWorldInverse;
+  }
+private:
+  vrb::Matrix mWorldTransform;
+  vrb::Matrix mWorldInverse;
+  bool mValid = false;
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_WORLD_INVERSE_CACHE_DOT_H
@@ -53,6 +53,7 @@ struct DeviceDelegateNoAPI::State {
   bool clicked;
   GLsizei glWidth, glHeight;
   float near, far;
+  InputTracePlayerPtr player;
   State()
       : renderMode(device::RenderMode::StandAlone)
       , heading(0.0f)
@@ -81,6 +82,10 @@ struct DeviceDelegateNoAPI::State {
   void Shutdown() {
   }
 
+  void UpdateCamera() {
+    camera->SetTransform(headingMatrix.PostMultiply(pitchMatrix).Translate(position));
+  }
+
   void UpdateDisplay() {
     if (display) {
       vrb::Matrix fov = vrb::Matrix::PerspectiveMatrixWithResolutionDegrees(glWidth / 2, glHeight,
@@ -186,6 +191,9 @@ DeviceDelegateNoAPI::SetClipPlanes(const float aNear, const float aFar) {
 void
 DeviceDelegateNoAPI::SetControllerDelegate(ControllerDelegatePtr& aController) {
   m.controller = aController;
+  if (m.player) {
+    return;
+  }
   m.controller->CreateController(kControllerIndex, -1, "Oculus Touch (Right)"); // "Wolvic Virtual Controller");
   m.controller->SetEnabled(kControllerIndex, true);
   m.controller->SetCapabilityFlags(kControllerIndex, device::Orientation | device::Position);
@@ -213,7 +221,12 @@ DeviceDelegateNoAPI::GetControllerModelName(const int32_t) const {
 
 void
 DeviceDelegateNoAPI::ProcessEvents() {
-  m.camera->SetTransform(m.headingMatrix.PostMultiply(m.pitchMatrix).Translate(m.position));
+  if (m.player && m.controller) {
+    m.player->PlayFrame(*m.controller);
+    m.camera->SetTransform(m.player->GetHeadTransform());
+    return;
+  }
+  m.UpdateCamera();
 }
 
 void
@@ -224,7 +237,7 @@ DeviceDelegateNoAPI::StartFrame(const FramePrediction aPrediction) {
   VRB_GL_CHECK(glEnable(GL_BLEND));
   VRB_GL_CHECK(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
   mShouldRender = true;
-  if (m.controller) {
+  if (m.controller && !m.player) {
     vrb::RenderContextPtr context = m.context.lock();
     if (context) {
       float level = 100.0 - std::fmod(context->GetTimestamp(), 100.0);
@@ -321,12 +334,12 @@ DeviceDelegateNoAPI::MoveAxis(const float aX, const float aY, const float aZ) {
     m.pitch = 0.0f;
     m.headingMatrix = vrb::Matrix::Identity();
     m.pitchMatrix = vrb::Matrix::Identity();
-    ProcessEvents();
+    m.UpdateCamera();
     return;
   }
   VRB_LOG("pos: %s heading: %f pitch: %f", m.position.ToString().c_str(), m.heading, m.pitch);
   m.position += m.headingMatrix.MultiplyDirection(vrb::Vector(aX, aY, aZ));
-  ProcessEvents();
+  m.UpdateCamera();
 }
 
 void
@@ -334,7 +347,7 @@ DeviceDelegateNoAPI::RotateHeading(const float aHeading) {
   static const vrb::Vector sUp(0.0f, 1.0f, 0.0f);
   m.heading += aHeading;
   m.headingMatrix = vrb::Matrix::Rotation(sUp, m.heading);
-  ProcessEvents();
+  m.UpdateCamera();
 }
 
 void
@@ -342,7 +355,7 @@ DeviceDelegateNoAPI::RotatePitch(const float aPitch) {
   static const vrb::Vector sLeft(1.0f, 0.0f, 0.0f);
   m.pitch += aPitch;
   m.pitchMatrix = vrb::Matrix::Rotation(sLeft, m.pitch);
-  ProcessEvents();
+  m.UpdateCamera();
 }
 
 static float
@@ -358,7 +371,7 @@ Clamp(const float aValue) {
 void
 DeviceDelegateNoAPI::TouchEvent(const bool aDown, const float aX, const float aY) {
   static const vrb::Vector sForward(0.0f, 0.0f, -1.0f);
-  if (!m.controller) {
+  if (!m.controller || m.player) {
     return;
   }
   if (m.renderMode == device::RenderMode::Immersive) {
@@ -398,7 +411,7 @@ DeviceDelegateNoAPI::TouchEvent(const bool aDown, const float aX, const float aY
 
 void
 DeviceDelegateNoAPI::ControllerButtonPressed(const bool aDown) {
-  if (!m.controller) {
+  if (!m.controller || m.player) {
     return;
   }
 
@@ -411,6 +424,11 @@ DeviceDelegateNoAPI::ControllerButtonPressed(const bool aDown) {
 
 }
 
+void
+DeviceDelegateNoAPI::SetInputTracePlayer(const InputTracePlayerPtr& aPlayer) {
+  m.player = aPlayer;
+}
+
 DeviceDelegateNoAPI::DeviceDelegateNoAPI(State& aState) : m(aState) {}
 DeviceDelegateNoAPI::~DeviceDelegateNoAPI() { m.Shutdown(); }
 
@@ -9,6 +9,7 @@
 #include "vrb/Forward.h"
 #include "vrb/MacroUtils.h"
 #include "DeviceDelegate.h"
+#include "InputTrace.h"
 
 #include <jni.h>
 #include <memory>
@@ -52,6 +53,10 @@ public:
   void RotatePitch(const float aPitch);
   void TouchEvent(const bool aDown, const float aX, const float aY);
   void ControllerButtonPressed(const bool aDown);
+  // Replaces the virtual controller with the controllers recorded in the trace and moves the head
+  // as recorded. One frame of the trace is played each time the events are processed, and the
+  // synthetic input above is ignored. Must be set before the controller delegate.
+  void SetInputTracePlayer(const InputTracePlayerPtr& aPlayer);
 protected:
   struct State;
   DeviceDelegateNoAPI(State& aState);
@@ -25,6 +25,8 @@
 #include <vector>
 #include <array>
 #include <algorithm>
+#include <chrono>
+#include <limits>
 #include <assert.h>
 #include <cstdlib>
 #include <unistd.h>
@@ -45,6 +47,14 @@
 
 namespace crow {
 
+// Keeps the projected area of layers close to the head finite when ranking them.
+const float kMinLayerDistance = 0.1f;
+// Composition layer slots kept when handing out UI layers: the projection layer, the cube or
+// passthrough layer, and two for a video, either a stereo equirect layer or the second eye of a
+// stereo window layer. Every UI layer that is handed out then fits in the frame, so none is hidden.
+const uint32_t kReservedLayerCount = 4;
+const uint64_t kSwapChainStatsInterval = 1000; // frames
+
 struct HandMeshPropertiesMSFT {
     uint32_t indexCount = 0;
     uint32_t vertexCount = 0;
@@ -71,6 +81,17 @@ struct DeviceDelegateOpenXR::State {
   std::vector<OpenXRSwapChainPtr> eyeSwapChains;
   OpenXRSwapChainPtr boundSwapChain;
   OpenXRSwapChainPtr previousBoundSwapchain;
+  // In multiview mode a single texture array swapchain holds both eye views.
+  bool multiviewSupported = false;
+  bool multiviewRequested = false;
+  bool multiviewEnabled = false;
+  uint64_t swapChainStatsFrames = 0;
+  bool lateLatchEnabled = true;
+  bool lateLatchPending = false;
+  std::vector<XrView> lateLatchViews;
+  FrameStats frameStats;
+  FrameStats currentFrameStats;
+  std::chrono::steady_clock::time_point frameBeginTime;
   XrSpace viewSpace = XR_NULL_HANDLE;
   XrSpace localSpace = XR_NULL_HANDLE;
   XrSpace layersSpace = XR_NULL_HANDLE;
@@ -101,6 +122,20 @@ struct DeviceDelegateOpenXR::State {
   device::CPULevel minCPULevel = device::CPULevel::Normal;
   device::DeviceType deviceType = device::UnknownType;
   std::vector<const XrCompositionLayerBaseHeader*> frameEndLayers;
+  struct LayerCandidate {
+    uint32_t index;
+    uint32_t headerCount;
+    bool drawInFront;
+    int32_t priority;
+    float area;
+  };
+  std::vector<LayerCandidate> layerCandidates;
+  std::vector<bool> selectedUILayers;
+  XrCompositionLayerProjection projectionLayer{XR_TYPE_COMPOSITION_LAYER_PROJECTION};
+  std::vector<XrCompositionLayerProjectionView> projectionLayerViews;
+  LayerStats layerStats;
+  // UI layers that can be alive at once, see kReservedLayerCount.
+  uint32_t uiLayerBudget = std::numeric_limits<uint32_t>::max();
   std::function<void()> controllersReadyCallback;
   std::optional<XrPosef> firstPose;
   bool mHandTrackingSupported = false;
@@ -115,6 +150,60 @@ struct DeviceDelegateOpenXR::State {
   std::vector<XrEnvironmentBlendMode> blendModes;
   XrEnvironmentBlendMode immersiveBlendMode { XR_ENVIRONMENT_BLEND_MODE_OPAQUE };
 
+  // Approximate solid angle covered by the layer, as seen from the last view it was drawn with.
+  static float ProjectedArea(const VRLayer& aLayer) {
+    const VRLayerSurface* surface = dynamic_cast<const VRLayerSurface*>(&aLayer);
+    if (!surface)
+      return 0.0f;
+    const vrb::Vector center = aLayer.GetView(device::Eye::Left).MultiplyPosition(
+        aLayer.GetModelTransform(device::Eye::Left).GetTranslation());
+    const float distanceSquared = std::max(center.Dot(center), kMinLayerDistance * kMinLayerDistance);
+    return surface->GetWorldWidth() * surface->GetWorldHeight() / distanceSquared;
+  }
+
+  // Picks which of the requested UI layers fit in aBudget composition layer headers. Front layers
+  // win, then higher priority, then the largest on screen. uiLayers must already be sorted.
+  // kReservedLayerCount keeps uiLayerBudget low enough for every UI layer to fit, so a layer is
+  // only left out if that reservation is wrong.
+  uint32_t SelectUILayers(const uint32_t aBudget) {
+    layerCandidates.clear();
+    selectedUILayers.assign(uiLayers.size(), false);
+    for (uint32_t i = 0; i < uiLayers.size(); ++i) {
+      const OpenXRLayerPtr& layer = uiLayers[i];
+      if (!layer->IsDrawRequested())
+        continue;
+      layerCandidates.push_back({i, layer->HeaderCount(), layer->GetDrawInFront(),
+                                 layer->GetLayer()->GetPriority(), ProjectedArea(*layer->GetLayer())});
+    }
+    std::sort(layerCandidates.begin(), layerCandidates.end(), [](const LayerCandidate& a, const LayerCandidate& b) {
+      if (a.drawInFront != b.drawInFront)
+        return a.drawInFront;
+      if (a.priority != b.priority)
+        return a.priority > b.priority;
+      if (a.area != b.area)
+        return a.area > b.area;
+      return a.index < b.index;
+    });
+
+    uint32_t remaining = aBudget;
+    uint32_t dropped = 0;
+    for (const LayerCandidate& candidate: layerCandidates) {
+      if (candidate.headerCount <= remaining) {
+        selectedUILayers[candidate.index] = true;
+        remaining -= candidate.headerCount;
+      } else {
+        dropped++;
+      }
+    }
+
+    layerStats.requestedLayers = (uint32_t) layerCandidates.size();
+    if (dropped > 0 && layerStats.droppedLayers == 0) {
+      VRB_ERROR("OpenXR layer budget exceeded, %u of %u UI layers are not shown", dropped, layerStats.requestedLayers);
+    }
+    layerStats.droppedLayers = dropped;
+    return aBudget - remaining;
+  }
+
   bool IsPositionTrackingSupported() {
       CHECK(system != XR_NULL_SYSTEM_ID);
       CHECK(instance != XR_NULL_HANDLE);
@@ -194,6 +283,9 @@ struct DeviceDelegateOpenXR::State {
     if (OpenXRExtensions::IsExtensionSupported(XR_EXTX_OVERLAY_EXTENSION_NAME))
         extensions.push_back(XR_EXTX_OVERLAY_EXTENSION_NAME);
 
+    if (OpenXRExtensions::IsExtensionSupported(XR_KHR_CONVERT_TIMESPEC_TIME_EXTENSION_NAME))
+        extensions.push_back(XR_KHR_CONVERT_TIMESPEC_TIME_EXTENSION_NAME);
+
     java = {XR_TYPE_INSTANCE_CREATE_INFO_ANDROID_KHR};
     java.applicationVM = javaContext->vm;
     java.applicationActivity = javaContext->activity;
@@ -251,8 +343,14 @@ struct DeviceDelegateOpenXR::State {
     CHECK_XRCMD(xrGetSystemProperties(instance, system, &systemProperties))
     VRB_LOG("OpenXR system name: %s", systemProperties.systemName);
 
-    if (systemProperties.graphicsProperties.maxLayerCount == 0)
+    // Runtimes reporting 0 layers, like Spaces, or too few for the reserved ones get no UI layer, so
+    // all the widgets are drawn in the projection layer.
+    const uint32_t maxLayerCount = systemProperties.graphicsProperties.maxLayerCount;
+    if (maxLayerCount == 0) {
         VRB_ERROR("OpenXR runtime reports 0 layers. There must be at least 1");
+    }
+    uiLayerBudget = maxLayerCount > kReservedLayerCount ? maxLayerCount - kReservedLayerCount : 0;
+    VRB_LOG("OpenXR runtime supports %u layers, up to %u UI layers", maxLayerCount, uiLayerBudget);
 
     mHandTrackingSupported = handTrackingProperties.supportsHandTracking;
     VRB_LOG("OpenXR runtime %s hand tracking", mHandTrackingSupported ? "does support" : "doesn't support");
@@ -324,16 +422,134 @@ struct DeviceDelegateOpenXR::State {
     // Cache view buffer (used in xrLocateViews)
     views.resize(viewCount, {XR_TYPE_VIEW});
 
+    multiviewSupported = viewCount == 2 &&
+        viewConfig[0].recommendedImageRectWidth == viewConfig[1].recommendedImageRectWidth &&
+        viewConfig[0].recommendedImageRectHeight == viewConfig[1].recommendedImageRectHeight;
+    InitializeEyeSwapChains();
+    VRB_DEBUG("OpenXR available views: %d", (int)views.size());
+  }
+
+  // (Re)creates the eye swapchains for the current render mode. Falls back to one swapchain per
+  // eye if the texture array swapchain can not be rendered to with OVR_multiview.
+  void InitializeEyeSwapChains() {
     vrb::RenderContextPtr render = context.lock();
+    if (boundSwapChain) {
+      boundSwapChain->ReleaseImage();
+      boundSwapChain = nullptr;
+    }
+    eyeSwapChains.clear();
+
+    multiviewEnabled = false;
+    if (multiviewSupported && multiviewRequested) {
+      auto swapChain = OpenXRSwapChain::create();
+      XrSwapchainCreateInfo info = GetSwapChainCreateInfo();
+      info.arraySize = (uint32_t)views.size();
+      swapChain->InitFBO(render, session, info, GetFBOAttributes());
+      if (swapChain->IsMultiviewComplete()) {
+        eyeSwapChains.push_back(swapChain);
+        multiviewEnabled = true;
+        return;
+      }
+      VRB_WARN("OpenXR multiview eye swapchain not supported, using one swapchain per eye");
+      multiviewSupported = false;
+    }
 
     // Create the main swapChain for each eye view
-    for (uint32_t i = 0; i < viewCount; i++) {
+    for (uint32_t i = 0; i < views.size(); i++) {
       auto swapChain = OpenXRSwapChain::create();
       XrSwapchainCreateInfo info = GetSwapChainCreateInfo();
       swapChain->InitFBO(render, session, info, GetFBOAttributes());
       eyeSwapChains.push_back(swapChain);
     }
-    VRB_DEBUG("OpenXR available views: %d", (int)eyeSwapChains.size());
+  }
+
+  void UpdateSwapChainStats() {
+    if (++swapChainStatsFrames < kSwapChainStatsInterval)
+      return;
+    for (uint32_t i = 0; i < eyeSwapChains.size(); ++i) {
+      const OpenXRSwapChain::ImageStats& stats = eyeSwapChains[i]->GetImageStats();
+      VRB_DEBUG("OpenXR eye swapchain %u: acquire %.1f us avg %llu us max, wait %.1f us avg %llu us max (%llu frames)", i,
+                stats.acquires ? (double)stats.acquireMicroseconds / stats.acquires : 0.0,
+                (unsigned long long)stats.maxAcquireMicroseconds,
+                stats.waits ? (double)stats.waitMicroseconds / stats.waits : 0.0,
+                (unsigned long long)stats.maxWaitMicroseconds, (unsigned long long)swapChainStatsFrames);
+      eyeSwapChains[i]->ResetImageStats();
+    }
+    swapChainStatsFrames = 0;
+  }
+
+  vrb::Matrix HeadTransform(const XrPosef& aPose) {
+    vrb::Matrix head = XrPoseToMatrix(aPose);
+#if HVR
+    if (IsPositionTrackingSupported()) {
+      // Convert from floor to local (HVR doesn't support stageSpace yet)
+      head.TranslateInPlace(vrb::Vector(-firstPose->position.x, -firstPose->position.y, -firstPose->position.z));
+    }
+#endif
+
+    if (renderMode == device::RenderMode::StandAlone) {
+      head.TranslateInPlace(kAverageHeight);
+    }
+    return head;
+  }
+
+  // Time left until the predicted display time, or 0 if the runtime can not convert clocks.
+  int64_t TimeToDisplay(const XrTime aDisplayTime) const {
+    if (!OpenXRExtensions::sXrConvertTimespecTimeToTimeKHR)
+      return 0;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    XrTime xrNow = 0;
+    if (XR_FAILED(OpenXRExtensions::sXrConvertTimespecTimeToTimeKHR(instance, &now, &xrNow)))
+      return 0;
+    return aDisplayTime - xrNow;
+  }
+
+  // Re-locates the head and the eye views for the current predicted display time. Only the
+  // cameras and the projection views are updated, so the rest of the frame keeps a consistent pose.
+  void LateLatchViews() {
+    lateLatchPending = false;
+    XrSpaceLocation location {XR_TYPE_SPACE_LOCATION};
+    if (XR_FAILED(xrLocateSpace(viewSpace, localSpace, predictedDisplayTime, &location)) ||
+        !(location.locationFlags & XR_SPACE_LOCATION_ORIENTATION_VALID_BIT))
+      return;
+
+    // Eye transforms are relative to the head, the projection views need them in local space.
+    XrViewState viewState{XR_TYPE_VIEW_STATE};
+    uint32_t viewCountOutput = 0;
+    XrViewLocateInfo viewLocateInfo{XR_TYPE_VIEW_LOCATE_INFO};
+    viewLocateInfo.viewConfigurationType = viewConfigType;
+    viewLocateInfo.displayTime = predictedDisplayTime;
+    viewLocateInfo.space = viewSpace;
+    std::vector<XrView>& eyeViews = lateLatchViews;
+    eyeViews.resize(views.size(), {XR_TYPE_VIEW});
+    if (XR_FAILED(xrLocateViews(session, &viewLocateInfo, &viewState, (uint32_t) eyeViews.size(), &viewCountOutput, eyeViews.data())))
+      return;
+    viewLocateInfo.space = localSpace;
+    if (XR_FAILED(xrLocateViews(session, &viewLocateInfo, &viewState, (uint32_t) views.size(), &viewCountOutput, views.data())))
+      return;
+
+    predictedPose = location.pose;
+    const vrb::Matrix head = HeadTransform(location.pose);
+    for (int i = 0; i < views.size(); ++i) {
+      cameras[i]->SetHeadTransform(head);
+      cameras[i]->SetEyeTransform(XrPoseToMatrix(eyeViews[i].pose));
+    }
+    currentFrameStats.lateLatched = true;
+    currentFrameStats.poseToDisplayNanoseconds = TimeToDisplay(predictedDisplayTime);
+  }
+
+  void UpdateFrameStats(const std::chrono::steady_clock::time_point& aEndFrameStart) {
+    const auto now = std::chrono::steady_clock::now();
+    currentFrameStats.cpuMicroseconds = (uint64_t) std::chrono::duration_cast<std::chrono::microseconds>(
+        aEndFrameStart - frameBeginTime).count();
+    currentFrameStats.endFrameMicroseconds = (uint64_t) std::chrono::duration_cast<std::chrono::microseconds>(
+        now - aEndFrameStart).count();
+    frameStats = currentFrameStats;
+  }
+
+  const OpenXRSwapChainPtr& EyeSwapChain(const int32_t aIndex) const {
+    return eyeSwapChains[multiviewEnabled ? 0 : aIndex];
   }
 
   void InitializeBlendModes() {
@@ -510,6 +726,22 @@ struct DeviceDelegateOpenXR::State {
     }
   }
 
+  // Widgets without a layer are drawn with their own geometry in the projection layer, so running
+  // out of layers does not hide anything.
+  bool CanCreateUILayer() {
+    if (!layersEnabled) {
+      return false;
+    }
+    if (uiLayers.size() < uiLayerBudget) {
+      return true;
+    }
+    if (layerStats.fallbackLayers == 0) {
+      VRB_WARN("OpenXR layer budget exhausted, new widgets are drawn in the projection layer");
+    }
+    layerStats.fallbackLayers++;
+    return false;
+  }
+
   void AddUILayer(const OpenXRLayerPtr& aLayer, VRLayerSurface::SurfaceType aSurfaceType) {
     if (session != XR_NULL_HANDLE) {
       vrb::RenderContextPtr ctx = context.lock();
@@ -794,11 +1026,7 @@ DeviceDelegateOpenXR::SetRenderMode(const device::RenderMode aMode) {
     return;
   }
   m.renderMode = aMode;
-  vrb::RenderContextPtr render = m.context.lock();
-  for (OpenXRSwapChainPtr& eyeSwapchain: m.eyeSwapChains) {
-    XrSwapchainCreateInfo info = m.GetSwapChainCreateInfo();
-    eyeSwapchain->InitFBO(render, m.session, info, m.GetFBOAttributes());
-  }
+  m.InitializeEyeSwapChains();
 
   m.UpdateClockLevels();
   m.UpdateDisplayRefreshRate();
@@ -981,15 +1209,26 @@ DeviceDelegateOpenXR::StartFrame(const FramePrediction aPrediction) {
   CHECK(m.session != XR_NULL_HANDLE);
   CHECK(m.viewSpace != XR_NULL_HANDLE);
 
+  if (m.multiviewEnabled != (m.multiviewRequested && m.multiviewSupported)) {
+    m.InitializeEyeSwapChains();
+  }
+
   // Throttle the application frame loop in order to synchronize
   // application frame submissions with the display.
   XrFrameWaitInfo frameWaitInfo{XR_TYPE_FRAME_WAIT_INFO};
   XrFrameState frameState{XR_TYPE_FRAME_STATE};
+  const auto waitStart = std::chrono::steady_clock::now();
   CHECK_XRCMD(xrWaitFrame(m.session, &frameWaitInfo, &frameState));
 
   // Begin frame and select the predicted display time
   XrFrameBeginInfo frameBeginInfo{XR_TYPE_FRAME_BEGIN_INFO};
   CHECK_XRCMD(xrBeginFrame(m.session, &frameBeginInfo));
+  m.frameBeginTime = std::chrono::steady_clock::now();
+  m.currentFrameStats = FrameStats();
+  m.currentFrameStats.frameIndex = m.frameStats.frameIndex + 1;
+  m.currentFrameStats.waitMicroseconds = (uint64_t) std::chrono::duration_cast<std::chrono::microseconds>(
+      m.frameBeginTime - waitStart).count();
+  m.currentFrameStats.displayPeriodNanoseconds = frameState.predictedDisplayPeriod;
 
   m.framePrediction = aPrediction;
   if (aPrediction == FramePrediction::ONE_FRAME_AHEAD) {
@@ -1005,6 +1244,17 @@ DeviceDelegateOpenXR::StartFrame(const FramePrediction aPrediction) {
   if (!frameState.shouldRender)
     return;
 
+  // The pose is only re-located when the views are rendered for the current display time.
+  m.lateLatchPending = m.lateLatchEnabled && m.renderMode == device::RenderMode::StandAlone &&
+      aPrediction == FramePrediction::NO_FRAME_AHEAD;
+
+  // Acquire the eye images now and only wait for them when an eye is bound, so that the
+  // runtime can release them while the frame is being prepared.
+  for (const OpenXRSwapChainPtr& eyeSwapChain: m.eyeSwapChains) {
+    if (!eyeSwapChain->HasRequestedImage())
+      eyeSwapChain->RequestImage();
+  }
+
   // Query head location
   XrSpaceLocation location {XR_TYPE_SPACE_LOCATION};
   CHECK_XRCMD(xrLocateSpace(m.viewSpace, m.localSpace, m.predictedDisplayTime, &location));
@@ -1013,17 +1263,8 @@ DeviceDelegateOpenXR::StartFrame(const FramePrediction aPrediction) {
     m.firstPose = location.pose;
   }
 
-  vrb::Matrix head = XrPoseToMatrix(location.pose);
-#if HVR
-  if (IsPositionTrackingSupported()) {
-    // Convert from floor to local (HVR doesn't support stageSpace yet)
-    head.TranslateInPlace(vrb::Vector(-m.firstPose->position.x, -m.firstPose->position.y, -m.firstPose->position.z));
-  }
-#endif
-
-  if (m.renderMode == device::RenderMode::StandAlone) {
-    head.TranslateInPlace(kAverageHeight);
-  }
+  vrb::Matrix head = m.HeadTransform(location.pose);
+  m.currentFrameStats.poseToDisplayNanoseconds = m.TimeToDisplay(m.predictedDisplayTime);
 
   m.cameras[0]->SetHeadTransform(head);
   m.cameras[1]->SetHeadTransform(head);
@@ -1138,18 +1379,29 @@ DeviceDelegateOpenXR::BindEye(const device::Eye aWhich) {
   }
 
   int32_t index = device::EyeIndex(aWhich);
-  if (index < 0 || index >= m.eyeSwapChains.size()) {
+  if (index < 0 || index >= m.views.size() || m.eyeSwapChains.empty()) {
     VRB_ERROR("No eye found");
     return;
   }
 
-  if (m.boundSwapChain) {
-    m.boundSwapChain->ReleaseImage();
+  if (m.lateLatchPending) {
+    m.LateLatchViews();
   }
 
-  m.boundSwapChain = m.eyeSwapChains[index];
-  m.boundSwapChain->AcquireImage();
-  m.boundSwapChain->BindFBO();
+  const OpenXRSwapChainPtr& swapChain = m.EyeSwapChain(index);
+  if (m.boundSwapChain != swapChain) {
+    if (m.boundSwapChain) {
+      m.boundSwapChain->ReleaseImage();
+    }
+    m.boundSwapChain = swapChain;
+    m.boundSwapChain->AcquireImage();
+  }
+  if (m.multiviewEnabled) {
+    // Both eyes share the image acquired for the frame, each one renders to its own layer.
+    m.boundSwapChain->BindFBOLayer((uint32_t)index);
+  } else {
+    m.boundSwapChain->BindFBO();
+  }
   VRB_GL_CHECK(glViewport(0, 0, m.boundSwapChain->Width(), m.boundSwapChain->Height()));
   VRB_GL_CHECK(glClearColor(m.clearColor.Red(), m.clearColor.Green(), m.clearColor.Blue(), m.clearColor.Alpha()));
   VRB_GL_CHECK(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
@@ -1158,6 +1410,45 @@ DeviceDelegateOpenXR::BindEye(const device::Eye aWhich) {
     layer->SetCurrentEye(aWhich);
 }
 
+bool
+DeviceDelegateOpenXR::BindStereo() {
+  if (!m.vrReady || !m.multiviewEnabled || m.eyeSwapChains.empty()) {
+    return false;
+  }
+  const OpenXRSwapChainPtr& swapChain = m.eyeSwapChains.front();
+  if (m.boundSwapChain != swapChain) {
+    if (m.boundSwapChain) {
+      m.boundSwapChain->ReleaseImage();
+    }
+    m.boundSwapChain = swapChain;
+    m.boundSwapChain->AcquireImage();
+  }
+  if (!m.boundSwapChain->BindMultiviewFBO()) {
+    return false;
+  }
+  VRB_GL_CHECK(glViewport(0, 0, m.boundSwapChain->Width(), m.boundSwapChain->Height()));
+  VRB_GL_CHECK(glClearColor(m.clearColor.Red(), m.clearColor.Green(), m.clearColor.Blue(), m.clearColor.Alpha()));
+  VRB_GL_CHECK(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+
+  for (const auto& layer: m.uiLayers)
+    layer->SetCurrentEye(device::Eye::Left);
+  return true;
+}
+
+void
+DeviceDelegateOpenXR::SetMultiviewEnabled(const bool aEnabled) {
+  if (m.multiviewRequested == aEnabled) {
+    return;
+  }
+  m.multiviewRequested = aEnabled;
+  // Swapchains are recreated between frames, see StartFrame().
+}
+
+bool
+DeviceDelegateOpenXR::IsMultiviewEnabled() const {
+  return m.multiviewEnabled;
+}
+
 bool
 DeviceDelegateOpenXR::IsPassthroughEnabled() const {
     if (m.renderMode == device::RenderMode::StandAlone)
@@ -1178,6 +1469,12 @@ DeviceDelegateOpenXR::EndFrame(const FrameEndMode aEndMode) {
     m.boundSwapChain->ReleaseImage();
     m.boundSwapChain = nullptr;
   }
+  // Eyes that were not drawn this frame still hold the image requested in StartFrame.
+  for (const OpenXRSwapChainPtr& eyeSwapChain: m.eyeSwapChains) {
+    if (eyeSwapChain->HasRequestedImage())
+      eyeSwapChain->ReleaseImage();
+  }
+  m.UpdateSwapChainStats();
 
   const bool frameAhead = m.framePrediction == FramePrediction::ONE_FRAME_AHEAD;
   const XrPosef& predictedPose = frameAhead ? m.prevPredictedPose : m.predictedPose;
@@ -1196,19 +1493,23 @@ DeviceDelegateOpenXR::EndFrame(const FrameEndMode aEndMode) {
   };
 
   // This limit is valid at least for Pico and Meta.
-  auto submitEndFrame = [&layers, displayTime, session = m.session, blendMode = pickEnvironmentBlendMode(m.renderMode), distance = m.furthestHitDistance]() {
+  auto submitEndFrame = [this, &layers, displayTime, session = m.session, blendMode = pickEnvironmentBlendMode(m.renderMode), distance = m.furthestHitDistance]() {
       static int i = 0;
       XrFrameEndInfo frameEndInfo{XR_TYPE_FRAME_END_INFO};
       frameEndInfo.displayTime = displayTime;
       frameEndInfo.environmentBlendMode = blendMode;
       frameEndInfo.layerCount = (uint32_t) layers.size();
       frameEndInfo.layers = layers.data();
+      const auto endFrameStart = std::chrono::steady_clock::now();
       CHECK_XRCMD(xrEndFrame(session, &frameEndInfo));
+      m.UpdateFrameStats(endFrameStart);
   };
 
-  auto canAddLayers = [&layers, maxLayers = m.systemProperties.graphicsProperties.maxLayerCount]() {
-      // Some runtimes incorrectly report 0 as maxLayerCount like Spaces.
-      return layers.size() < std::max(1u, maxLayers);
+  // Some runtimes incorrectly report 0 as maxLayerCount like Spaces.
+  const uint32_t maxLayers = std::max(1u, m.systemProperties.graphicsProperties.maxLayerCount);
+  // One slot is always kept for the projection layer, which holds everything that is not a layer.
+  auto canAddLayers = [&layers, maxLayers]() {
+      return layers.size() + 1 < maxLayers;
   };
 
   if (!mShouldRender) {
@@ -1220,12 +1521,13 @@ DeviceDelegateOpenXR::EndFrame(const FrameEndMode aEndMode) {
   if (shouldUsePassthrough) {
       if (m.passthroughLayer && m.passthroughLayer->IsDrawRequested() && m.IsPassthroughLayerReady()) {
           m.passthroughLayer->Update(m.localSpace, predictedPose, XR_NULL_HANDLE);
-          layers.push_back(reinterpret_cast<XrCompositionLayerBaseHeader*>(&m.passthroughLayer->xrCompositionLayer));
+          if (canAddLayers())
+            layers.push_back(reinterpret_cast<XrCompositionLayerBaseHeader*>(&m.passthroughLayer->xrCompositionLayer));
           m.passthroughLayer->ClearRequestDraw();
       }
   } else if (m.cubeLayer && m.cubeLayer->IsLoaded() && m.cubeLayer->IsDrawRequested()) {
     m.cubeLayer->Update(m.localSpace, predictedPose, XR_NULL_HANDLE);
-    for (uint32_t i = 0; i < m.cubeLayer->HeaderCount(); ++i) {
+    for (uint32_t i = 0; i < m.cubeLayer->HeaderCount() && canAddLayers(); ++i) {
       layers.push_back(m.cubeLayer->Header(i));
     }
     m.cubeLayer->ClearRequestDraw();
@@ -1234,46 +1536,66 @@ DeviceDelegateOpenXR::EndFrame(const FrameEndMode aEndMode) {
   // Add VR video layer
   if (m.equirectLayer && m.equirectLayer->IsDrawRequested()) {
     m.equirectLayer->Update(m.localSpace, predictedPose, XR_NULL_HANDLE);
-    for (uint32_t i = 0; i < m.equirectLayer->HeaderCount(); ++i) {
+    for (uint32_t i = 0; i < m.equirectLayer->HeaderCount() && canAddLayers(); ++i) {
       layers.push_back(m.equirectLayer->Header(i));
     }
     m.equirectLayer->ClearRequestDraw();
   }
 
-  // Sort quad layers by draw priority
-  std::sort(m.uiLayers.begin(), m.uiLayers.end(), [](const OpenXRLayerPtr & a, OpenXRLayerPtr & b) -> bool {
+  // Sort quad layers by draw priority. The order rarely changes between frames, so only sort
+  // when the previous order is no longer valid.
+  auto drawBefore = [](const OpenXRLayerPtr & a, const OpenXRLayerPtr & b) -> bool {
     return a->GetLayer()->ShouldDrawBefore(*b->GetLayer());
-  });
+  };
+  if (!std::is_sorted(m.uiLayers.begin(), m.uiLayers.end(), drawBefore)) {
+    std::sort(m.uiLayers.begin(), m.uiLayers.end(), drawBefore);
+  }
 
-  // Add back UI layers
-  for (const OpenXRLayerPtr& layer: m.uiLayers) {
-    if (!layer->GetDrawInFront() && layer->IsDrawRequested() && canAddLayers()) {
+  // Rank the UI layers so that the ones that matter most get the remaining slots.
+  m.SelectUILayers(maxLayers - 1 - (uint32_t) layers.size());
+  m.layerStats.submittedUILayers = 0;
+  m.layerStats.rebuiltLayers = 0;
+  m.layerStats.reusedLayers = 0;
+
+  // Layers keep the headers built in a previous frame until something they depend on changes.
+  auto addUILayer = [this, &layers, &predictedPose](const OpenXRLayerPtr& layer) {
+    if (layer->IsUpdateNeeded(m.layersSpace, XR_NULL_HANDLE)) {
       layer->Update(m.layersSpace, predictedPose, XR_NULL_HANDLE);
-      for (uint32_t i = 0; i < layer->HeaderCount() && canAddLayers(); ++i) {
-        layers.push_back(layer->Header(i));
+      m.layerStats.rebuiltLayers++;
+    } else {
+      m.layerStats.reusedLayers++;
+    }
+    for (uint32_t i = 0; i < layer->HeaderCount(); ++i) {
+      layers.push_back(layer->Header(i));
+    }
+    m.layerStats.submittedUILayers++;
+  };
+
+  // Add back UI layers
+  for (uint32_t index = 0; index < m.uiLayers.size(); ++index) {
+    const OpenXRLayerPtr& layer = m.uiLayers[index];
+    if (!layer->GetDrawInFront() && layer->IsDrawRequested()) {
+      if (m.selectedUILayers[index]) {
+        addUILayer(layer);
       }
       layer->ClearRequestDraw();
     }
   }
 
-  if (!canAddLayers()) {
-      submitEndFrame();
-      return;
-  }
-
   // Add main eye buffer layer
-  XrCompositionLayerProjection projectionLayer{XR_TYPE_COMPOSITION_LAYER_PROJECTION};
-  std::vector<XrCompositionLayerProjectionView> projectionLayerViews;
+  XrCompositionLayerProjection& projectionLayer = m.projectionLayer;
+  std::vector<XrCompositionLayerProjectionView>& projectionLayerViews = m.projectionLayerViews;
   projectionLayerViews.resize(targetViews.size());
   projectionLayer.layerFlags = XR_COMPOSITION_LAYER_BLEND_TEXTURE_SOURCE_ALPHA_BIT;
   for (int i = 0; i < targetViews.size(); ++i) {
-    const OpenXRSwapChainPtr& viewSwapChain =  m.eyeSwapChains[i];
+    const OpenXRSwapChainPtr& viewSwapChain = m.EyeSwapChain(i);
     projectionLayerViews[i] = {XR_TYPE_COMPOSITION_LAYER_PROJECTION_VIEW};
     projectionLayerViews[i].pose = targetViews[i].pose;
     projectionLayerViews[i].fov = targetViews[i].fov;
     projectionLayerViews[i].subImage.swapchain = viewSwapChain->SwapChain();
     projectionLayerViews[i].subImage.imageRect.offset = {0, 0};
     projectionLayerViews[i].subImage.imageRect.extent = {viewSwapChain->Width(), viewSwapChain->Height()};
+    projectionLayerViews[i].subImage.imageArrayIndex = m.multiviewEnabled ? (uint32_t)i : 0;
   }
   projectionLayer.space = m.localSpace;
   projectionLayer.viewCount = (uint32_t)projectionLayerViews.size();
@@ -1281,23 +1603,43 @@ DeviceDelegateOpenXR::EndFrame(const FrameEndMode aEndMode) {
   layers.push_back(reinterpret_cast<XrCompositionLayerBaseHeader*>(&projectionLayer));
 
   // Add front UI layers
-  for (const OpenXRLayerPtr& layer: m.uiLayers) {
-    if (layer->GetDrawInFront() && layer->IsDrawRequested() && canAddLayers()) {
-      layer->Update(m.layersSpace, predictedPose, XR_NULL_HANDLE);
-      for (uint32_t i = 0; i < layer->HeaderCount() && canAddLayers(); ++i) {
-        layers.push_back(layer->Header(i));
+  for (uint32_t index = 0; index < m.uiLayers.size(); ++index) {
+    const OpenXRLayerPtr& layer = m.uiLayers[index];
+    if (layer->GetDrawInFront() && layer->IsDrawRequested()) {
+      if (m.selectedUILayers[index]) {
+        addUILayer(layer);
       }
       layer->ClearRequestDraw();
     }
   }
 
+  m.layerStats.submittedLayers = (uint32_t) layers.size();
+  m.layerStats.frames++;
+  if (m.layerStats.droppedLayers > 0)
+    m.layerStats.framesWithDroppedLayers++;
+
   submitEndFrame();
 }
 
+DeviceDelegate::LayerStats
+DeviceDelegateOpenXR::GetLayerStats() const {
+  return m.layerStats;
+}
+
+void
+DeviceDelegateOpenXR::SetLateLatchEnabled(const bool aEnabled) {
+  m.lateLatchEnabled = aEnabled;
+}
+
+DeviceDelegate::FrameStats
+DeviceDelegateOpenXR::GetFrameStats() const {
+  return m.frameStats;
+}
+
 VRLayerQuadPtr
 DeviceDelegateOpenXR::CreateLayerQuad(int32_t aWidth, int32_t aHeight,
                                         VRLayerSurface::SurfaceType aSurfaceType) {
-  if (!m.layersEnabled) {
+  if (!m.CanCreateUILayer()) {
     return nullptr;
   }
 
@@ -1332,7 +1674,7 @@ DeviceDelegateOpenXR::CreateLayerQuad(const VRLayerSurfacePtr& aMoveLayer) {
 VRLayerCylinderPtr
 DeviceDelegateOpenXR::CreateLayerCylinder(int32_t aWidth, int32_t aHeight,
                                             VRLayerSurface::SurfaceType aSurfaceType) {
-  if (!m.layersEnabled) {
+  if (!m.CanCreateUILayer()) {
     return nullptr;
   }
 
@@ -48,6 +48,7 @@ public:
   bool SupportsFramePrediction(FramePrediction aPrediction) const override;
   void StartFrame(const FramePrediction aPrediction) override;
   void BindEye(const device::Eye aWhich) override;
+  bool BindStereo() override;
   void EndFrame(const FrameEndMode aMode) override;
   VRLayerQuadPtr CreateLayerQuad(int32_t aWidth, int32_t aHeight,
                                  VRLayerSurface::SurfaceType aSurfaceType) override;
@@ -74,6 +75,15 @@ public:
   bool ExitApp();
   bool ShouldExitRenderLoop() const;
   void SetImmersiveBlendMode(device::BlendMode) override;
+  // Renders both eyes to a single texture array swapchain when OVR_multiview is available.
+  // Enabled by default; the change is applied at the start of the next frame.
+  void SetMultiviewEnabled(const bool aEnabled) override;
+  bool IsMultiviewEnabled() const;
+  LayerStats GetLayerStats() const override;
+  // Re-locates the head and eye views right before the first eye is drawn in browsing mode.
+  // Enabled by default.
+  void SetLateLatchEnabled(const bool aEnabled) override;
+  FrameStats GetFrameStats() const override;
 
 protected:
   struct State;
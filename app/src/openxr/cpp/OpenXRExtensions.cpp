@@ -21,6 +21,7 @@ PFN_xrCreatePassthroughLayerFB OpenXRExtensions::sXrCreatePassthroughLayerFB = n
 PFN_xrDestroyPassthroughLayerFB OpenXRExtensions::sXrDestroyPassthroughLayerFB = nullptr;
 PFN_xrCreateHandMeshSpaceMSFT OpenXRExtensions::sXrCreateHandMeshSpaceMSFT = nullptr;
 PFN_xrUpdateHandMeshMSFT OpenXRExtensions::sXrUpdateHandMeshMSFT = nullptr;
+PFN_xrConvertTimespecTimeToTimeKHR OpenXRExtensions::sXrConvertTimespecTimeToTimeKHR = nullptr;
 
 void OpenXRExtensions::Initialize() {
     // Extensions.
@@ -108,6 +109,11 @@ void OpenXRExtensions::LoadExtensions(XrInstance instance) {
         CHECK_XRCMD(xrGetInstanceProcAddr(instance, "xrDestroyPassthroughLayerFB",
                                           reinterpret_cast<PFN_xrVoidFunction *>(&sXrDestroyPassthroughLayerFB)));
     }
+
+    if (IsExtensionSupported(XR_KHR_CONVERT_TIMESPEC_TIME_EXTENSION_NAME)) {
+        CHECK_XRCMD(xrGetInstanceProcAddr(instance, "xrConvertTimespecTimeToTimeKHR",
+                                          reinterpret_cast<PFN_xrVoidFunction *>(&sXrConvertTimespecTimeToTimeKHR)));
+    }
 }
 
 void OpenXRExtensions::LoadApiLayers(XrInstance instance) {
@@ -2,6 +2,7 @@
 
 #include <EGL/egl.h>
 #include <jni.h>
+#include <time.h>
 #include <openxr/openxr.h>
 #include <openxr/openxr_platform.h>
 #include <vector>
@@ -36,6 +37,8 @@ namespace crow {
 
     static PFN_xrCreateHandMeshSpaceMSFT sXrCreateHandMeshSpaceMSFT;
     static PFN_xrUpdateHandMeshMSFT sXrUpdateHandMeshMSFT;
+
+    static PFN_xrConvertTimespecTimeToTimeKHR sXrConvertTimespecTimeToTimeKHR;
   private:
      static std::unordered_set<std::string> sSupportedExtensions;
      static std::unordered_set<std::string> sSupportedApiLayers;
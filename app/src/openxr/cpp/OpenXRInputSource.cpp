@@ -1,7 +1,7 @@
 #include "OpenXRInputSource.h"
 #include "OpenXRExtensions.h"
 #include <assert.h>
-#include <unordered_set>
+#include <algorithm>
 #include "DeviceUtils.h"
 #include "SystemUtils.h"
 
@@ -245,27 +245,21 @@ XrResult OpenXRInputSource::stopHapticFeedback(XrAction action) const
     return XR_SUCCESS;
 }
 
-std::optional<OpenXRInputSource::OpenXRButtonState> OpenXRInputSource::GetButtonState(const OpenXRButton& button) const
+bool OpenXRInputSource::GetButtonState(const InputPlanButton& button, OpenXRButtonState& result) const
 {
-    auto it = mButtonActions.find(button.type);
-    if (it == mButtonActions.end())
-        return std::nullopt;
-
-    OpenXRButtonState result;
     bool hasValue = false;
-    auto& actions = it->second;
 
-    auto queryActionState = [this, &hasValue](bool enabled, XrAction action, auto& value, auto defaultValue) {
-        if (enabled && action != XR_NULL_HANDLE && XR_SUCCEEDED(this->GetActionState(action, &value)))
+    auto queryActionState = [this, &hasValue](XrAction action, auto& value, auto defaultValue) {
+        if (action != XR_NULL_HANDLE && XR_SUCCEEDED(this->GetActionState(action, &value)))
             hasValue = true;
         else
             value = defaultValue;
     };
 
-    queryActionState(button.flags & OpenXRButtonFlags::Click, actions.click, result.clicked, false);
+    queryActionState(button.click, result.clicked, false);
     bool clickedHasValue = hasValue;
-    queryActionState(button.flags & OpenXRButtonFlags::Touch, actions.touch, result.touched, result.clicked);
-    queryActionState(button.flags & OpenXRButtonFlags::Value, actions.value, result.value, result.clicked ? 1.0 : 0.0);
+    queryActionState(button.touch, result.touched, result.clicked);
+    queryActionState(button.value, result.value, result.clicked ? 1.0 : 0.0);
 
     if (!clickedHasValue && result.value > kClickThreshold) {
       result.clicked = true;
@@ -275,18 +269,13 @@ std::optional<OpenXRInputSource::OpenXRButtonState> OpenXRInputSource::GetButton
       VRB_DEBUG("OpenXR button clicked: %s", OpenXRButtonTypeNames->at((int) button.type));
     }
 
-    return hasValue ? std::make_optional(result) : std::nullopt;
+    return hasValue;
 }
 
-std::optional<XrVector2f> OpenXRInputSource::GetAxis(OpenXRAxisType axisType) const
+bool OpenXRInputSource::GetAxis(const InputPlanAxis& axisPlan, XrVector2f& axis) const
 {
-    auto it = mAxisActions.find(axisType);
-    if (it == mAxisActions.end())
-        return std::nullopt;
-
-    XrVector2f axis;
-    if (XR_FAILED(GetActionState(it->second, &axis)))
-        return std::nullopt;
+    if (axisPlan.action == XR_NULL_HANDLE || XR_FAILED(GetActionState(axisPlan.action, &axis)))
+        return false;
 
 #if HVR
     // Workaround for HVR controller precision issues
@@ -299,7 +288,7 @@ std::optional<XrVector2f> OpenXRInputSource::GetAxis(OpenXRAxisType axisType) co
         axis.y = -axis.y;
 #endif
 
-    return axis;
+    return true;
 }
 
 XrResult OpenXRInputSource::GetActionState(XrAction action, bool* value) const
@@ -587,6 +576,11 @@ bool OpenXRInputSource::GetHandTrackingInfo(XrTime predictedDisplayTime, XrSpace
         };
         CHECK_XRCMD(OpenXRExtensions::sXrUpdateHandMeshMSFT(mHandTracker, &updateInfo,
                                                             &mHandMeshMSFT.handMesh));
+        buffer->indexCount = mHandMeshMSFT.handMesh.indexBuffer.indexCountOutput;
+        buffer->vertexCount = mHandMeshMSFT.handMesh.vertexBuffer.vertexCountOutput;
+        buffer->indexBufferKey = mHandMeshMSFT.handMesh.indexBuffer.indexBufferKey;
+        buffer->indicesChanged = mHandMeshMSFT.handMesh.indexBufferChanged;
+        buffer->verticesChanged = mHandMeshMSFT.handMesh.vertexBufferChanged;
         mHandMeshMSFT.buffer = genericBuffer;
 
         // Finally add the current buffer to the list of used ones
@@ -826,37 +820,36 @@ void OpenXRInputSource::Update(const XrFrameState& frameState, XrSpace localSpac
     delegate.SetCapabilityFlags(mIndex, flags);
 
     // Buttons.
-    int buttonCount { 0 };
+    mInputState.Reset();
     bool trackpadClicked { false };
     bool trackpadTouched { false };
 
     // https://www.w3.org/TR/webxr-gamepads-module-1/
-    std::unordered_set<OpenXRButtonType> placeholders = {
-        OpenXRButtonType::Squeeze, OpenXRButtonType::Trackpad, OpenXRButtonType::Thumbstick
-    };
+    uint32_t placeholders = (1u << (int) OpenXRButtonType::Squeeze) | (1u << (int) OpenXRButtonType::Trackpad) |
+                            (1u << (int) OpenXRButtonType::Thumbstick);
 
-    for (auto& button: mActiveMapping->buttons) {
-        if ((button.hand & mHandeness) == 0) {
-            continue;
-        }
-        auto state = GetButtonState(button);
-        if (!state.has_value()) {
+    for (uint32_t i = 0; i < mInputPlan.buttonCount; ++i) {
+        const InputPlanButton& button = mInputPlan.buttons[i];
+        OpenXRButtonState state;
+        if (!GetButtonState(button, state)) {
             VRB_ERROR("Cant read button type with path '%s'", button.path);
             continue;
         }
 
-        placeholders.erase(button.type);
-        buttonCount++;
-        auto browserButton = GetBrowserButton(button);
-        auto immersiveButton = GetImmersiveButton(button);
-        delegate.SetButtonState(mIndex, browserButton, immersiveButton.has_value() ? immersiveButton.value() : -1, state->clicked, state->touched, state->value);
+        placeholders &= ~(1u << (int) button.type);
+        mInputState.buttonCount++;
+        mInputState.buttons[mInputState.buttonStateCount++] = {
+            button.browserButton, button.immersiveButton, state.clicked, state.touched, state.value
+        };
 
-        if (button.type == OpenXRButtonType::Trigger)
-            delegate.SetSelectFactor(mIndex, state->value);
+        if (button.type == OpenXRButtonType::Trigger) {
+            mInputState.hasSelectFactor = true;
+            mInputState.selectFactor = state.value;
+        }
 
         // Select action
-        if (renderMode == device::RenderMode::Immersive && button.type == OpenXRButtonType::Trigger && state->clicked != selectActionStarted) {
-          selectActionStarted = state->clicked;
+        if (renderMode == device::RenderMode::Immersive && button.type == OpenXRButtonType::Trigger && state.clicked != selectActionStarted) {
+          selectActionStarted = state.clicked;
           if (selectActionStarted) {
             delegate.SetSelectActionStart(mIndex);
           } else {
@@ -865,8 +858,8 @@ void OpenXRInputSource::Update(const XrFrameState& frameState, XrSpace localSpac
         }
 
         // Squeeze action
-        if (renderMode == device::RenderMode::Immersive && button.type == OpenXRButtonType::Squeeze && state->clicked != squeezeActionStarted) {
-          squeezeActionStarted = state->clicked;
+        if (renderMode == device::RenderMode::Immersive && button.type == OpenXRButtonType::Squeeze && state.clicked != squeezeActionStarted) {
+          squeezeActionStarted = state.clicked;
           if (squeezeActionStarted) {
             delegate.SetSqueezeActionStart(mIndex);
           } else {
@@ -876,48 +869,46 @@ void OpenXRInputSource::Update(const XrFrameState& frameState, XrSpace localSpac
 
         // Trackpad
         if (button.type == OpenXRButtonType::Trackpad) {
-          trackpadClicked = state->clicked;
-          trackpadTouched = state->touched;
+          trackpadClicked = state.clicked;
+          trackpadTouched = state.touched;
         }
     }
 
-    buttonCount += placeholders.size();
-    delegate.SetButtonCount(mIndex, buttonCount);
+    mInputState.buttonCount += __builtin_popcount(placeholders);
 
     // Axes
     // https://www.w3.org/TR/webxr-gamepads-module-1/#xr-standard-gamepad-mapping
-    axesContainer = { 0.0f, 0.0f, 0.0f, 0.0f };
-
-    for (auto& axis: mActiveMapping->axes) {
-      if ((axis.hand & mHandeness) == 0) {
-        continue;
-      }
-
-      auto state = GetAxis(axis.type);
-      if (!state.has_value()) {
+    float* axes = mInputState.axes;
+    axes[0] = axes[1] = axes[2] = axes[3] = 0.0f;
+    mInputState.axisCount = 4;
+
+    for (uint32_t i = 0; i < mInputPlan.axisCount; ++i) {
+      const InputPlanAxis& axis = mInputPlan.axes[i];
+      XrVector2f state;
+      if (!GetAxis(axis, state)) {
         VRB_ERROR("Cant read axis type with path '%s'", axis.path);
         continue;
       }
 
       if (axis.type == OpenXRAxisType::Trackpad) {
-        axesContainer[device::kImmersiveAxisTouchpadX] = state->x;
-        axesContainer[device::kImmersiveAxisTouchpadY] = -state->y;
-        if (trackpadTouched && !trackpadClicked) {
-          delegate.SetTouchPosition(mIndex, state->x, state->y);
-        } else {
-          delegate.SetTouchPosition(mIndex, state->x, state->y);
-          delegate.EndTouch(mIndex);
-        }
+        axes[device::kImmersiveAxisTouchpadX] = state.x;
+        axes[device::kImmersiveAxisTouchpadY] = -state.y;
+        mInputState.hasTouch = true;
+        mInputState.touchEnded = !trackpadTouched || trackpadClicked;
+        mInputState.touchX = state.x;
+        mInputState.touchY = state.y;
       } else if (axis.type == OpenXRAxisType::Thumbstick) {
-        axesContainer[device::kImmersiveAxisThumbstickX] = state->x;
-        axesContainer[device::kImmersiveAxisThumbstickY] = -state->y;
-        delegate.SetScrolledDelta(mIndex, state->x, state->y);
-      } else {
-        axesContainer.push_back(state->x);
-        axesContainer.push_back(-state->y);
+        axes[device::kImmersiveAxisThumbstickX] = state.x;
+        axes[device::kImmersiveAxisThumbstickY] = -state.y;
+        mInputState.hasScroll = true;
+        mInputState.scrollDeltaX = state.x;
+        mInputState.scrollDeltaY = state.y;
+      } else if (mInputState.axisCount + 2 <= ControllerInputState::kMaxAxes) {
+        axes[mInputState.axisCount++] = state.x;
+        axes[mInputState.axisCount++] = -state.y;
       }
     }
-    delegate.SetAxes(mIndex, axesContainer.data(), axesContainer.size());
+    delegate.SetInputState(mIndex, mInputState);
 
     UpdateHaptics(delegate);
 }
@@ -956,6 +947,8 @@ XrResult OpenXRInputSource::UpdateInteractionProfile(ControllerDelegate& delegat
         }
     }
 
+    BuildInputPlan();
+
     if (mActiveMapping != nullptr) {
         // Add haptic devices to controller, if any
         uint32_t numHaptics = 0;
@@ -982,6 +975,55 @@ XrResult OpenXRInputSource::UpdateInteractionProfile(ControllerDelegate& delegat
     return XR_SUCCESS;
 }
 
+void OpenXRInputSource::BuildInputPlan()
+{
+    mInputPlan.buttonCount = 0;
+    mInputPlan.axisCount = 0;
+    if (!mActiveMapping)
+        return;
+
+    for (auto& button: mActiveMapping->buttons) {
+        if ((button.hand & mHandeness) == 0)
+            continue;
+        if (mInputPlan.buttonCount == mInputPlan.buttons.size()) {
+            VRB_ERROR("Too many buttons in mapping '%s'", mActiveMapping->path);
+            break;
+        }
+        InputPlanButton& entry = mInputPlan.buttons[mInputPlan.buttonCount++];
+        entry = InputPlanButton();
+        entry.type = button.type;
+        entry.path = button.path;
+        auto it = mButtonActions.find(button.type);
+        if (it != mButtonActions.end()) {
+            if (button.flags & OpenXRButtonFlags::Click)
+                entry.click = it->second.click;
+            if (button.flags & OpenXRButtonFlags::Touch)
+                entry.touch = it->second.touch;
+            if (button.flags & OpenXRButtonFlags::Value)
+                entry.value = it->second.value;
+        }
+        entry.browserButton = GetBrowserButton(button);
+        auto immersiveButton = GetImmersiveButton(button);
+        entry.immersiveButton = immersiveButton.has_value() ? immersiveButton.value() : -1;
+    }
+
+    for (auto& axis: mActiveMapping->axes) {
+        if ((axis.hand & mHandeness) == 0)
+            continue;
+        if (mInputPlan.axisCount == mInputPlan.axes.size()) {
+            VRB_ERROR("Too many axes in mapping '%s'", mActiveMapping->path);
+            break;
+        }
+        InputPlanAxis& entry = mInputPlan.axes[mInputPlan.axisCount++];
+        entry = InputPlanAxis();
+        entry.type = axis.type;
+        entry.path = axis.path;
+        auto it = mAxisActions.find(axis.type);
+        if (it != mAxisActions.end())
+            entry.action = it->second;
+    }
+}
+
 std::string OpenXRInputSource::ControllerModelName() const
 {
   if (mActiveMapping) {
@@ -7,6 +7,7 @@
 #include "ElbowModel.h"
 #include "HandMeshRenderer.h"
 #include "OpenXRGestureManager.h"
+#include <array>
 #include <optional>
 #include <unordered_map>
 
@@ -32,8 +33,32 @@ private:
       bool touched { false };
       float value { 0 };
     };
-    std::optional<OpenXRButtonState> GetButtonState(const OpenXRButton&) const;
-    std::optional<XrVector2f> GetAxis(OpenXRAxisType) const;
+    // Precompiled from the active mapping by UpdateInteractionProfile(), so that Update() reads the
+    // input without looking up actions or allocating.
+    struct InputPlanButton {
+        OpenXRButtonType type;
+        const char* path;
+        // Only the actions enabled by the flags of the mapping are set.
+        XrAction click { XR_NULL_HANDLE };
+        XrAction touch { XR_NULL_HANDLE };
+        XrAction value { XR_NULL_HANDLE };
+        ControllerDelegate::Button browserButton;
+        int32_t immersiveButton;
+    };
+    struct InputPlanAxis {
+        OpenXRAxisType type;
+        const char* path;
+        XrAction action { XR_NULL_HANDLE };
+    };
+    struct InputPlan {
+        std::array<InputPlanButton, ControllerInputState::kMaxButtons> buttons;
+        uint32_t buttonCount { 0 };
+        std::array<InputPlanAxis, ControllerInputState::kMaxAxes> axes;
+        uint32_t axisCount { 0 };
+    };
+    void BuildInputPlan();
+    bool GetButtonState(const InputPlanButton&, OpenXRButtonState&) const;
+    bool GetAxis(const InputPlanAxis&, XrVector2f&) const;
     XrResult GetActionState(XrAction, bool*) const;
     XrResult GetActionState(XrAction, float*) const;
     XrResult GetActionState(XrAction, XrVector2f*) const;
@@ -66,7 +91,8 @@ private:
     OpenXRInputMapping* mActiveMapping { XR_NULL_HANDLE };
     bool selectActionStarted { false };
     bool squeezeActionStarted { false };
-    std::vector<float> axesContainer;
+    InputPlan mInputPlan;
+    ControllerInputState mInputState;
     crow::ElbowModelPtr elbow;
     XrHandTrackerEXT mHandTracker { XR_NULL_HANDLE };
     HandJointsArray mHandJoints;
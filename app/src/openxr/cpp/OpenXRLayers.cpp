@@ -204,6 +204,14 @@ OpenXRLayerEquirect::IsDrawRequested() const {
   return source && source->GetSwapChain() && source->IsComposited() && layer->IsDrawRequested();
 }
 
+XrSwapchain
+OpenXRLayerEquirect::CurrentSwapChain() const {
+  // The video surface belongs to the source layer and may be replaced when it is resized.
+  OpenXRLayerPtr source = sourceLayer.lock();
+  OpenXRSwapChainPtr current = source ? source->GetSwapChain() : swapchain;
+  return current ? current->SwapChain() : XR_NULL_HANDLE;
+}
+
 void
 OpenXRLayerEquirect::Update(XrSpace aSpace, const XrPosef &aPose, XrSwapchain aClearSwapChain) {
   OpenXRLayerPtr source = sourceLayer.lock();
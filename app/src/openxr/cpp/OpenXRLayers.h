@@ -38,6 +38,8 @@ class OpenXRLayer {
 public:
   virtual void Init(JNIEnv *aEnv, XrSession session, vrb::RenderContextPtr &aContext) = 0;
   virtual void Update(XrSpace aSpace, const XrPosef &aPose, XrSwapchain aClearSwapChain) = 0;
+  // Returns false when the composition layer headers built by the last Update are still valid.
+  virtual bool IsUpdateNeeded(XrSpace aSpace, XrSwapchain aClearSwapChain) const = 0;
   virtual OpenXRSwapChainPtr GetSwapChain() const = 0;
   virtual uint32_t HeaderCount() const = 0;
   virtual const XrCompositionLayerBaseHeader* Header(uint32_t aIndex) const = 0;
@@ -67,6 +69,11 @@ public:
   SurfaceChangedTargetPtr surfaceChangedTarget;
   T layer;
   std::array<U, 2> xrLayers;
+  bool updated = false;
+  uint32_t updatedRevision = 0;
+  XrSpace updatedSpace = XR_NULL_HANDLE;
+  XrSwapchain updatedClearSwapChain = XR_NULL_HANDLE;
+  XrSwapchain updatedSwapChain = XR_NULL_HANDLE;
 
   void Init(JNIEnv *aEnv, XrSession session, vrb::RenderContextPtr &aContext) override {
     layer->SetInitialized(true);
@@ -104,6 +111,17 @@ public:
       if (mCompositionLayerColorScaleBias != XR_NULL_HANDLE)
         PushNextXrStructureInChain((XrBaseInStructure&)*xrLayer, (XrBaseInStructure&)*mCompositionLayerColorScaleBias);
     }
+
+    updated = true;
+    updatedRevision = layer->GetRevision();
+    updatedSpace = aSpace;
+    updatedClearSwapChain = aClearSwapChain;
+    updatedSwapChain = CurrentSwapChain();
+  }
+
+  bool IsUpdateNeeded(XrSpace aSpace, XrSwapchain aClearSwapChain) const override {
+    return !updated || updatedRevision != layer->GetRevision() || updatedSpace != aSpace ||
+           updatedClearSwapChain != aClearSwapChain || updatedSwapChain != CurrentSwapChain();
   }
 
   virtual OpenXRSwapChainPtr GetSwapChain() const override {
@@ -161,6 +179,7 @@ public:
 
   void Destroy() override {
     swapchain = nullptr;
+    updated = false;
     layer->SetInitialized(false);
     SetComposited(false);
     layer->NotifySurfaceChanged(VRLayer::SurfaceChange::Destroy, nullptr);
@@ -218,6 +237,10 @@ protected:
     return info;
   }
 
+  virtual XrSwapchain CurrentSwapChain() const {
+    return swapchain ? swapchain->SwapChain() : XR_NULL_HANDLE;
+  }
+
   uint GetNumXRLayers() const {
     return layer->GetUseSameLayerForBothEyes() ? 1 : xrLayers.size();
   }
@@ -412,6 +435,9 @@ public:
   void Update(XrSpace aSpace, const XrPosef &aPose, XrSwapchain aClearSwapChain) override;
   void Destroy() override;
   bool IsDrawRequested() const override;
+
+protected:
+  XrSwapchain CurrentSwapChain() const override;
 };
 
 
@@ -1,12 +1,80 @@
 #include "OpenXRSwapChain.h"
 #include "OpenXRHelpers.h"
 #include "OpenXRExtensions.h"
+#include "DeviceUtils.h"
 #include "vrb/FBO.h"
 #include "vrb/GLError.h"
 #include "vrb/Logger.h"
 
+#include <algorithm>
+#include <chrono>
+
 namespace crow {
 
+namespace {
+
+typedef void (*FramebufferTextureMultiviewProc)(GLenum aTarget, GLenum aAttachment, GLuint aTexture,
+                                                GLint aLevel, GLint aBaseViewIndex, GLsizei aNumViews);
+typedef void (*FramebufferTextureMultisampleMultiviewProc)(GLenum aTarget, GLenum aAttachment, GLuint aTexture,
+                                                           GLint aLevel, GLsizei aSamples,
+                                                           GLint aBaseViewIndex, GLsizei aNumViews);
+
+// Attaches a range of layers of a texture array. Multisampled attachments are resolved implicitly
+// by OVR_multiview_multisampled_render_to_texture, so no extra resolve pass is needed. Without it
+// the attachment fails rather than losing MSAA, and the caller falls back to one swapchain per eye.
+bool
+AttachLayers(GLenum aAttachment, GLuint aTexture, GLsizei aSamples, GLint aBaseLayer, GLsizei aLayerCount) {
+  static FramebufferTextureMultiviewProc sMultiview = nullptr;
+  static FramebufferTextureMultisampleMultiviewProc sMultisampleMultiview = nullptr;
+  static bool sInitialized = false;
+  if (!sInitialized) {
+    sInitialized = true;
+    if (DeviceUtils::HasGLExtension("GL_OVR_multiview")) {
+      sMultiview = (FramebufferTextureMultiviewProc)eglGetProcAddress("glFramebufferTextureMultiviewOVR");
+    }
+    if (DeviceUtils::HasGLExtension("GL_OVR_multiview_multisampled_render_to_texture")) {
+      sMultisampleMultiview = (FramebufferTextureMultisampleMultiviewProc)eglGetProcAddress("glFramebufferTextureMultisampleMultiviewOVR");
+    }
+  }
+  if (aSamples > 1) {
+    if (!sMultisampleMultiview) {
+      return false;
+    }
+    VRB_GL_CHECK(sMultisampleMultiview(GL_DRAW_FRAMEBUFFER, aAttachment, aTexture, 0, aSamples, aBaseLayer, aLayerCount));
+    return true;
+  }
+  if (aLayerCount > 1) {
+    if (!sMultiview) {
+      return false;
+    }
+    VRB_GL_CHECK(sMultiview(GL_DRAW_FRAMEBUFFER, aAttachment, aTexture, 0, aBaseLayer, aLayerCount));
+    return true;
+  }
+  VRB_GL_CHECK(glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, aAttachment, aTexture, 0, aBaseLayer));
+  return true;
+}
+
+GLuint
+CreateArrayFramebuffer(GLuint aColor, GLuint aDepth, GLsizei aSamples, GLint aBaseLayer, GLsizei aLayerCount) {
+  GLuint result = 0;
+  VRB_GL_CHECK(glGenFramebuffers(1, &result));
+  VRB_GL_CHECK(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, result));
+  bool attached = AttachLayers(GL_COLOR_ATTACHMENT0, aColor, aSamples, aBaseLayer, aLayerCount);
+  if (attached && aDepth) {
+    attached = AttachLayers(GL_DEPTH_ATTACHMENT, aDepth, aSamples, aBaseLayer, aLayerCount);
+  }
+  const GLenum status = attached ? glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) : GL_FRAMEBUFFER_UNSUPPORTED;
+  VRB_GL_CHECK(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0));
+  if (status != GL_FRAMEBUFFER_COMPLETE) {
+    VRB_WARN("OpenXR texture array framebuffer incomplete (layers %d+%d): 0x%x", aBaseLayer, aLayerCount, status);
+    VRB_GL_CHECK(glDeleteFramebuffers(1, &result));
+    return 0;
+  }
+  return result;
+}
+
+} // namespace
+
 OpenXRSwapChainPtr
 OpenXRSwapChain::create() {
   return std::make_shared<OpenXRSwapChain>();
@@ -35,6 +103,47 @@ OpenXRSwapChain::InitFBO(vrb::RenderContextPtr &aContext, XrSession aSession, co
     images.push_back(reinterpret_cast<XrSwapchainImageBaseHeader*>(&image));
   }
   CHECK_XRCMD(xrEnumerateSwapchainImages(swapchain, imageCount, &imageCount, images[0]));
+
+  if (info.arraySize > 1) {
+    InitArrayFramebuffers();
+    return;
+  }
+  // Create every FBO up front so that no frame pays for the framebuffer setup.
+  for (uint32_t i = 0; i < imageCount; ++i) {
+    CreateImageFBO(i);
+  }
+}
+
+void
+OpenXRSwapChain::InitArrayFramebuffers() {
+  const GLsizei samples = attributes.samples > 1 ? attributes.samples : 0;
+  if (attributes.depth) {
+    VRB_GL_CHECK(glGenTextures(1, &depthArray));
+    VRB_GL_CHECK(glBindTexture(GL_TEXTURE_2D_ARRAY, depthArray));
+    VRB_GL_CHECK(glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_DEPTH_COMPONENT24, info.width, info.height, info.arraySize));
+    VRB_GL_CHECK(glBindTexture(GL_TEXTURE_2D_ARRAY, 0));
+  }
+
+  multiviewComplete = true;
+  layerFramebuffers.resize(imageBuffer.size() * info.arraySize, 0);
+  multiviewFramebuffers.resize(imageBuffer.size(), 0);
+  for (size_t image = 0; image < imageBuffer.size(); ++image) {
+    const GLuint texture = imageBuffer[image].image;
+    VRB_GL_CHECK(glBindTexture(GL_TEXTURE_2D_ARRAY, texture));
+    VRB_GL_CHECK(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    VRB_GL_CHECK(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    VRB_GL_CHECK(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+    VRB_GL_CHECK(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    VRB_GL_CHECK(glBindTexture(GL_TEXTURE_2D_ARRAY, 0));
+    for (uint32_t layer = 0; layer < info.arraySize; ++layer) {
+      const GLuint framebuffer = CreateArrayFramebuffer(texture, depthArray, samples, layer, 1);
+      layerFramebuffers[image * info.arraySize + layer] = framebuffer;
+      multiviewComplete = multiviewComplete && framebuffer != 0;
+    }
+    multiviewFramebuffers[image] = CreateArrayFramebuffer(texture, depthArray, samples, 0, info.arraySize);
+    multiviewComplete = multiviewComplete && multiviewFramebuffers[image] != 0;
+  }
+  VRB_DEBUG("OpenXR texture array swapchain with %d layers, multiview %s", info.arraySize, multiviewComplete ? "complete" : "incomplete");
 }
 
 void
@@ -95,67 +204,160 @@ void OpenXRSwapChain::InitCubemap(vrb::RenderContextPtr &aContext, XrSession aSe
 }
 
 void
-OpenXRSwapChain::AcquireImage() {
-  CHECK_MSG(!surface, "AcquireImage must not be called for Android Surfaces");
-  CHECK_MSG(!acquiredFBO, "Expected no acquired FBOs. ReleaseImage not called?");
-  CHECK_MSG(!cubeTexture, "AcquireImage must not be called for cubemap textures");
+OpenXRSwapChain::CreateImageFBO(const uint32_t aIndex) {
+  vrb::FBOPtr fbo = vrb::FBO::Create(context);
+  fbos[aIndex] = fbo;
+  uint32_t texture = imageBuffer[aIndex].image;
+  VRB_GL_CHECK(glBindTexture(GL_TEXTURE_2D, texture));
+  VRB_GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+  VRB_GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+  VRB_GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+  VRB_GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+
+  VRB_GL_CHECK(fbo->SetTextureHandle(texture, info.width, info.height, attributes));
+  if (!fbo->IsValid()) {
+    VRB_ERROR("OpenXR XrSwapchainImageOpenGLESKHR texture FBO is not valid");
+  } else{
+    VRB_DEBUG("OpenXR succesfully created FBO for swapChainImageIndex: %d", aIndex);
+  }
+}
+
+void
+OpenXRSwapChain::RequestImage() {
+  CHECK_MSG(!surface, "RequestImage must not be called for Android Surfaces");
+  CHECK_MSG(acquiredImage < 0, "Expected no acquired FBOs. ReleaseImage not called?");
+  CHECK_MSG(!cubeTexture, "RequestImage must not be called for cubemap textures");
 
+  const auto start = std::chrono::steady_clock::now();
   XrSwapchainImageAcquireInfo acquireInfo{XR_TYPE_SWAPCHAIN_IMAGE_ACQUIRE_INFO};
   uint32_t swapchainImageIndex = 0;
   CHECK_XRCMD(xrAcquireSwapchainImage(swapchain, &acquireInfo, &swapchainImageIndex));
   CHECK(swapchainImageIndex < imageBuffer.size());
   CHECK(swapchainImageIndex < fbos.size());
+  acquiredImage = (int32_t)swapchainImageIndex;
+  imageReady = false;
+
+  const uint64_t elapsed = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start).count();
+  stats.acquires++;
+  stats.acquireMicroseconds += elapsed;
+  stats.maxAcquireMicroseconds = std::max(stats.maxAcquireMicroseconds, elapsed);
+}
+
+void
+OpenXRSwapChain::WaitImage() {
+  CHECK_MSG(acquiredImage >= 0, "Expected a requested image. RequestImage not called?");
+  if (imageReady) {
+    return;
+  }
 
+  const auto start = std::chrono::steady_clock::now();
   XrSwapchainImageWaitInfo waitInfo{XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO};
   waitInfo.timeout = XR_INFINITE_DURATION;
   CHECK_XRCMD(xrWaitSwapchainImage(swapchain, &waitInfo));
+  imageReady = true;
 
-  if (!fbos[swapchainImageIndex]) {
-    vrb::FBOPtr fbo = vrb::FBO::Create(context);
-    fbos[swapchainImageIndex] = fbo;
-    uint32_t texture = imageBuffer[swapchainImageIndex].image;
-    VRB_GL_CHECK(glBindTexture(GL_TEXTURE_2D, texture));
-    VRB_GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
-    VRB_GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
-    VRB_GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
-    VRB_GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
-
-    VRB_GL_CHECK(fbo->SetTextureHandle(texture, info.width, info.height, attributes));
-    if (!fbo->IsValid()) {
-      VRB_ERROR("OpenXR XrSwapchainImageOpenGLESKHR texture FBO is not valid");
-    } else{
-      VRB_DEBUG("OpenXR succesfully created FBO for swapChainImageIndex: %d", swapchainImageIndex);
-    }
+  const uint64_t elapsed = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start).count();
+  stats.waits++;
+  stats.waitMicroseconds += elapsed;
+  stats.maxWaitMicroseconds = std::max(stats.maxWaitMicroseconds, elapsed);
+
+  if (info.arraySize > 1) {
+    return;
   }
+  // FBOs are created in InitFBO, this only happens if the runtime returned more images later.
+  if (!fbos[acquiredImage]) {
+    CreateImageFBO((uint32_t)acquiredImage);
+  }
+  acquiredFBO = fbos[acquiredImage];
+}
 
-  acquiredFBO = fbos[swapchainImageIndex];
+void
+OpenXRSwapChain::AcquireImage() {
+  CHECK_MSG(!imageReady, "Expected no acquired FBOs. ReleaseImage not called?");
+  if (acquiredImage < 0) {
+    RequestImage();
+  }
+  WaitImage();
 }
 
 void
 OpenXRSwapChain::ReleaseImage() {
   CHECK_MSG(!surface, "ReleaseImage must not be called for Android Surfaces");
-  CHECK_MSG(acquiredFBO, "Expected a valid acquired FBO. AcquireImage not called?");
+  CHECK_MSG(acquiredImage >= 0, "Expected a valid acquired FBO. AcquireImage not called?");
   CHECK_MSG(!cubeTexture, "ReleaseImage must not be called for cubemap textures");
 
+  // The runtime requires every acquired image to be waited on before it is released.
+  WaitImage();
   XrSwapchainImageReleaseInfo releaseInfo{XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO};
   CHECK_XRCMD(xrReleaseSwapchainImage(swapchain, &releaseInfo));
   acquiredFBO = nullptr;
+  acquiredImage = -1;
+  imageReady = false;
 }
 
 void
 OpenXRSwapChain::BindFBO(GLenum target) {
   CHECK_MSG(!surface, "BindFBO must not be called for Android Surfaces");
-  CHECK_MSG(acquiredFBO, "Expected a valid acquired FBO. AcquireImage not called?");
+  CHECK_MSG(imageReady, "Expected a valid acquired FBO. AcquireImage not called?");
   CHECK_MSG(!cubeTexture, "BindFBO must not be called for cubemap textures");
+  if (info.arraySize > 1) {
+    BindFBOLayer(boundLayer, target);
+    return;
+  }
   acquiredFBO->Bind(target);
 }
 
+const OpenXRSwapChain::ImageStats&
+OpenXRSwapChain::GetImageStats() const {
+  return stats;
+}
+
+void
+OpenXRSwapChain::ResetImageStats() {
+  stats = ImageStats();
+}
+
+void
+OpenXRSwapChain::BindFBOLayer(uint32_t aLayer, GLenum target) {
+  CHECK_MSG(info.arraySize > 1, "BindFBOLayer must only be called for texture array swapchains");
+  CHECK_MSG(imageReady, "Expected a valid acquired FBO. AcquireImage not called?");
+  CHECK(aLayer < info.arraySize);
+  boundLayer = aLayer;
+  VRB_GL_CHECK(glBindFramebuffer(target, layerFramebuffers[acquiredImage * info.arraySize + aLayer]));
+}
+
+bool
+OpenXRSwapChain::BindMultiviewFBO(GLenum target) {
+  CHECK_MSG(imageReady, "Expected a valid acquired FBO. AcquireImage not called?");
+  if (!multiviewComplete) {
+    return false;
+  }
+  VRB_GL_CHECK(glBindFramebuffer(target, multiviewFramebuffers[acquiredImage]));
+  return true;
+}
+
 void
 OpenXRSwapChain::Destroy() {
-  if (acquiredFBO) {
+  if (acquiredImage >= 0) {
     ReleaseImage();
   }
   fbos.clear();
+  if (!layerFramebuffers.empty()) {
+    VRB_GL_CHECK(glDeleteFramebuffers((GLsizei)layerFramebuffers.size(), layerFramebuffers.data()));
+    layerFramebuffers.clear();
+  }
+  if (!multiviewFramebuffers.empty()) {
+    VRB_GL_CHECK(glDeleteFramebuffers((GLsizei)multiviewFramebuffers.size(), multiviewFramebuffers.data()));
+    multiviewFramebuffers.clear();
+  }
+  if (depthArray) {
+    VRB_GL_CHECK(glDeleteTextures(1, &depthArray));
+    depthArray = 0;
+  }
+  boundLayer = 0;
+  multiviewComplete = false;
   imageBuffer.clear();
   images.clear();
   if (swapchain != XR_NULL_HANDLE) {
@@ -18,6 +18,16 @@ class OpenXRSwapChain;
 typedef std::shared_ptr<OpenXRSwapChain> OpenXRSwapChainPtr;
 
 class OpenXRSwapChain {
+public:
+  // Time spent in xrAcquireSwapchainImage and xrWaitSwapchainImage.
+  struct ImageStats {
+    uint64_t acquires = 0;
+    uint64_t waits = 0;
+    uint64_t acquireMicroseconds = 0;
+    uint64_t maxAcquireMicroseconds = 0;
+    uint64_t waitMicroseconds = 0;
+    uint64_t maxWaitMicroseconds = 0;
+  };
 private:
   vrb::RenderContextPtr context;
   XrSwapchainCreateInfo info;
@@ -27,10 +37,23 @@ private:
   std::vector<XrSwapchainImageBaseHeader*> images;
   std::vector<vrb::FBOPtr> fbos;
   vrb::FBOPtr acquiredFBO;
+  int32_t acquiredImage = -1;
+  // False until the acquired image has been waited on.
+  bool imageReady = false;
+  // Texture array swapchains (arraySize > 1) render through raw framebuffers: one per image and
+  // array layer, plus one multiview framebuffer per image covering every layer.
+  std::vector<GLuint> layerFramebuffers;
+  std::vector<GLuint> multiviewFramebuffers;
+  GLuint depthArray = 0;
+  uint32_t boundLayer = 0;
+  bool multiviewComplete = false;
   JNIEnv* env = nullptr;
   jobject surface = nullptr;
   XrSession session = XR_NULL_HANDLE;
   uint32_t cubeTexture = 0;
+  ImageStats stats;
+  void InitArrayFramebuffers();
+  void CreateImageFBO(const uint32_t aIndex);
 public:
   ~OpenXRSwapChain();
 
@@ -38,17 +61,31 @@ public:
   void InitFBO(vrb::RenderContextPtr &aContext, XrSession aSession, const XrSwapchainCreateInfo& aInfo, vrb::FBO::Attributes aAttributes);
   void InitAndroidSurface(JNIEnv* aEnv, XrSession aSession, const XrSwapchainCreateInfo& aInfo);
   void InitCubemap(vrb::RenderContextPtr &aContext, XrSession aSession, const XrSwapchainCreateInfo& aInfo);
+  // Acquires the next image without waiting for it, so that it can be issued early in the frame.
+  void RequestImage();
+  // Blocks until the requested image can be rendered to. Does nothing if it is already ready.
+  void WaitImage();
+  // Requests the next image, unless already requested, and waits for it.
   void AcquireImage();
+  inline bool HasRequestedImage() const { return acquiredImage >= 0; }
   void ReleaseImage();
   void BindFBO(GLenum target = GL_FRAMEBUFFER);
+  // Texture array swapchains only. BindFBO() rebinds the last bound layer.
+  void BindFBOLayer(uint32_t aLayer, GLenum target = GL_FRAMEBUFFER);
+  // Binds a framebuffer rendering to every layer at once through OVR_multiview.
+  bool BindMultiviewFBO(GLenum target = GL_FRAMEBUFFER);
   void Destroy();
   inline XrSwapchain SwapChain() const { return swapchain;}
   inline int32_t Width() const { return info.width; }
   inline int32_t Height() const { return info.height; }
+  inline uint32_t ArraySize() const { return info.arraySize; }
+  inline bool IsMultiviewComplete() const { return multiviewComplete; }
   inline jobject AndroidSurface() const { return surface; }
   inline JNIEnv* Env() const { return  env; };
   inline XrSession Session() const { return session; }
   inline uint32_t CubemapTexture() const { return cubeTexture; }
+  const ImageStats& GetImageStats() const;
+  void ResetImageStats();
 };
 
 }